@@ -0,0 +1,498 @@
+#include <argh.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <util/Logger.h>
+#include <util/LuaUtil.h>
+#include <assets/AssetManager.h>
+#include <assets/Config.h>
+#include <lua/LuaCore.h>
+#include <lua/LuaArenaAllocator.h>
+#include <planet_mesher/mesher/PlanetTile.h>
+#include <planet_mesher/renderer/PlanetTileCuller.h>
+#include <universe/element/body/config/PlanetConfig.h>
+
+// Headless benchmark of terrain generation, runs PlanetTile::generate (or
+// generate_physics) on a fixed set of tiles with 1..N threads, no window or
+// OpenGL context is created.
+//
+// Usage (from the folder containing res and udata):
+//	ospgl_terrain_bench -planet=pkg:path/to/planet.toml [-min_depth=0] [-max_depth=4]
+//		[-max_tiles=256] [-threads=4] [-sides=PX,NX,PY,NY,PZ,NZ] [-physics]
+//		[-res_path=./res/] [-udata_path=./udata/] [-verify]
+//	ospgl_terrain_bench -cull
+//
+// max_tiles limits how many tiles are taken from each depth (evenly spaced)
+// verify compares the mesher kernels against the reference mesher, instead
+// of benchmarking, and fails if they differ by more than VERIFY_TOLERANCE
+// cull checks PlanetTileCuller against known spheres and cameras, no planet
+// is needed. Both modes return a nonzero exit code on failure.
+
+using BenchClock = std::chrono::steady_clock;
+
+// Vertices are stored as floats, relative to the tile, so the float rounding
+// of the output is the bulk of the error. The AVX2 kernels may round differently
+// to the reference (FMA, summation order), but never by more than this.
+static constexpr float VERIFY_TOLERANCE = 1e-5f;
+
+struct TileSample
+{
+	double total;
+	double lua;
+	double mesh;
+	double gc;
+	// Growth of the lua heap while generating the tile (before the GC step)
+	size_t lua_memory;
+	// Bytes allocated for the tile's own buffers (render tiles only)
+	size_t buffers;
+};
+
+struct BenchWorker
+{
+	// Must be declared before the state, so it outlives it
+	std::unique_ptr<LuaArenaAllocator> allocator;
+	sol::state lua_state;
+	std::vector<TileSample> samples;
+
+	BenchWorker() : allocator(std::make_unique<LuaArenaAllocator>()), lua_state(allocator->make_state()) {}
+};
+
+static double seconds_since(BenchClock::time_point t0)
+{
+	return std::chrono::duration<double>(BenchClock::now() - t0).count();
+}
+
+static std::vector<PlanetTilePath> make_paths(const std::vector<PlanetSide>& sides, size_t min_depth, size_t max_depth,
+	size_t max_tiles)
+{
+	std::vector<PlanetTilePath> out;
+
+	for (size_t depth = min_depth; depth <= max_depth; depth++)
+	{
+		size_t per_side = (size_t)1 << (2 * depth);
+		size_t total = per_side * sides.size();
+		size_t stride = std::max<size_t>(1, total / std::max<size_t>(1, max_tiles));
+
+		for (size_t i = 0; i < total; i += stride)
+		{
+			PlanetSide side = sides[i / per_side];
+			size_t index = i % per_side;
+
+			// Base 4 digits of the index are the quadrants, from the root
+			std::vector<QuadTreeQuadrant> path;
+			path.resize(depth);
+			for (size_t d = 0; d < depth; d++)
+			{
+				path[depth - d - 1] = (QuadTreeQuadrant)(index & 3);
+				index >>= 2;
+			}
+
+			out.push_back(PlanetTilePath(path, side));
+		}
+	}
+
+	return out;
+}
+
+static void worker_func(BenchWorker* worker, const std::vector<PlanetTilePath>* paths, std::atomic<size_t>* next,
+	PlanetConfig* config, bool physics)
+{
+	auto arrays = std::make_unique<PlanetTile::GeneratorArrays>();
+	auto physics_array = std::make_unique<PlanetTile::SimpleVertexArray<PlanetTile::PHYSICS_SIZE>>();
+
+	while (true)
+	{
+		size_t i = next->fetch_add(1);
+		if (i >= paths->size())
+		{
+			break;
+		}
+
+		TileSample sample;
+		PlanetTile::GeneratorTimings timings;
+
+		size_t heap_before = LuaArenaAllocator::get_heap_size(worker->lua_state);
+		auto t0 = BenchClock::now();
+
+		if (physics)
+		{
+			// Generated into the reused work array, nothing is allocated for the tile
+			PlanetTile::generate_physics((*paths)[i], config->radius, worker->lua_state, physics_array.get(), &timings);
+			sample.buffers = 0;
+		}
+		else
+		{
+			PlanetTile* tile = new PlanetTile();
+			tile->generate((*paths)[i], config->radius, worker->lua_state, config->surface.has_water,
+				arrays.get(), &timings);
+			// The tile itself holds the vertices, water vertices are only allocated if present
+			sample.buffers = sizeof(PlanetTile);
+			if (tile->water_vertices != nullptr)
+			{
+				sample.buffers += sizeof(*tile->water_vertices);
+			}
+			delete tile;
+		}
+
+		// Lua may run GC steps on its own while generating, so this is a lower bound
+		size_t heap_after = LuaArenaAllocator::get_heap_size(worker->lua_state);
+		sample.lua_memory = heap_after > heap_before ? heap_after - heap_before : 0;
+
+		auto gc_t0 = BenchClock::now();
+		worker->allocator->step_gc(worker->lua_state);
+
+		sample.gc = seconds_since(gc_t0);
+		sample.total = seconds_since(t0);
+		sample.lua = timings.lua;
+		sample.mesh = timings.mesh;
+
+		worker->samples.push_back(sample);
+	}
+}
+
+static bool verify(const std::vector<PlanetTilePath>& paths, PlanetConfig& config, const std::string& script)
+{
+	BenchWorker worker;
+	bool wrote_error = false;
+	PlanetTile::prepare_lua(worker.lua_state);
+	LuaUtil::safe_lua(worker.lua_state, script, wrote_error, config.surface.script_path);
+
+	auto arrays = std::make_unique<PlanetTile::GeneratorArrays>();
+	auto ref = std::make_unique<std::array<PlanetTileVertex, PlanetTile::VERTEX_COUNT>>();
+	auto water_ref = std::make_unique<std::array<PlanetTileWaterVertex, PlanetTile::VERTEX_COUNT>>();
+
+	float max_pos = 0.0f, max_nrm = 0.0f;
+
+	for (const PlanetTilePath& path : paths)
+	{
+		PlanetTile* tile = new PlanetTile();
+		tile->generate(path, config.radius, worker.lua_state, config.surface.has_water, arrays.get());
+		bool water = tile->water_vertices != nullptr;
+		tile->generate_reference_mesh(path, arrays.get(), ref.get(), water ? water_ref.get() : nullptr);
+
+		// Skirts are not generated by the mesher
+		for (size_t i = 0; i < PlanetTile::TILE_SIZE * PlanetTile::TILE_SIZE; i++)
+		{
+			max_pos = glm::max(max_pos, glm::distance(tile->vertices[i].pos, (*ref)[i].pos));
+			max_nrm = glm::max(max_nrm, glm::distance(tile->vertices[i].nrm, (*ref)[i].nrm));
+
+			if (water)
+			{
+				max_pos = glm::max(max_pos, glm::distance((*tile->water_vertices)[i].pos, (*water_ref)[i].pos));
+				max_nrm = glm::max(max_nrm, glm::distance((*tile->water_vertices)[i].nrm, (*water_ref)[i].nrm));
+			}
+		}
+
+		delete tile;
+		worker.allocator->step_gc(worker.lua_state);
+	}
+
+	logger->info("Verified {} tiles, max position error {} (tile units), max normal error {}",
+		paths.size(), max_pos, max_nrm);
+
+	if (max_pos > VERIFY_TOLERANCE || max_nrm > VERIFY_TOLERANCE)
+	{
+		logger->error("Mesher differs from the reference by more than {}", VERIFY_TOLERANCE);
+		return false;
+	}
+
+	return true;
+}
+
+struct CullCase
+{
+	const char* name;
+	glm::dvec3 center;
+	double radius;
+	bool outside_frustum;
+	bool behind_horizon;
+};
+
+// Same matrices as PlanetRenderer, for an earth sized planet at the origin and
+// a camera on the +Z axis, distance away in planet radii, with a 60 degree
+// square field of view
+static void begin_cull_camera(PlanetTileCuller& culler, double distance, bool facing_planet, double occluder_radius)
+{
+	const double radius = 6371000.0;
+	glm::dvec3 camera_world = glm::dvec3(0.0, 0.0, distance * radius);
+
+	// Rendering is camera relative, so the camera sits at the origin
+	glm::dmat4 view = glm::lookAt(glm::dvec3(0.0), glm::dvec3(0.0, 0.0, facing_planet ? -1.0 : 1.0),
+		glm::dvec3(0.0, 1.0, 0.0));
+	glm::dmat4 proj = glm::perspective(glm::radians(60.0), 1.0, 0.01, 1e10);
+	glm::dmat4 wmodel = glm::translate(glm::dmat4(1.0), -camera_world) * glm::scale(glm::dmat4(1.0), glm::dvec3(radius));
+
+	glm::dvec3 camera_local = glm::inverse(wmodel) * glm::dvec4(0.0, 0.0, 0.0, 1.0);
+	culler.begin(proj * view * wmodel, camera_local, occluder_radius);
+}
+
+static bool check_cull_cases(PlanetTileCuller& culler, const char* camera, const std::vector<CullCase>& cases)
+{
+	bool ok = true;
+	size_t frustum_culled = 0, horizon_culled = 0;
+
+	for (const CullCase& c : cases)
+	{
+		bool frustum = culler.is_outside_frustum(c.center, c.radius);
+		bool horizon = culler.is_behind_horizon(c.center, c.radius);
+
+		if (frustum != c.outside_frustum || horizon != c.behind_horizon)
+		{
+			logger->error("{}, {}: outside frustum {} behind horizon {}, expected {} and {}", camera, c.name,
+				frustum, horizon, c.outside_frustum, c.behind_horizon);
+			ok = false;
+		}
+
+		// is_visible only runs the horizon test on what passes the frustum test
+		culler.is_visible(c.center, c.radius);
+		if (c.outside_frustum)
+		{
+			frustum_culled++;
+		}
+		else if (c.behind_horizon)
+		{
+			horizon_culled++;
+		}
+	}
+
+	if (culler.stats.tested != cases.size() || culler.stats.frustum_culled != frustum_culled ||
+		culler.stats.horizon_culled != horizon_culled)
+	{
+		logger->error("{}: stats are {} tested, {} frustum culled, {} horizon culled, expected {}, {} and {}", camera,
+			culler.stats.tested, culler.stats.frustum_culled, culler.stats.horizon_culled,
+			cases.size(), frustum_culled, horizon_culled);
+		ok = false;
+	}
+
+	return ok;
+}
+
+static bool test_culler()
+{
+	PlanetTileCuller culler;
+	bool ok = true;
+
+	// Camera 3 radii away, looking at the planet. The horizon circle is at z = 1/3
+	// and the visible cap ends on the limb, which is ~0.057 inside the occluded cone at (1, 0, 0)
+	begin_cull_camera(culler, 3.0, true, 1.0);
+	ok &= check_cull_cases(culler, "Looking at planet", {
+		{ "near side", glm::dvec3(0.0, 0.0, 1.0), 0.1, false, false },
+		{ "far side", glm::dvec3(0.0, 0.0, -1.0), 0.1, false, true },
+		{ "far side, reaching past the horizon plane", glm::dvec3(0.0, 0.0, -1.0), 1.5, false, false },
+		{ "behind the limb", glm::dvec3(1.0, 0.0, 0.0), 0.02, false, true },
+		{ "poking out of the limb", glm::dvec3(1.0, 0.0, 0.0), 0.1, false, false },
+		{ "left of the frustum", glm::dvec3(-3.0, 0.0, 0.0), 0.1, true, false },
+		{ "right of the frustum", glm::dvec3(3.0, 0.0, 0.0), 0.1, true, false },
+		{ "above the frustum", glm::dvec3(0.0, 3.0, 0.0), 0.1, true, false },
+		{ "below the frustum", glm::dvec3(0.0, -3.0, 0.0), 0.1, true, false },
+		{ "crossing the right plane", glm::dvec3(3.0, 0.0, 0.0), 2.0, false, false },
+		{ "behind the camera", glm::dvec3(0.0, 0.0, 5.0), 0.1, true, false },
+		{ "around the camera", glm::dvec3(0.0, 0.0, 3.5), 1.0, false, false },
+	});
+
+	// Same place, looking away from the planet
+	begin_cull_camera(culler, 3.0, false, 1.0);
+	ok &= check_cull_cases(culler, "Looking away", {
+		{ "near side", glm::dvec3(0.0, 0.0, 1.0), 0.1, true, false },
+		{ "far side", glm::dvec3(0.0, 0.0, -1.0), 0.1, true, true },
+		{ "in front of the camera", glm::dvec3(0.0, 0.0, 5.0), 0.1, false, false },
+	});
+
+	// Camera under the occluder (ie. below the lowest terrain), horizon culling can't be done
+	begin_cull_camera(culler, 0.9, true, 1.0);
+	ok &= check_cull_cases(culler, "Inside occluder", {
+		{ "far side", glm::dvec3(0.0, 0.0, -1.0), 0.1, false, false },
+		{ "behind the camera", glm::dvec3(0.0, 0.0, 1.0), 0.05, true, false },
+	});
+
+	// Disabled tests cull nothing
+	begin_cull_camera(culler, 3.0, true, 1.0);
+	culler.frustum_enabled = false;
+	culler.horizon_enabled = false;
+	bool all_visible = culler.is_visible(glm::dvec3(0.0, 0.0, 5.0), 0.1) && culler.is_visible(glm::dvec3(0.0, 0.0, -1.0), 0.1);
+	if (!all_visible)
+	{
+		logger->error("Spheres were culled with both tests disabled");
+		ok = false;
+	}
+
+	if (ok)
+	{
+		logger->info("Culler tests passed");
+	}
+
+	return ok;
+}
+
+static void run(const std::vector<PlanetTilePath>& paths, PlanetConfig& config, const std::string& script,
+	size_t thread_count, bool physics)
+{
+	std::vector<std::unique_ptr<BenchWorker>> workers;
+	bool wrote_error = false;
+
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		workers.push_back(std::make_unique<BenchWorker>());
+		PlanetTile::prepare_lua(workers.back()->lua_state);
+		LuaUtil::safe_lua(workers.back()->lua_state, script, wrote_error, config.surface.script_path);
+	}
+
+	if (wrote_error)
+	{
+		logger->fatal("Surface script has errors, not running benchmark");
+	}
+
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+
+	auto t0 = BenchClock::now();
+
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		threads.emplace_back(worker_func, workers[i].get(), &paths, &next, &config, physics);
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	double wall = seconds_since(t0);
+
+	std::vector<double> latencies;
+	double lua = 0.0, mesh = 0.0, gc = 0.0, total = 0.0;
+	size_t lua_memory = 0;
+	size_t buffers = 0;
+	size_t heap = 0;
+
+	for (auto& worker : workers)
+	{
+		for (const TileSample& sample : worker->samples)
+		{
+			latencies.push_back(sample.total);
+			lua += sample.lua;
+			mesh += sample.mesh;
+			gc += sample.gc;
+			total += sample.total;
+			lua_memory += sample.lua_memory;
+			buffers += sample.buffers;
+		}
+
+		heap += LuaArenaAllocator::get_heap_size(worker->lua_state);
+	}
+
+	if (latencies.empty())
+	{
+		logger->warn("No tiles were generated");
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	double p50 = latencies[latencies.size() / 2];
+	double p99 = latencies[std::min(latencies.size() - 1, (latencies.size() * 99) / 100)];
+	double count = (double)latencies.size();
+
+	logger->info("{} thread(s): {} tiles in {:.3f}s, {:.1f} tiles/s", thread_count, latencies.size(), wall, count / wall);
+	logger->info("  latency p50 {:.3f}ms, p99 {:.3f}ms", p50 * 1000.0, p99 * 1000.0);
+	logger->info("  lua {:.1f}%, mesh {:.1f}%, gc {:.1f}%, other {:.1f}%", lua / total * 100.0, mesh / total * 100.0,
+		gc / total * 100.0, (total - lua - mesh - gc) / total * 100.0);
+	logger->info("  per tile: {:.1f}KB lua heap growth, {:.1f}KB tile buffers", (double)lua_memory / count / 1000.0,
+		(double)buffers / count / 1000.0);
+	logger->info("  {:.2f}MB lua heap per worker", (double)heap / (double)thread_count / 1000000.0);
+}
+
+int main(int argc, char** argv)
+{
+	argh::parser args(argc, argv);
+
+	std::string res_path = "./res/";
+	std::string udata_path = "./udata/";
+	std::string planet;
+	std::string sides_str = "PX,NX,PY,NY,PZ,NZ";
+	size_t min_depth = 0;
+	size_t max_depth = 4;
+	size_t max_tiles = 256;
+	size_t max_threads = 4;
+	bool physics = args[{"-physics", "--physics"}];
+	bool do_verify = args[{"-verify", "--verify"}];
+	bool do_cull = args[{"-cull", "--cull"}];
+
+	args("res_path", res_path) >> res_path;
+	args("udata_path", udata_path) >> udata_path;
+	args("planet") >> planet;
+	args("sides", sides_str) >> sides_str;
+	args("min_depth", min_depth) >> min_depth;
+	args("max_depth", max_depth) >> max_depth;
+	args("max_tiles", max_tiles) >> max_tiles;
+	args("threads", max_threads) >> max_threads;
+
+	create_global_logger();
+
+	if (do_cull)
+	{
+		int ret = test_culler() ? 0 : 1;
+		destroy_global_logger();
+		return ret;
+	}
+
+	if (planet.empty())
+	{
+		logger->fatal("Give the planet config to use with -planet=pkg:path/to/planet.toml");
+	}
+
+	std::vector<PlanetSide> sides;
+	const char* side_names[] = { "PX", "NX", "PY", "NY", "PZ", "NZ" };
+	for (const std::string& name : split(sides_str.c_str(), ','))
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if (name == side_names[i])
+			{
+				sides.push_back((PlanetSide)i);
+			}
+		}
+	}
+
+	logger->check(!sides.empty(), "No valid sides given");
+	logger->check(min_depth <= max_depth, "min_depth must not be bigger than max_depth");
+
+	create_global_asset_manager(res_path, udata_path);
+	create_global_lua_core();
+
+	PlanetConfig config;
+	auto config_toml = assets->get_from_path<Config>(planet)->root;
+	::deserialize(config, *config_toml);
+
+	logger->check(config.has_surface, "Planet has no surface to generate");
+
+	std::string script = AssetManager::load_string_raw(config.surface.script_path);
+
+	std::vector<PlanetTilePath> paths = make_paths(sides, min_depth, max_depth, max_tiles);
+
+	int ret = 0;
+
+	if (do_verify)
+	{
+		ret = verify(paths, config, script) ? 0 : 1;
+	}
+	else
+	{
+		logger->info("Benchmarking {} ({} {} tiles, depths {} to {})", planet, paths.size(),
+			physics ? "physics" : "render", min_depth, max_depth);
+
+		for (size_t threads = 1; threads <= max_threads; threads++)
+		{
+			run(paths, config, script, threads, physics);
+		}
+	}
+
+	destroy_global_lua_core();
+	destroy_global_asset_manager();
+	destroy_global_logger();
+
+	return ret;
+}
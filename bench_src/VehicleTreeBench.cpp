@@ -0,0 +1,206 @@
+#include <argh.h>
+#include <chrono>
+#include <random>
+#include <unordered_set>
+#include <algorithm>
+
+#include <util/Logger.h>
+#include <util/defines.h>
+#include <universe/vehicle/PieceTree.h>
+
+// Benchmark of the vehicle tree queries (Vehicle::sort, get_children_of and
+// reachability from the root) on synthetic vehicles, comparing PieceTree
+// against the previous full scan implementations.
+//
+// Usage:
+//	ospgl_vehicle_bench [-sizes=1000,5000] [-repeat=10] [-seed=0]
+//
+// Two shapes are generated for each size: a "rocket" (long stacks with
+// radially attached pieces) and a random tree.
+
+using BenchClock = std::chrono::steady_clock;
+
+static double seconds_since(BenchClock::time_point t0)
+{
+	return std::chrono::duration<double>(BenchClock::now() - t0).count();
+}
+
+static std::vector<size_t> make_rocket(size_t count, std::mt19937& rng)
+{
+	std::vector<size_t> parents(count, PieceTree::NONE);
+	size_t stack_top = 0;
+
+	for (size_t i = 1; i < count; i++)
+	{
+		if (i > 1 && rng() % 4 == 0)
+		{
+			// Radial piece, attached to the stack
+			parents[i] = stack_top;
+		}
+		else
+		{
+			parents[i] = stack_top;
+			stack_top = i;
+		}
+	}
+
+	return parents;
+}
+
+static std::vector<size_t> make_random(size_t count, std::mt19937& rng)
+{
+	std::vector<size_t> parents(count, PieceTree::NONE);
+	for (size_t i = 1; i < count; i++)
+	{
+		parents[i] = rng() % i;
+	}
+
+	return parents;
+}
+
+// Previous Vehicle::sort, scans every piece for each open piece
+static std::vector<size_t> scan_sort(const std::vector<size_t>& parents, size_t root)
+{
+	std::unordered_set<size_t> open;
+	open.insert(root);
+
+	std::vector<size_t> sorted;
+	sorted.push_back(root);
+
+	while (!open.empty())
+	{
+		std::unordered_set<size_t> new_open;
+
+		for (size_t o : open)
+		{
+			for (size_t p = 0; p < parents.size(); p++)
+			{
+				if (parents[p] == o)
+				{
+					new_open.insert(p);
+					sorted.push_back(p);
+				}
+			}
+		}
+
+		open = new_open;
+	}
+
+	return sorted;
+}
+
+// Previous Vehicle::get_children_of, a full scan for each piece in the subtree
+static std::vector<size_t> scan_children(const std::vector<size_t>& parents, size_t node)
+{
+	std::vector<size_t> out;
+	for (size_t p = 0; p < parents.size(); p++)
+	{
+		if (parents[p] == node)
+		{
+			out.push_back(p);
+		}
+	}
+
+	std::vector<size_t> sub_children;
+	for (size_t child : out)
+	{
+		auto nchild = scan_children(parents, child);
+		sub_children.insert(sub_children.end(), nchild.begin(), nchild.end());
+	}
+
+	out.insert(out.end(), sub_children.begin(), sub_children.end());
+
+	return out;
+}
+
+static void run(const char* name, const std::vector<size_t>& parents, size_t repeat)
+{
+	// Queries are done on the root, and on the first child of the root,
+	// which is most of the vehicle in the rocket shape
+	size_t sub = 1;
+
+	double scan_sort_t = 0.0, scan_children_t = 0.0;
+	double build_t = 0.0, sort_t = 0.0, children_t = 0.0, reach_t = 0.0;
+
+	std::vector<size_t> a, b;
+	std::vector<bool> reachable;
+
+	for (size_t r = 0; r < repeat; r++)
+	{
+		auto t0 = BenchClock::now();
+		a = scan_sort(parents, 0);
+		scan_sort_t += seconds_since(t0);
+
+		t0 = BenchClock::now();
+		b = scan_children(parents, sub);
+		scan_children_t += seconds_since(t0);
+	}
+
+	PieceTree tree;
+	std::vector<size_t> sorted, children;
+
+	for (size_t r = 0; r < repeat; r++)
+	{
+		auto t0 = BenchClock::now();
+		tree.build(parents);
+		build_t += seconds_since(t0);
+
+		sorted.clear();
+		t0 = BenchClock::now();
+		tree.breadth_first(0, sorted);
+		sort_t += seconds_since(t0);
+
+		children.clear();
+		t0 = BenchClock::now();
+		tree.get_subtree(sub, children);
+		children_t += seconds_since(t0);
+
+		t0 = BenchClock::now();
+		tree.mark_reachable(0, reachable);
+		reach_t += seconds_since(t0);
+	}
+
+	// Both must give the same pieces (order within a level may differ)
+	std::sort(a.begin(), a.end());
+	std::sort(sorted.begin(), sorted.end());
+	std::sort(b.begin(), b.end());
+	std::sort(children.begin(), children.end());
+	logger->check(a == sorted, "Sort results differ");
+	logger->check(b == children, "Subtree results differ");
+	logger->check(std::count(reachable.begin(), reachable.end(), true) == (ptrdiff_t)parents.size(),
+		"Reachability results differ");
+
+	double ms = 1000.0 / (double)repeat;
+	logger->info("{} ({} pieces, subtree of {}):", name, parents.size(), children.size());
+	logger->info("  scan:  sort {:.3f}ms, subtree {:.3f}ms", scan_sort_t * ms, scan_children_t * ms);
+	logger->info("  tree:  build {:.3f}ms, sort {:.3f}ms, subtree {:.3f}ms, reachable {:.3f}ms",
+		build_t * ms, sort_t * ms, children_t * ms, reach_t * ms);
+}
+
+int main(int argc, char** argv)
+{
+	argh::parser args(argc, argv);
+
+	std::string sizes_str = "1000,5000";
+	size_t repeat = 10;
+	unsigned int seed = 0;
+
+	args("sizes", sizes_str) >> sizes_str;
+	args("repeat", repeat) >> repeat;
+	args("seed", seed) >> seed;
+
+	create_global_logger();
+
+	std::mt19937 rng(seed);
+
+	for (const std::string& size_str : split(sizes_str.c_str(), ','))
+	{
+		size_t count = std::max<size_t>(2, std::stoul(size_str));
+		run("rocket", make_rocket(count, rng), repeat);
+		run("random", make_random(count, rng), repeat);
+	}
+
+	destroy_global_logger();
+
+	return 0;
+}
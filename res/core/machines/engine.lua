@@ -44,7 +44,7 @@ function update(dt)
 		-- Position is relative to the center of mass of the rigidbody
 		local rpos = p_root:transform_point_to_rigidbody(nozzle_pos)
 
-		p_root.rigid_body:apply_force(rdir * thrust * throttle, rpos)
+		p_root:apply_force(rdir * thrust * throttle, rpos)
 
 		-- Draw flame
 		local fpos = glm.vec3.new(p_root:get_graphics_transform():to_mat4() * glm.vec4.new(nozzle_pos, 1.0))
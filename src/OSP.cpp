@@ -163,6 +163,37 @@ void OSP::init(int argc, char** argv)
 		create_global_lua_core();
 		create_global_profiler();
 
+		lua_core->share_vehicle_states = config->get_qualified_as<bool>("lua.share_vehicle_states").value_or(true);
+		if(config->get_qualified_as<bool>("lua.persist_bytecode").value_or(false))
+		{
+			lua_core->bytecode_cache.set_persist_path(udata_path + "cache/lua/");
+		}
+
+		// Negative uses all cores (the main thread updates too, so one less)
+		int64_t update_threads = config->get_qualified_as<int64_t>("universe.update_threads").value_or(0);
+		if(update_threads < 0)
+		{
+			update_threads = std::max((int64_t)std::thread::hardware_concurrency() - 1, (int64_t)0);
+		}
+		game_state.universe.set_update_threads((size_t)update_threads);
+
+		int64_t physics_threads = config->get_qualified_as<int64_t>("physics.threads").value_or(0);
+		if(physics_threads < 0)
+		{
+			physics_threads = (int64_t)std::thread::hardware_concurrency();
+		}
+		bool multibody_vehicles = config->get_qualified_as<bool>("physics.multibody_vehicles").value_or(false);
+		if(physics_threads > 0 || multibody_vehicles)
+		{
+			game_state.universe.set_physics_world((size_t)physics_threads, multibody_vehicles);
+		}
+
+		double bubble_radius = config->get_qualified_as<double>("physics.bubble_radius").value_or(0.0);
+		int64_t bubble_low_rate = config->get_qualified_as<int64_t>("physics.bubble_low_rate").value_or(1);
+		game_state.universe.set_physics_bubbles(bubble_radius, (int)bubble_low_rate);
+
+		game_state.quicksave.compress = config->get_qualified_as<bool>("saves.compress_quicksaves").value_or(true);
+
 		// Load packages now so they register all scripts...
 		assets->load_packages(lua_core, &game_database);
 
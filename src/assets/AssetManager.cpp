@@ -114,9 +114,11 @@ std::pair<std::string, std::string> AssetManager::get_package_and_name(const std
 	return std::make_pair(package, name);
 }
 
+thread_local std::string AssetManager::current_package = "core";
+
 void AssetManager::set_current_package(const std::string& pkg)
 {
-	this->current_package = pkg;
+	current_package = pkg;
 }
 
 std::string AssetManager::get_current_package()
@@ -236,6 +238,27 @@ void AssetManager::load_script_to(sol::state& target, const std::string& full_pa
 	return load_script_to(target, pkg, name);
 }
 
+void AssetManager::load_script_to(sol::state& target, sol::environment& env, const std::string& full_path)
+{
+	auto[pkg, name] = get_package_and_name(full_path, get_current_package());
+	return load_script_to(target, env, pkg, name);
+}
+
+void AssetManager::load_script_to(sol::state& target, sol::environment& env, const std::string& pkg, const std::string& path)
+{
+	std::string full_path = res_path + pkg + "/" + path;	
+	logger->check(file_exists(full_path), "Tried to load an script which does not exist ({})", path);
+
+	std::string source = load_string_raw(full_path);
+	sol::protected_function_result result = lua_core->run_script(target, source, full_path, &env);
+
+	if(!result.valid())
+	{
+		sol::error err = result;
+		logger->fatal("Error while loading script {}:{}:\n{}", pkg, path, err.what());
+	}	
+}
+
 void AssetManager::load_script_to(sol::state& target, const std::string& pkg, const std::string& path)
 {
 	std::string full_path = res_path + pkg + "/" + path;	
@@ -244,8 +267,8 @@ void AssetManager::load_script_to(sol::state& target, const std::string& pkg, co
 	lua_core->load(target, pkg);
 
 	// Scripts MUST load, failure to do so will crash the game
-	//out.script_file(full_path);
-	sol::protected_function_result result = target.safe_script_file(full_path);
+	std::string source = load_string_raw(full_path);
+	sol::protected_function_result result = lua_core->run_script(target, source, full_path);
 
 	if(!result.valid())
 	{
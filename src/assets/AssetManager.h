@@ -7,6 +7,7 @@
 #include <regex>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
 
 #include <util/Logger.h>
 #include <util/SerializeUtil.h>
@@ -67,7 +68,12 @@ private:
 	template<typename T>
 	bool load(const std::string& package, const std::string& name);
 
-	std::string current_package;
+	// Per thread, as machines set it while their scripts run, and
+	// they may run on the update threads (see Universe::set_update_threads)
+	static thread_local std::string current_package;
+
+	// Guards the asset maps, recursive as loading an asset may get others
+	std::recursive_mutex assets_mtx;
 
 public:
 
@@ -131,6 +137,10 @@ public:
 	sol::state load_script(const std::string& full_path);
 	void load_script_to(sol::state& target, const std::string& pkg, const std::string& path);
 	void load_script_to(sol::state& target, const std::string& full_path);
+	// Runs the script in the given environment of target, which must
+	// already have been loaded by lua_core (for example, a SharedLuaState)
+	void load_script_to(sol::state& target, sol::environment& env, const std::string& pkg, const std::string& path);
+	void load_script_to(sol::state& target, sol::environment& env, const std::string& full_path);
 
 	void get_config_path(const std::string& pkg);
 
@@ -139,7 +149,6 @@ public:
 
 	AssetManager(const std::string& res_path, const std::string& udata_path)
 	{
-		current_package = "core";
 		this->res_path = res_path;
 		this->udata_path = udata_path;
 	}
@@ -163,6 +172,8 @@ inline void AssetManager::create_asset_type(const std::string& name, LoadAssetPt
 template<typename T>
 inline T* AssetManager::get(const std::string& package, const std::string& name, bool use)
 {
+	std::lock_guard<std::recursive_mutex> lock(assets_mtx);
+
 	auto pkg = packages.find(package);
 	logger->check(pkg != packages.end(), "Invalid package ({}) given", package);
 
@@ -190,6 +201,8 @@ inline T* AssetManager::get(const std::string& package, const std::string& name,
 template<typename T>
 inline T * AssetManager::get_or_null(const std::string & package, const std::string name, bool use)
 {
+	std::lock_guard<std::recursive_mutex> lock(assets_mtx);
+
 	auto pkg = packages.find(package);
 	logger->check(pkg != packages.end(), "Invalid package ({}) given", package);
 
@@ -220,6 +233,8 @@ inline T * AssetManager::get_or_null(const std::string & package, const std::str
 template<typename T>
 inline void AssetManager::free(const std::string& package, const std::string& name)
 {
+	std::lock_guard<std::recursive_mutex> lock(assets_mtx);
+
 	auto pkg = packages.find(package);
 	logger->check(pkg != packages.end(), "Invalid package ({}) given", package);
 
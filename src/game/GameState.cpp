@@ -4,14 +4,15 @@
 GameState::GameState(OSP* n_osp) : universe()
 {
 	osp = n_osp;
+	scene = nullptr;
+	to_delete = nullptr;
 }
 
-void GameState::load(const cpptoml::table& from)
+void GameState::load_system(const std::string& path, double t0)
 {
-	std::string system_path = *from.get_as<std::string>("system");
+	system_path = path;
 	assets->get_from_path<Config>(system_path)->read_to(universe.system);
 
-	double t0 = *from.get_as<double>("t");
 	universe.system.t0 = t0;
 	Date start_date = Date(t0);
 	logger->info("Starting at: {}", start_date.to_string());
@@ -21,13 +22,18 @@ void GameState::load(const cpptoml::table& from)
 	// These updates populate the element arrays
 	universe.system.update(0.0, universe.bt_world, false);
 	universe.system.update(0.0, universe.bt_world, true);
+}
+
+void GameState::load(const cpptoml::table& from)
+{
+	load_system(*from.get_as<std::string>("system"), *from.get_as<double>("t"));
 
 	// Load entities
 	int64_t last_uid = *from.get_as<int64_t>("uid");
 
 
 	auto entities = from.get_table_array("entity");
-	std::unordered_map<Entity*, int64_t> ent_to_id;
+	std::vector<std::pair<Entity*, int64_t>> loaded;
 
 	if (entities)
 	{
@@ -41,25 +47,18 @@ void GameState::load(const cpptoml::table& from)
 			std::string type = *entity->get_as<std::string>("type");
 
 			Entity* n_ent = Entity::load_entity(type, *entity);
-			universe.entities.push_back(n_ent);
-
-			ent_to_id[n_ent] = id;
+			universe.entities.add(n_ent, id);
+			loaded.emplace_back(n_ent, id);
 		}
 	}
 
 	// Init the universe entities (We have added them through special
 	// code)
 
-	// Init the hashtable
-	for(Entity* ent : universe.entities)
-	{
-		universe.entities_by_id[ent_to_id[ent]] = ent;
-	}
-
 	// Init the entities
-	for(Entity* ent : universe.entities)
+	for(auto& pair : loaded)
 	{
-		ent->setup(&universe, ent_to_id[ent]);
+		pair.first->setup(&universe, pair.second);
 	}
 
 	universe.uid = last_uid;
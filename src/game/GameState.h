@@ -3,6 +3,7 @@
 #include <util/SerializeUtil.h>
 #include "universe/Date.h"
 #include "scenes/Scene.h"
+#include "QuickSave.h"
 
 class OSP;
 
@@ -17,9 +18,17 @@ public:
 	OSP* osp;
 	Universe universe;
 
+	// Path of the system asset, empty until one is loaded
+	std::string system_path;
+
+	QuickSave quicksave;
+
 	void load(const cpptoml::table& from);
 	void write(cpptoml::table& target) const;
 
+	// Loads the system and moves it to t0, without any entities
+	void load_system(const std::string& path, double t0);
+
 	void update();
 
 	void render();
@@ -0,0 +1,246 @@
+#include "QuickSave.h"
+#include "GameState.h"
+#include <util/MappedFile.h>
+#include <util/Compression.h>
+#include <util/Timer.h>
+
+struct QuickSaveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t pad;
+	uint64_t size;
+};
+
+static size_t begin_chunk(BinaryWriter& writer, uint32_t tag)
+{
+	writer.write(tag);
+	return writer.reserve_u32();
+}
+
+static void end_chunk(BinaryWriter& writer, size_t size_offset)
+{
+	writer.patch_u32(size_offset, (uint32_t)(writer.data.size() - size_offset - sizeof(uint32_t)));
+}
+
+bool QuickSave::save(GameState& state, const std::string& path)
+{
+	if(busy)
+	{
+		logger->warn("Tried to quicksave while the previous quicksave is being written");
+		return false;
+	}
+
+	Timer timer;
+	Universe& universe = state.universe;
+	PlanetarySystem& system = universe.system;
+
+	BinaryWriter writer;
+
+	size_t chunk = begin_chunk(writer, CHUNK_SYSTEM);
+	writer.write_string(state.system_path);
+	writer.write(system.t0);
+	writer.write(system.t);
+	writer.write(system.bt);
+	writer.write(system.timewarp);
+	writer.write(universe.uid);
+	end_chunk(writer, chunk);
+
+	chunk = begin_chunk(writer, CHUNK_ENTITIES);
+	writer.write((uint32_t)universe.entities.size());
+	for(Entity* ent : universe.entities)
+	{
+		writer.write_string(ent->get_type());
+		writer.write(ent->get_uid());
+		size_t ent_size = writer.reserve_u32();
+		ent->write_binary(writer);
+		end_chunk(writer, ent_size);
+	}
+	end_chunk(writer, chunk);
+
+	logger->info("Quicksave encoded in {:.2f}ms ({:.1f}KB)", timer.get_elapsed_time() * 1000.0, 
+		(double)writer.data.size() / 1000.0);
+
+	if(thread.joinable())
+	{
+		thread.join();
+	}
+
+	busy = true;
+	bool compressed = compress;
+	thread = std::thread([this, path, compressed](std::vector<uint8_t> data)
+	{
+		QuickSaveHeader header = {};
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.size = data.size();
+
+		std::vector<uint8_t> payload;
+		if(compressed)
+		{
+			header.flags |= COMPRESSED;
+			payload = Compression::compress(data.data(), data.size());
+		}
+		else
+		{
+			payload = std::move(data);
+		}
+
+		BinaryWriter file;
+		file.data.reserve(sizeof(QuickSaveHeader) + payload.size());
+		file.write(header);
+		file.write_bytes(payload.data(), payload.size());
+
+		if(!BinaryUtil::write_file(file.data, path))
+		{
+			logger->error("Could not write quicksave to '{}'", path);
+		}
+
+		busy = false;
+	}, std::move(writer.data));
+
+	return true;
+}
+
+void QuickSave::wait()
+{
+	if(thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+void QuickSave::load_system(GameState& state, BinaryReader& reader)
+{
+	std::string system_path = reader.read_string();
+	double t0 = reader.read<double>();
+	double t = reader.read<double>();
+	double bt = reader.read<double>();
+	double timewarp = reader.read<double>();
+	int64_t uid = reader.read<int64_t>();
+
+	Universe& universe = state.universe;
+
+	if(state.system_path.empty())
+	{
+		state.load_system(system_path, t0);
+	}
+	else
+	{
+		logger->check(state.system_path == system_path, "Quicksave is of another system ({}, loaded {})",
+			system_path, state.system_path);
+		universe.system.t0 = t0;
+	}
+
+	universe.system.t = t;
+	universe.system.bt = bt;
+	universe.system.timewarp = timewarp;
+
+	// Move the bodies to the saved time
+	universe.system.update(0.0, universe.bt_world, false);
+	universe.system.update(0.0, universe.bt_world, true);
+
+	universe.uid = uid;
+}
+
+void QuickSave::load_entities(GameState& state, BinaryReader& reader)
+{
+	Universe& universe = state.universe;
+
+	// Entities of the save replace all we have
+	std::vector<Entity*> old_entities(universe.entities.begin(), universe.entities.end());
+	for(Entity* ent : old_entities)
+	{
+		universe.remove_entity(ent);
+	}
+
+	uint32_t count = reader.read<uint32_t>();
+	std::vector<std::pair<Entity*, int64_t>> loaded;
+	loaded.reserve(count);
+	for(uint32_t i = 0; i < count; i++)
+	{
+		std::string type = reader.read_string();
+		int64_t id = reader.read<int64_t>();
+		logger->check(id > 0 && id <= universe.uid, "Invalid UID {} in quicksave", id);
+		logger->check(universe.entities.get_by_uid(id) == nullptr, "Duplicate UID {} in quicksave", id);
+
+		uint32_t size = reader.read<uint32_t>();
+		BinaryReader ent_reader = BinaryReader(reader.read_bytes(size), size);
+		Entity* n_ent = Entity::load_entity_binary(type, ent_reader);
+		logger->check(ent_reader.at_end(), "Entity {} of type '{}' was not fully read", id, type);
+
+		universe.entities.add(n_ent, id);
+		loaded.emplace_back(n_ent, id);
+	}
+
+	// As in GameState::load, entities are set up once all of them exist
+	for(auto& pair : loaded)
+	{
+		pair.first->setup(&universe, pair.second);
+		universe.queue_event(CoreEvents::NEW_ENTITY, EventArguments{ pair.second });
+	}
+}
+
+void QuickSave::load(GameState& state, const std::string& path)
+{
+	// We may be writing the same file
+	wait();
+
+	Timer timer;
+
+	MappedFile file;
+	logger->check(file.open(path), "Could not open quicksave '{}'", path);
+
+	BinaryReader file_reader = BinaryReader(file.get_data(), file.get_size());
+	QuickSaveHeader header = file_reader.read<QuickSaveHeader>();
+	logger->check(header.magic == MAGIC, "'{}' is not a quicksave", path);
+	logger->check(header.version == VERSION, "Unsupported quicksave version ({}, expected {})", 
+		header.version, VERSION);
+
+	size_t payload_size = file_reader.get_size() - file_reader.get_pos();
+	const uint8_t* payload = file_reader.read_bytes(payload_size);
+
+	std::vector<uint8_t> decompressed;
+	if(header.flags & COMPRESSED)
+	{
+		decompressed = Compression::decompress(payload, payload_size, (size_t)header.size);
+		payload = decompressed.data();
+		payload_size = decompressed.size();
+	}
+	logger->check(payload_size == header.size, "Quicksave is truncated");
+
+	BinaryReader reader = BinaryReader(payload, payload_size);
+	while(!reader.at_end())
+	{
+		uint32_t tag = reader.read<uint32_t>();
+		uint32_t size = reader.read<uint32_t>();
+		BinaryReader chunk = BinaryReader(reader.read_bytes(size), size);
+
+		if(tag == CHUNK_SYSTEM)
+		{
+			load_system(state, chunk);
+		}
+		else if(tag == CHUNK_ENTITIES)
+		{
+			load_entities(state, chunk);
+		}
+		else
+		{
+			logger->warn("Unknown chunk in quicksave ({:#x}), skipping it", tag);
+		}
+	}
+
+	logger->info("Quicksave loaded in {:.2f}ms", timer.get_elapsed_time() * 1000.0);
+}
+
+QuickSave::QuickSave()
+{
+	busy = false;
+	compress = true;
+}
+
+QuickSave::~QuickSave()
+{
+	wait();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <util/BinaryUtil.h>
+
+class GameState;
+
+// Binary saves of the whole game state, much faster to write and load than
+// TOML saves. The file is:
+//	- A header: magic, version, flags and the size of the chunks (uncompressed)
+//	- Chunks, each one a tag and its size, so unknown chunks are skipped:
+//		- SYST: system path, times, timewarp and the last entity uid
+//		- ENTS: every entity with its type and uid (see Entity::write_binary)
+// The chunks may be compressed as a whole (see Compression).
+// Saving encodes the state on the calling thread, so call it between updates
+// and it's consistent, and compresses and writes the file on a background thread.
+class QuickSave
+{
+private:
+
+	std::thread thread;
+	std::atomic<bool> busy;
+
+	static void load_system(GameState& state, BinaryReader& reader);
+	static void load_entities(GameState& state, BinaryReader& reader);
+
+public:
+
+	static constexpr uint32_t MAGIC = 0x5153504F; // "OSPQ"
+	static constexpr uint32_t VERSION = 1;
+
+	static constexpr uint32_t CHUNK_SYSTEM = 0x54535953; // "SYST"
+	static constexpr uint32_t CHUNK_ENTITIES = 0x53544E45; // "ENTS"
+
+	enum Flags : uint32_t
+	{
+		COMPRESSED = 1 << 0
+	};
+
+	bool compress;
+
+	// Returns false (and does nothing) if the previous save is still being written
+	bool save(GameState& state, const std::string& path);
+	bool is_busy() { return busy; }
+	// Waits for the save being written, if any
+	void wait();
+
+	// Replaces all entities with those of the save. If a system is loaded
+	// it must be the one of the save, otherwise the save's is loaded
+	void load(GameState& state, const std::string& path);
+
+	QuickSave();
+	~QuickSave();
+};
@@ -141,8 +141,7 @@ void EditorVehicle::init()
 
 EditorVehicle::EditorVehicle() : Drawable()
 {
-	auto vehicle_toml = SerializeUtil::load_file("udata/vehicles/Test Vehicle.toml");
-	veh = VehicleLoader(*vehicle_toml).get_vehicle();
+	veh = VehicleLoader::load_file("udata/vehicles/Test Vehicle.toml");
 	
 	// Load the different models
 	std::string model_path = *SerializeUtil::load_file(assets->resolve_path("core:meshes/editor_attachment.toml"))
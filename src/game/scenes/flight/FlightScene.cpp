@@ -6,6 +6,8 @@
 #include <universe/vehicle/VehicleLoader.h>
 #include <universe/entity/entities/VehicleEntity.h>
 #include <universe/entity/entities/BuildingEntity.h>
+#include <util/InputUtil.h>
+#include <imgui/imgui.h>
 
 void FlightScene::load()
 {
@@ -23,32 +25,41 @@ void FlightScene::load()
 	}
 
 	// Sign up for new entities to automatically add them to the renderer
-	universe->sign_up_for_event("core:new_entity", EventHandler([](EventArguments& args, const void* self)
+	universe->sign_up_for_event(CoreEvents::NEW_ENTITY, EventHandler([](EventArguments& args, const void* self)
 	{
 		FlightScene* self_s = (FlightScene*)self;
 		int64_t id = std::get<int64_t>(args[0]);
-		self_s->get_osp()->renderer->add_drawable(self_s->universe->get_entity(id));	
+		// The event is queued, the entity may be gone already
+		Entity* ent = self_s->universe->get_entity(id);
+		if(ent && !ent->is_in_renderer())
+		{
+			self_s->get_osp()->renderer->add_drawable(ent);
+		}
 
 	}, this));
 
 	// And automatically remove them when they die
-	universe->sign_up_for_event("core:remove_entity", EventHandler([](EventArguments& args, const void* self)
+	universe->sign_up_for_event(CoreEvents::REMOVE_ENTITY, EventHandler([](EventArguments& args, const void* self)
 	{
 		FlightScene* self_s = (FlightScene*)self;
 		int64_t id = std::get<int64_t>(args[0]);
-		self_s->get_osp()->renderer->remove_drawable(self_s->universe->get_entity(id));
+		// May be removed before its core:new_entity was dispatched
+		Entity* ent = self_s->universe->get_entity(id);
+		if(ent && ent->is_in_renderer())
+		{
+			self_s->get_osp()->renderer->remove_drawable(ent);
+		}
 
 	}, this));
 
 	get_osp()->renderer->cam = &camera;
 
-	auto vehicle_toml = SerializeUtil::load_file("udata/vehicles/Test Vehicle.toml");
-	Vehicle* n_vehicle = VehicleLoader(*vehicle_toml).get_vehicle();
+	Vehicle* n_vehicle = VehicleLoader::load_file("udata/vehicles/Test Vehicle.toml");
 
 	get_osp()->game_state.universe.create_entity<VehicleEntity>(n_vehicle);
 
 	WorldState st = WorldState();
-	BuildingEntity* lpad_ent = (BuildingEntity*)get_osp()->game_state.universe.entities[0];
+	BuildingEntity* lpad_ent = get_osp()->game_state.universe.entities.get_buildings()[0];
 	WorldState stt = lpad_ent->traj.get_state(0.0, true);
 
 	st.cartesian.pos = stt.cartesian.pos;
@@ -60,19 +71,62 @@ void FlightScene::load()
 	n_vehicle->packed_veh.set_world_state(st);
 	n_vehicle->unpack();
 
+	take_control(n_vehicle);
+
+	Renderer* r = get_osp()->renderer;
+	
+	sun = SunLight(r->quality.sun_terrain_shadow_size, r->quality.sun_shadow_size);
+	r->add_light(&sun);
+}
+
+void FlightScene::take_control(Vehicle* vehicle)
+{
 	// Pass control to the capsule (root)
-	Machine* capsule = n_vehicle->root->part->get_machine("capsule");	
-	auto result = LuaUtil::call_function_if_present(capsule->lua_state, "get_input_context", "Flight Scene obtain input context");
+	Machine* capsule = vehicle->root->part->get_machine("capsule");	
+	auto result = LuaUtil::call_function_if_present(capsule->env, "get_input_context", "Flight Scene obtain input context");
 	if(result.valid())
 	{
 		logger->info("?");
 		input.set_ctx(result.get<InputContext*>());		
 	}	
+}
 
-	Renderer* r = get_osp()->renderer;
-	
-	sun = SunLight(r->quality.sun_terrain_shadow_size, r->quality.sun_shadow_size);
-	r->add_light(&sun);
+void FlightScene::do_debug_imgui()
+{
+	ImGui::Begin("Flight Debug", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+	if(ImGui::CollapsingHeader("Physics"))
+	{
+		universe->ground_collision_stats.do_imgui();
+	}
+
+	if(ImGui::CollapsingHeader("Planet tiles"))
+	{
+		for(SystemElement& elem : universe->system.elements)
+		{
+			if(elem.type != SystemElement::BODY || elem.as_body->renderer.rocky == nullptr)
+			{
+				continue;
+			}
+
+			if(ImGui::TreeNode(elem.name.c_str()))
+			{
+				elem.as_body->renderer.rocky->renderer.culler.do_imgui();
+				ImGui::TreePop();
+			}
+		}
+	}
+
+	if(ImGui::CollapsingHeader("Vehicles"))
+	{
+		for(VehicleEntity* v_ent : universe->entities.get_vehicles())
+		{
+			ImGui::Text("Vehicle %i: %i lua calls last frame", (int)v_ent->get_uid(), 
+				(int)v_ent->vehicle->last_lua_calls);
+		}
+	}
+
+	ImGui::End();
 }
 
 void FlightScene::unload()
@@ -85,10 +139,23 @@ void FlightScene::update()
 	gui_input.update();
 
 	// GUI preparation goes here
+	do_debug_imgui();
 	
 	input.keyboard_blocked = camera.keyboard_blocked || gui_input.keyboard_blocked;
 	input.update(get_osp()->renderer->window, get_osp()->game_dt);
 
+	if(!input.keyboard_blocked && ::input->key_down(GLFW_KEY_F5))
+	{
+		game_state->quicksave.save(*game_state, QUICKSAVE_PATH);
+	}
+
+	if(!input.keyboard_blocked && ::input->key_down(GLFW_KEY_F9))
+	{
+		game_state->quicksave.load(*game_state, QUICKSAVE_PATH);
+		// Entities keep their uid through quicksaves
+		take_control(universe->get_entity_as<VehicleEntity>(2)->vehicle);
+	}
+
 	VehicleEntity* v_ent =  universe->get_entity_as<VehicleEntity>(2);	
 	
 	camera.center = v_ent->vehicle->unpacked_veh.get_center_of_mass(true);
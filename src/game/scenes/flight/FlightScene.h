@@ -5,6 +5,8 @@
 #include "FlightInput.h"
 #include <renderer/lighting/SunLight.h>
 
+class Vehicle;
+
 class FlightScene : public Scene
 {
 private:
@@ -15,8 +17,16 @@ private:
 	
 	SunLight sun;
 
+	// Gives the input to the capsule of the vehicle (its root)
+	void take_control(Vehicle* vehicle);
+
+	// Performance counters of the universe and vehicles
+	void do_debug_imgui();
+
 public:
 
+	static constexpr const char* QUICKSAVE_PATH = "udata/saves/quicksave.bin";
+
 	FlightInput input;
 
 	virtual void load() override;
@@ -0,0 +1,218 @@
+#include "LuaArenaAllocator.h"
+#include <cstdlib>
+#include <cstring>
+
+void* LuaArenaAllocator::alloc_small(size_t cl)
+{
+	FreeBlock* block = free_lists[cl];
+	if (block != nullptr)
+	{
+		free_lists[cl] = block->next;
+		return block;
+	}
+
+	size_t size = (cl + 1) * CLASS_SIZE;
+
+	if (chunks.empty() || chunk_used + size > CHUNK_SIZE)
+	{
+		char* chunk = (char*)malloc(CHUNK_SIZE);
+		if (chunk == nullptr)
+		{
+			return nullptr;
+		}
+
+		chunks.push_back(chunk);
+		chunk_used = 0;
+		reserved += CHUNK_SIZE;
+	}
+
+	void* out = chunks.back() + chunk_used;
+	chunk_used += size;
+	return out;
+}
+
+void LuaArenaAllocator::free_small(void* ptr, size_t cl)
+{
+	FreeBlock* block = (FreeBlock*)ptr;
+	block->next = free_lists[cl];
+	free_lists[cl] = block;
+}
+
+void* LuaArenaAllocator::realloc(void* ptr, size_t osize, size_t nsize)
+{
+	// Lua gives garbage in osize when ptr is null
+	if (ptr == nullptr)
+	{
+		osize = 0;
+	}
+
+	if (nsize == 0)
+	{
+		if (ptr != nullptr)
+		{
+			if (osize <= MAX_SMALL_SIZE)
+			{
+				free_small(ptr, get_class(osize));
+			}
+			else
+			{
+				free(ptr);
+				reserved -= osize;
+			}
+
+			used -= osize;
+		}
+
+		return nullptr;
+	}
+
+	// Small blocks which stay in the same class don't move
+	if (ptr != nullptr && osize <= MAX_SMALL_SIZE && nsize <= MAX_SMALL_SIZE &&
+		get_class(osize) == get_class(nsize))
+	{
+		used = used - osize + nsize;
+		return ptr;
+	}
+
+	void* out;
+	if (nsize <= MAX_SMALL_SIZE)
+	{
+		out = alloc_small(get_class(nsize));
+	}
+	else if (ptr != nullptr && osize > MAX_SMALL_SIZE)
+	{
+		// Both big, let the system handle it
+		out = ::realloc(ptr, nsize);
+		if (out == nullptr)
+		{
+			return nullptr;
+		}
+
+		reserved = reserved - osize + nsize;
+		used = used - osize + nsize;
+		allocated_since_step += nsize > osize ? nsize - osize : 0;
+		return out;
+	}
+	else
+	{
+		out = malloc(nsize);
+		if (out != nullptr)
+		{
+			reserved += nsize;
+		}
+	}
+
+	if (out == nullptr)
+	{
+		// Lua expects the old block to be untouched on failure
+		return nullptr;
+	}
+
+	used += nsize;
+	allocated_since_step += nsize;
+
+	if (ptr != nullptr)
+	{
+		memcpy(out, ptr, osize < nsize ? osize : nsize);
+		// Releases the old block, and updates counters
+		realloc(ptr, osize, 0);
+	}
+
+	return out;
+}
+
+void* LuaArenaAllocator::lua_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	return ((LuaArenaAllocator*)ud)->realloc(ptr, osize, nsize);
+}
+
+bool LuaArenaAllocator::is_supported()
+{
+	static bool checked = false;
+	static bool supported = false;
+
+	if (!checked)
+	{
+		LuaArenaAllocator test;
+		lua_State* L = lua_newstate(&LuaArenaAllocator::lua_alloc, &test);
+		if (L != nullptr)
+		{
+			supported = true;
+			lua_close(L);
+		}
+
+		checked = true;
+	}
+
+	return supported;
+}
+
+sol::state LuaArenaAllocator::make_state()
+{
+	if (is_supported())
+	{
+		in_use = true;
+		return sol::state(sol::default_at_panic, &LuaArenaAllocator::lua_alloc, this);
+	}
+	else
+	{
+		in_use = false;
+		return sol::state();
+	}
+}
+
+void LuaArenaAllocator::step_gc(sol::state& st)
+{
+	size_t volume;
+
+	if (in_use)
+	{
+		volume = allocated_since_step;
+		allocated_since_step = 0;
+	}
+	else
+	{
+		size_t now = get_heap_size(st);
+		volume = now > last_step_memory ? now - last_step_memory : 0;
+		last_step_memory = now;
+	}
+
+	// LUA_GCSTEP takes kilobytes. The collector does as much work as if
+	// that much memory had been allocated
+	int kb = (int)(volume / 1024);
+	if (kb > 0)
+	{
+		lua_gc(st.lua_state(), LUA_GCSTEP, kb);
+	}
+
+	if (!in_use)
+	{
+		last_step_memory = get_heap_size(st);
+	}
+}
+
+size_t LuaArenaAllocator::get_heap_size(sol::state& st)
+{
+	return st.memory_used();
+}
+
+LuaArenaAllocator::LuaArenaAllocator()
+{
+	free_lists.fill(nullptr);
+	chunk_used = 0;
+	in_use = false;
+	allocated_since_step = 0;
+	last_step_memory = 0;
+	used = 0;
+	reserved = 0;
+}
+
+LuaArenaAllocator::~LuaArenaAllocator()
+{
+	for (char* chunk : chunks)
+	{
+		free(chunk);
+	}
+
+	// Big blocks are freed by lua when the state closes
+}
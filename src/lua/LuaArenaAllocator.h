@@ -0,0 +1,82 @@
+#pragma once
+#include <sol.hpp>
+#include <vector>
+#include <array>
+
+// A lua_Alloc for lua states that are only used from a single thread
+// and allocate lots of small, short lived objects (terrain generation).
+// Small blocks are carved out of big chunks and recycled through per
+// size-class free lists, so no locking or calls to malloc happen
+// in the common case. Big blocks go directly to malloc.
+//
+// Chunks are only returned to the system when the allocator is destroyed,
+// so the state using it must be destroyed first!
+//
+// LuaJIT does not support custom allocators on x64 unless built with
+// GC64, so make_state falls back to a normal state when not supported.
+class LuaArenaAllocator
+{
+public:
+
+	static constexpr size_t CLASS_SIZE = 16;
+	static constexpr size_t CLASS_COUNT = 16;
+	// Biggest size that goes to the free lists, 256 bytes
+	static constexpr size_t MAX_SMALL_SIZE = CLASS_SIZE * CLASS_COUNT;
+	static constexpr size_t CHUNK_SIZE = 256 * 1024;
+
+private:
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	std::array<FreeBlock*, CLASS_COUNT> free_lists;
+	std::vector<char*> chunks;
+	size_t chunk_used;
+
+	// Only used when this allocator is actually in use by the state
+	bool in_use;
+
+	// Total bytes handed to lua since the last GC step
+	size_t allocated_since_step;
+	// Memory as reported by lua on the last GC step, used for
+	// pacing if the allocator is not in use
+	size_t last_step_memory;
+
+	void* alloc_small(size_t cl);
+	void free_small(void* ptr, size_t cl);
+
+	static size_t get_class(size_t size) { return (size - 1) / CLASS_SIZE; }
+
+public:
+
+	// Bytes currently handed to lua
+	size_t used;
+	// Bytes held by the allocator (chunks and big blocks)
+	size_t reserved;
+
+	void* realloc(void* ptr, size_t osize, size_t nsize);
+
+	static void* lua_alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+	// Returns true if lua_newstate with a custom allocator works
+	// on this build of LuaJIT (Checked once)
+	static bool is_supported();
+
+	// Creates a state using this allocator, if possible
+	sol::state make_state();
+
+	// Runs an incremental GC step sized to the memory allocated since
+	// the last call, instead of a full collection. Call it after each
+	// unit of work (ie. a tile)
+	void step_gc(sol::state& st);
+
+	// Heap size as seen by lua, valid even if the allocator is not in use
+	static size_t get_heap_size(sol::state& st);
+
+	LuaArenaAllocator();
+	~LuaArenaAllocator();
+	LuaArenaAllocator(const LuaArenaAllocator&) = delete;
+	LuaArenaAllocator& operator=(const LuaArenaAllocator&) = delete;
+};
@@ -0,0 +1,150 @@
+#include "LuaBytecodeCache.h"
+#include <util/Logger.h>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+static int bytecode_writer(lua_State* L, const void* p, size_t sz, void* ud)
+{
+	std::string* out = (std::string*)ud;
+	out->append((const char*)p, sz);
+	return 0;
+}
+
+// Identifies our persisted files, followed by the source hash
+static const char PERSIST_MAGIC[8] = { 'O', 'S', 'P', 'L', 'U', 'A', 'B', '1' };
+
+uint64_t LuaBytecodeCache::hash(const std::string& str)
+{
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for (char c : str)
+	{
+		h ^= (uint64_t)(unsigned char)c;
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
+
+std::string LuaBytecodeCache::get_persist_file(const std::string& path)
+{
+	return persist_path + fmt::format("{:016x}.luac", hash(path));
+}
+
+bool LuaBytecodeCache::read_persisted(const std::string& path, uint64_t hash, Entry& out)
+{
+	std::ifstream file(get_persist_file(path), std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	char magic[sizeof(PERSIST_MAGIC)];
+	uint64_t file_hash;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&file_hash, sizeof(file_hash));
+
+	if (!file || memcmp(magic, PERSIST_MAGIC, sizeof(magic)) != 0 || file_hash != hash)
+	{
+		return false;
+	}
+
+	out.hash = hash;
+	out.bytecode.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !out.bytecode.empty();
+}
+
+void LuaBytecodeCache::write_persisted(const std::string& path, const Entry& entry)
+{
+	std::ofstream file(get_persist_file(path), std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		logger->warn("Could not write lua bytecode cache for {}", path);
+		return;
+	}
+
+	file.write(PERSIST_MAGIC, sizeof(PERSIST_MAGIC));
+	file.write((const char*)&entry.hash, sizeof(entry.hash));
+	file.write(entry.bytecode.data(), entry.bytecode.size());
+}
+
+int LuaBytecodeCache::load(lua_State* L, const std::string& source, const std::string& path)
+{
+	uint64_t h = hash(source);
+	std::string chunk_name = "@" + path;
+
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+
+		auto it = entries.find(path);
+		if ((it == entries.end() || it->second.hash != h) && !persist_path.empty())
+		{
+			Entry persisted;
+			if (read_persisted(path, h, persisted))
+			{
+				it = entries.insert_or_assign(path, std::move(persisted)).first;
+			}
+		}
+
+		if (it != entries.end() && it->second.hash == h)
+		{
+			const std::string& bc = it->second.bytecode;
+			if (luaL_loadbuffer(L, bc.data(), bc.size(), chunk_name.c_str()) == 0)
+			{
+				hits++;
+				return 0;
+			}
+
+			// Not loadable by this LuaJIT, compile it again
+			lua_pop(L, 1);
+			entries.erase(it);
+		}
+
+		misses++;
+	}
+
+	int status = luaL_loadbuffer(L, source.data(), source.size(), chunk_name.c_str());
+	if (status != 0)
+	{
+		// Scripts with errors are not cached
+		return status;
+	}
+
+	Entry entry;
+	entry.hash = h;
+	lua_dump(L, bytecode_writer, &entry.bytecode);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	if (!persist_path.empty())
+	{
+		write_persisted(path, entry);
+	}
+
+	entries.insert_or_assign(path, std::move(entry));
+
+	return 0;
+}
+
+void LuaBytecodeCache::set_persist_path(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	persist_path = path;
+	if (!persist_path.empty())
+	{
+		std::error_code err;
+		std::filesystem::create_directories(persist_path, err);
+		if (err)
+		{
+			logger->warn("Could not create lua bytecode cache folder ({}), not persisting", persist_path);
+			persist_path = "";
+		}
+	}
+}
+
+LuaBytecodeCache::LuaBytecodeCache()
+{
+	hits = 0;
+	misses = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <sol.hpp>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+// Keeps the compiled bytecode of lua scripts, so loading the same script
+// many times (machines, terrain workers, require...) only compiles it once.
+// Entries are keyed by path, and only used if the hash of the source matches,
+// so editing a script invalidates its entry.
+//
+// Optionally, entries are persisted to a folder (in udata), so they survive
+// restarts. Bytecode which fails to load (for example, from another LuaJIT
+// build) is simply discarded and compiled again.
+//
+// Thread safe.
+class LuaBytecodeCache
+{
+private:
+
+	struct Entry
+	{
+		uint64_t hash;
+		std::string bytecode;
+	};
+
+	std::mutex mtx;
+	std::unordered_map<std::string, Entry> entries;
+
+	// Empty if not persisting
+	std::string persist_path;
+
+	std::string get_persist_file(const std::string& path);
+	bool read_persisted(const std::string& path, uint64_t hash, Entry& out);
+	void write_persisted(const std::string& path, const Entry& entry);
+
+public:
+
+	size_t hits;
+	size_t misses;
+
+	// Same as luaL_loadbuffer, pushes the compiled chunk (or the error message)
+	// to the stack and returns 0 on success. Path is used as the chunk name
+	int load(lua_State* L, const std::string& source, const std::string& path);
+
+	// Folder where the bytecode is persisted, it will be created if
+	// not present. Empty disables persisting
+	void set_persist_path(const std::string& path);
+
+	static uint64_t hash(const std::string& str);
+
+	LuaBytecodeCache();
+};
@@ -1,5 +1,6 @@
 #include "LuaCore.h"
 #include <assets/AssetManager.h>
+#include <mutex>
 
 #include "libs/LuaLogger.h"
 #include "libs/LuaGlm.h"
@@ -15,8 +16,14 @@
 
 LuaCore* lua_core;
 
+// Scripts may require from the update threads, each on its own state, 
+// but the libraries, assets and cache they go through are global
+static std::mutex require_mtx;
+
 int LoadFileRequire(lua_State* L) 
 {
+	std::lock_guard<std::mutex> lock(require_mtx);
+
 	sol::state_view sview = sol::state_view(L);
 
 	std::string path = sol::stack::get<std::string>(L, 1);
@@ -56,7 +63,8 @@ int LoadFileRequire(lua_State* L)
 		{
 			std::string file = assets->load_string_raw(resolved);
 
-			luaL_loadbuffer(L, file.data(), file.size(), file.c_str());
+			// Pushes the chunk, or the error message, which is what require expects
+			lua_core->bytecode_cache.load(L, file, resolved);
 
 			return 1;
 		}
@@ -145,8 +153,30 @@ void LuaCore::load(sol::state& to, const std::string& pkg)
 
 }
 
+sol::protected_function_result LuaCore::run_script(sol::state_view st, const std::string& source, 
+	const std::string& path, sol::environment* env)
+{
+	lua_State* L = st.lua_state();
+
+	if(bytecode_cache.load(L, source, path) != 0)
+	{
+		// Returns the error message as an invalid result
+		return sol::protected_function_result(L, lua_gettop(L), 1, 1, sol::call_status::syntax);
+	}
+
+	sol::protected_function fnc = sol::stack::pop<sol::protected_function>(L);
+	if(env)
+	{
+		sol::set_environment(*env, fnc);
+	}
+
+	return fnc();
+}
+
 LuaCore::LuaCore()
 {
+	share_vehicle_states = false;
+
 	libraries[LibraryID::UNKNOWN] = nullptr;
 	libraries[LibraryID::LOGGER] = new LuaLogger();
 	libraries[LibraryID::DEBUG_DRAWER] = new LuaDebugDrawer();
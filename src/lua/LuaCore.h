@@ -1,5 +1,6 @@
 #pragma once
 #include "LuaLib.h"
+#include "LuaBytecodeCache.h"
 
 /*
 	global:
@@ -45,6 +46,19 @@ public:
 
 	LuaLib* libraries[LibraryID::COUNT];
 
+	// If true, machines of a vehicle from the same package share a single
+	// lua state, each running in its own environment (see SharedLuaState)
+	// Set by the "lua.share_vehicle_states" setting
+	bool share_vehicle_states;
+
+	// Used for all script loading (require, AssetManager::load_script...)
+	LuaBytecodeCache bytecode_cache;
+
+	// Loads the script through the bytecode cache and runs it in the given
+	// environment (or the globals if not given), returns the script's result
+	sol::protected_function_result run_script(sol::state_view st, const std::string& source, 
+		const std::string& path, sol::environment* env = nullptr);
+
 	void load_library(sol::table& to, LibraryID id);
 
 	// pkg is the package the lua file is in, this is used by the 
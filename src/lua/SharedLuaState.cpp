@@ -0,0 +1,18 @@
+#include "SharedLuaState.h"
+#include "LuaCore.h"
+
+sol::environment SharedLuaState::create_environment()
+{
+	return sol::environment(lua_state, sol::create, lua_state.globals());
+}
+
+size_t SharedLuaState::get_memory()
+{
+	return lua_state.memory_used();
+}
+
+SharedLuaState::SharedLuaState(const std::string& pkg)
+{
+	this->pkg = pkg;
+	lua_core->load(lua_state, pkg);
+}
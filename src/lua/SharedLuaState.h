@@ -0,0 +1,25 @@
+#pragma once
+#include <sol.hpp>
+#include <string>
+
+// A lua state shared by many scripts of the same package, each one
+// running in its own environment so their globals don't collide.
+// Libraries (and their usertypes) are only loaded once per state,
+// instead of once per script, which saves a lot of memory.
+// Note that modules loaded with require are shared by all scripts
+// in the state.
+class SharedLuaState
+{
+public:
+
+	sol::state lua_state;
+	std::string pkg;
+
+	// Globals which are not found in the environment are
+	// taken from the state's globals
+	sol::environment create_environment();
+
+	size_t get_memory();
+
+	SharedLuaState(const std::string& pkg);
+};
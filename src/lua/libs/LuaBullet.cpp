@@ -8,6 +8,7 @@
 
 #include <glm/glm.hpp>
 #include "../../physics/glm/BulletGlmCompat.h"
+#include "../../universe/vehicle/VehicleCommandBuffer.h"
 
 void LuaBullet::load_to(sol::table& table)
 {
@@ -46,7 +47,7 @@ void LuaBullet::load_to(sol::table& table)
 		},
 		"translate", [](btRigidBody& self, glm::dvec3& trans)
 		{
-			self.translate(to_btVector3(trans));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::TRANSLATE, &self, to_btVector3(trans));
 		},
 		"get_velocity_in_local_point", [](btRigidBody& self, glm::dvec3& point)
 		{
@@ -54,11 +55,11 @@ void LuaBullet::load_to(sol::table& table)
 		},
 		"set_linear_velocity", [](btRigidBody& self, glm::dvec3& vel)
 		{
-			self.setLinearVelocity(to_btVector3(vel));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::SET_LINEAR_VELOCITY, &self, to_btVector3(vel));
 		},
 		"set_angular_velocity", [](btRigidBody& self, glm::dvec3& vel)
 		{
-			self.setAngularVelocity(to_btVector3(vel));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::SET_ANGULAR_VELOCITY, &self, to_btVector3(vel));
 		},
 		"get_linear_velocity", [](btRigidBody& self)
 		{
@@ -81,34 +82,39 @@ void LuaBullet::load_to(sol::table& table)
 			return to_dvec3(self.getCenterOfMassPosition());
 		},
 		"update_inertia_tensor", &btRigidBody::updateInertiaTensor,
-		"clear_forces", &btRigidBody::clearForces,
+		"clear_forces", [](btRigidBody& self)
+		{
+			VehicleCommandBuffer::run(VehicleCommandBuffer::CLEAR_FORCES, &self);
+		},
 		"apply_torque_impulse", [](btRigidBody& self, glm::dvec3& torque)
 		{
-			self.applyTorqueImpulse(to_btVector3(torque));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_TORQUE_IMPULSE, &self, to_btVector3(torque));
 		},
 		"apply_torque", [](btRigidBody& self, glm::dvec3& torque)
 		{
-			self.applyTorque(to_btVector3(torque));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_TORQUE, &self, to_btVector3(torque));
 		},
 		"apply_force", [](btRigidBody& self, glm::dvec3& force, glm::dvec3& rel_pos)
 		{
-			self.applyForce(to_btVector3(force), to_btVector3(rel_pos));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_FORCE, &self, to_btVector3(force), to_btVector3(rel_pos));
 		},
 		"apply_central_impulse", [](btRigidBody& self, glm::dvec3 force)
 		{
-			self.applyCentralImpulse(to_btVector3(force));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_CENTRAL_IMPULSE, &self, to_btVector3(force));
 		},
 		"apply_impulse", [](btRigidBody& self, glm::dvec3& imp, glm::dvec3& rel_pos)
 		{
-			self.applyImpulse(to_btVector3(imp), to_btVector3(rel_pos));
+			VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_IMPULSE, &self, to_btVector3(imp), to_btVector3(rel_pos));
 		},
 		"add_to_world", [](btRigidBody* self, btDynamicsWorld& world)
 		{
-			world.addRigidBody(self);
+			btDynamicsWorld* world_ptr = &world;
+			VehicleCommandBuffer::run_world_change([self, world_ptr](){ world_ptr->addRigidBody(self); });
 		},
 		"remove_from_world", [](btRigidBody* self, btDynamicsWorld& world)
 		{
-			world.removeRigidBody(self);
+			btDynamicsWorld* world_ptr = &world;
+			VehicleCommandBuffer::run_world_change([self, world_ptr](){ world_ptr->removeRigidBody(self); });
 		}
 
 	);
@@ -121,11 +127,16 @@ void LuaBullet::load_to(sol::table& table)
 		"set_breaking_impulse_threshold", &btTypedConstraint::setBreakingImpulseThreshold,
 		"add_to_world", [](btTypedConstraint* self, btDynamicsWorld& world, bool disable_self_collision = false)
 		{
-			world.addConstraint(self, disable_self_collision);
+			btDynamicsWorld* world_ptr = &world;
+			VehicleCommandBuffer::run_world_change([self, world_ptr, disable_self_collision]()
+			{ 
+				world_ptr->addConstraint(self, disable_self_collision); 
+			});
 		},
 		"remove_from_world", [](btTypedConstraint* self, btDynamicsWorld& world)
 		{
-			world.removeConstraint(self);
+			btDynamicsWorld* world_ptr = &world;
+			VehicleCommandBuffer::run_world_change([self, world_ptr](){ world_ptr->removeConstraint(self); });
 		},
 		"is_enabled", &btTypedConstraint::isEnabled,
 		"set_enabled", &btTypedConstraint::setEnabled,
@@ -11,7 +11,7 @@ void LuaUniverse::load_to(sol::table& table)
 		{
 			LuaEventHandler ev = LuaEventHandler();
 
-			ev.event_id = event_id;
+			ev.event_id = hash_event_id(event_id);
 
 			EventHandlerFnc wrapper = [](EventArguments& vec, const void* udata)
 			{
@@ -41,7 +41,7 @@ void LuaUniverse::load_to(sol::table& table)
 				any_vec.push_back(EventArgument(v));
 			}
 
-			self->emit_event(event_id, any_vec);	
+			self->emit_event(event_id, std::move(any_vec));	
 		}	
 	);
 }
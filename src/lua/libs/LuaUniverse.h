@@ -8,7 +8,7 @@ struct LuaEventHandler
 {
 	Universe* universe;
 	EventHandler handler;
-	std::string event_id;
+	EventId event_id;
 	sol::reference* ref;
 
 	bool signed_up;
@@ -19,7 +19,13 @@ struct LuaEventHandler
 		{
 			signed_up = false;
 			universe->drop_out_of_event(event_id, handler);
-			delete ref;
+			// During the parallel update dropping out is deferred, and the
+			// handler may still be called until then
+			sol::reference* del_ref = ref;
+			VehicleCommandBuffer::run_deferred([del_ref]()
+			{
+				delete del_ref;
+			});
 		}
 	}
 
@@ -53,7 +53,8 @@ void LuaVehicle::load_to(sol::table& table)
 		"get_marker_rotation", &Piece::get_marker_rotation,
 		"get_marker_transform", &Piece::get_marker_transform,
 		"get_marker_forward", &Piece::get_marker_forward,
-		"transform_point_to_rigidbody", &Piece::transform_point_to_rigidbody);
+		"transform_point_to_rigidbody", &Piece::transform_point_to_rigidbody,
+		"apply_force", &Piece::apply_force);
 
 	table.new_usertype<Part>("part",
 		"get_piece", &Part::get_piece,
@@ -73,7 +74,7 @@ void LuaVehicle::load_to(sol::table& table)
 		// TODO: Maybe there is a more efficient way to handle this?
 		"call", [](Machine& self, const std::string& fname, sol::variadic_args args)
 		{
-			auto result = LuaUtil::safe_call_function(self.lua_state, fname, "machine->machine call", args);	
+			auto result = LuaUtil::safe_call_function(self.env, fname, "machine->machine call", args);	
 			// safe_call_function only returns valid results so
 			sol::reference as_ref = result;
 			return as_ref;
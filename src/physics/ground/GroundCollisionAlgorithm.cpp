@@ -0,0 +1,178 @@
+#include "GroundCollisionAlgorithm.h"
+#include "GroundShape.h"
+
+#include <imgui/imgui.h>
+
+void GroundCollisionStats::next_tick()
+{
+	last_skipped = skipped.exchange(0);
+	last_processed = processed.exchange(0);
+}
+
+void GroundCollisionStats::do_imgui()
+{
+	ImGui::Text("Ground pairs skipped: %i", (int)last_skipped);
+	ImGui::Text("Ground pairs processed: %i", (int)last_processed);
+}
+
+GroundCollisionStats::GroundCollisionStats()
+{
+	skipped = 0;
+	processed = 0;
+	last_skipped = 0;
+	last_processed = 0;
+}
+
+bool GroundCollisionAlgorithm::may_touch(const btCollisionObjectWrapper* ground_wrap, const btCollisionObjectWrapper* other_wrap)
+{
+	const GroundShape* ground = (const GroundShape*)ground_wrap->getCollisionShape();
+
+	btVector3 aabb_min, aabb_max;
+	other_wrap->getCollisionShape()->getAabb(other_wrap->getWorldTransform(), aabb_min, aabb_max);
+
+	// In planet coordinates, as the height query
+	glm::dvec3 center = to_dvec3(ground_wrap->getWorldTransform().invXform((aabb_min + aabb_max) * 0.5));
+	double extent = (aabb_max - aabb_min).length() * 0.5;
+	double dist = glm::length(center);
+	double bottom = dist - extent - ground->getMargin();
+
+	if(bottom > ground->get_max_radius())
+	{
+		return false;
+	}
+
+	if(!height_valid || glm::distance(center / dist, height_pos / glm::length(height_pos)) * dist > HEIGHT_CACHE_DISTANCE)
+	{
+		height = ground->get_height(center);
+		height_pos = center;
+		height_valid = true;
+	}
+
+	// The object may be over a slope, the terrain under its sides (or anywhere
+	// around the cached point) can be higher
+	double clearance = bottom - (ground->get_radius() + height);
+	return clearance <= extent + HEIGHT_CACHE_DISTANCE + HEIGHT_SAFETY_MARGIN;
+}
+
+void GroundCollisionAlgorithm::destroy_wrapped()
+{
+	if(wrapped != nullptr)
+	{
+		wrapped->~btCollisionAlgorithm();
+		m_dispatcher->freeCollisionAlgorithm(wrapped);
+		wrapped = nullptr;
+	}
+}
+
+void GroundCollisionAlgorithm::processCollision(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap,
+	const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut)
+{
+	const btCollisionObjectWrapper* ground_wrap = ground_is_0 ? body0Wrap : body1Wrap;
+	const btCollisionObjectWrapper* other_wrap = ground_is_0 ? body1Wrap : body0Wrap;
+
+	bool touch = may_touch(ground_wrap, other_wrap);
+
+	// Children of compounds have a parent wrapper
+	if(other_wrap->m_parent == nullptr)
+	{
+		if(touch)
+		{
+			stats->processed++;
+		}
+		else
+		{
+			stats->skipped++;
+		}
+	}
+
+	if(!touch)
+	{
+		// Drops the old contacts too
+		destroy_wrapped();
+		return;
+	}
+
+	if(wrapped == nullptr)
+	{
+		btCollisionAlgorithmConstructionInfo ci = btCollisionAlgorithmConstructionInfo(m_dispatcher, 0);
+		ci.m_manifold = shared_manifold;
+		wrapped = wrapped_func->CreateCollisionAlgorithm(ci, body0Wrap, body1Wrap);
+	}
+
+	wrapped->processCollision(body0Wrap, body1Wrap, dispatchInfo, resultOut);
+}
+
+btScalar GroundCollisionAlgorithm::calculateTimeOfImpact(btCollisionObject* body0, btCollisionObject* body1,
+	const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut)
+{
+	if(wrapped == nullptr)
+	{
+		return btScalar(1.0);
+	}
+
+	return wrapped->calculateTimeOfImpact(body0, body1, dispatchInfo, resultOut);
+}
+
+void GroundCollisionAlgorithm::getAllContactManifolds(btManifoldArray& manifoldArray)
+{
+	if(wrapped != nullptr)
+	{
+		wrapped->getAllContactManifolds(manifoldArray);
+	}
+}
+
+GroundCollisionAlgorithm::GroundCollisionAlgorithm(const btCollisionAlgorithmConstructionInfo& ci,
+	btCollisionAlgorithmCreateFunc* wrapped_func, bool ground_is_0, GroundCollisionStats* stats)
+	: btCollisionAlgorithm(ci)
+{
+	this->wrapped_func = wrapped_func;
+	this->wrapped = nullptr;
+	this->shared_manifold = ci.m_manifold;
+	this->ground_is_0 = ground_is_0;
+	this->stats = stats;
+	this->height_valid = false;
+	this->height = 0.0;
+}
+
+GroundCollisionAlgorithm::~GroundCollisionAlgorithm()
+{
+	destroy_wrapped();
+}
+
+btCollisionAlgorithm* GroundCollisionAlgorithm::CreateFunc::CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci,
+	const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap)
+{
+	const btCollisionShape* shape0 = body0Wrap->getCollisionShape();
+	const btCollisionShape* shape1 = body1Wrap->getCollisionShape();
+
+	btCollisionAlgorithmCreateFunc* wrapped_func =
+		config->getCollisionAlgorithmCreateFunc(shape0->getShapeType(), shape1->getShapeType());
+
+	bool ground0 = dynamic_cast<const GroundShape*>(shape0) != nullptr;
+	bool ground1 = dynamic_cast<const GroundShape*>(shape1) != nullptr;
+
+	// Not a ground (or two of them, which never collide)
+	if(ground0 == ground1)
+	{
+		return wrapped_func->CreateCollisionAlgorithm(ci, body0Wrap, body1Wrap);
+	}
+
+	void* mem = ci.m_dispatcher1->allocateCollisionAlgorithm(sizeof(GroundCollisionAlgorithm));
+	return new(mem) GroundCollisionAlgorithm(ci, wrapped_func, ground0, stats);
+}
+
+GroundCollisionAlgorithm::CreateFunc::CreateFunc(btCollisionConfiguration* config, GroundCollisionStats* stats)
+{
+	this->config = config;
+	this->stats = stats;
+}
+
+void GroundCollisionAlgorithm::register_on(btCollisionDispatcher* dispatcher, CreateFunc* func)
+{
+	// GroundShape uses this type, see its constructor
+	for(int i = 0; i < MAX_BROADPHASE_COLLISION_TYPES; i++)
+	{
+		dispatcher->registerCollisionCreateFunc(TRIANGLE_MESH_SHAPE_PROXYTYPE, i, func);
+		dispatcher->registerCollisionCreateFunc(i, TRIANGLE_MESH_SHAPE_PROXYTYPE, func);
+	}
+}
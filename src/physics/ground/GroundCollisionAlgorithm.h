@@ -0,0 +1,97 @@
+#pragma once
+
+#pragma warning(push, 0)
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionDispatch/btCollisionCreateFunc.h>
+#include <BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h>
+#pragma warning(pop)
+
+#include <glm/glm.hpp>
+#include <atomic>
+
+// Pairs of a planet ground against a vehicle (or anything else), counted per
+// tick. Dispatchers may run on many threads, so counters are atomic
+struct GroundCollisionStats
+{
+	// Pairs far enough from the ground to not generate any triangle
+	std::atomic<size_t> skipped;
+	// Pairs which went to the bullet algorithm
+	std::atomic<size_t> processed;
+
+	// Counts of the last tick
+	size_t last_skipped;
+	size_t last_processed;
+
+	// Call once before every tick
+	void next_tick();
+
+	void do_imgui();
+
+	GroundCollisionStats();
+};
+
+// The AABB of a GroundShape covers the whole planet, so the broadphase always
+// reports the pairs of the ground with anything in its SOI. This wraps the
+// algorithm bullet uses for them (convex-concave, compound...) and only
+// lets it run (and generate triangles) if the object may be touching the ground:
+//	- The object is below the highest possible terrain (no cost)
+//	- The object is close to the terrain right below it (surface height query,
+//	  kept while the object doesn't move much over the surface)
+// The wrapped algorithm, and its contact manifold, are destroyed while
+// the object is far from the ground.
+// Compound children go through this too, only top level pairs are counted.
+// Other concave shapes share the proxy type of GroundShape, they get the
+// algorithm bullet would use
+class GroundCollisionAlgorithm : public btCollisionAlgorithm
+{
+private:
+
+	// Horizontal distance moved over the surface before querying its height again
+	static constexpr double HEIGHT_CACHE_DISTANCE = 25.0;
+	// Extra clearance over the queried height, the terrain may be
+	// higher around the point right below the object
+	static constexpr double HEIGHT_SAFETY_MARGIN = 10.0;
+
+	btCollisionAlgorithmCreateFunc* wrapped_func;
+	btCollisionAlgorithm* wrapped;
+	btPersistentManifold* shared_manifold;
+
+	bool ground_is_0;
+	GroundCollisionStats* stats;
+
+	bool height_valid;
+	glm::dvec3 height_pos;
+	double height;
+
+	bool may_touch(const btCollisionObjectWrapper* ground_wrap, const btCollisionObjectWrapper* other_wrap);
+	void destroy_wrapped();
+
+public:
+
+	struct CreateFunc : public btCollisionAlgorithmCreateFunc
+	{
+		btCollisionConfiguration* config;
+		GroundCollisionStats* stats;
+
+		virtual btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci,
+			const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap) override;
+
+		CreateFunc(btCollisionConfiguration* config, GroundCollisionStats* stats);
+	};
+
+	// Replaces the algorithms of the dispatcher for all pairs with the ground
+	// proxy type. func must outlive the dispatcher
+	static void register_on(btCollisionDispatcher* dispatcher, CreateFunc* func);
+
+	virtual void processCollision(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap,
+		const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut) override;
+
+	virtual btScalar calculateTimeOfImpact(btCollisionObject* body0, btCollisionObject* body1,
+		const btDispatcherInfo& dispatchInfo, btManifoldResult* resultOut) override;
+
+	virtual void getAllContactManifolds(btManifoldArray& manifoldArray) override;
+
+	GroundCollisionAlgorithm(const btCollisionAlgorithmConstructionInfo& ci, btCollisionAlgorithmCreateFunc* wrapped_func,
+		bool ground_is_0, GroundCollisionStats* stats);
+	virtual ~GroundCollisionAlgorithm();
+};
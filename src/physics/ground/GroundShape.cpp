@@ -5,7 +5,7 @@
 void GroundShape::getAabb(const btTransform& t, btVector3& aabbMin, btVector3& aabbMax) const
 {
 	btVector3 trans = t.getOrigin();
-	double s = body->config.radius + body->config.surface.max_height * 1.1;
+	double s = get_max_radius();
 	btVector3 size = btVector3(s, s, s);
 
 	aabbMin = trans - size;
@@ -23,6 +23,7 @@ void GroundShape::processAllTriangles(btTriangleCallback* callback, const btVect
 	if (aabb_b0 == debug_b0 && aabb_b1 == debug_b1)
 	{
 		// We draw all loaded tiles
+		std::lock_guard<std::mutex> lock(server->mtx);
 		for (auto it = server->cache.begin(); it != server->cache.end(); it++)
 		{
 			btVector3* verts = it->second->verts;
@@ -113,6 +114,21 @@ void GroundShape::processAllTriangles(btTriangleCallback* callback, const btVect
 	}
 }
 
+double GroundShape::get_radius() const
+{
+	return body->config.radius;
+}
+
+double GroundShape::get_max_radius() const
+{
+	return body->config.radius + body->config.surface.max_height * 1.1;
+}
+
+double GroundShape::get_height(glm::dvec3 dir) const
+{
+	return server->get_height(dir);
+}
+
 GroundShape::GroundShape(PlanetaryBody* body)
 {
 	this->body = body;
@@ -43,6 +43,12 @@ public:
 
 	virtual const char*	getName() const { return "PROCTERRAIN"; }
 
+	double get_radius() const;
+	// No terrain goes above this (from the center of the body)
+	double get_max_radius() const;
+	// See GroundShapeServer::get_height, dir is in our local coordinates
+	double get_height(glm::dvec3 dir) const;
+
 	GroundShape(PlanetaryBody* body);
 	~GroundShape();
 };
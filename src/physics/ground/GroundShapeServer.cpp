@@ -1,4 +1,5 @@
 #include "GroundShapeServer.h"
+#include <util/MathUtil.h>
 
 
 
@@ -7,9 +8,12 @@ btVector3* GroundShapeServer::query(QuadTreeNode* node, double time)
 {
 	PlanetTilePath path = PlanetTilePath(node->get_path(), node->planetside);
 
-	if (cache.find(path) != cache.end())
+	std::lock_guard<std::mutex> lock(mtx);
+
+	auto it = cache.find(path);
+	if (it != cache.end())
 	{
-		return &cache[path]->verts[0];
+		return &it->second->verts[0];
 	}
 	else
 	{
@@ -21,7 +25,34 @@ btVector3* GroundShapeServer::query(QuadTreeNode* node, double time)
 	}
 }
 
-GroundShapeServer::GroundShapeServer(PlanetaryBody* body)
+double GroundShapeServer::get_height(glm::dvec3 dir)
+{
+	// The generator always works in batches
+	std::array<PlanetTile::GeneratorInfo, 1> info;
+	std::array<PlanetTile::GeneratorOut, 1> out;
+
+	glm::dvec3 sphere = glm::normalize(dir);
+	info[0].coord_3d = sphere;
+	info[0].coord_2d = MathUtil::euclidean_to_spherical_r1(sphere);
+	// Same detail as the physics tiles
+	info[0].depth = (int)(body->config.surface.max_depth + PlanetTile::PHYSICS_GRAPHICS_RELATION - 1);
+	info[0].radius = body->config.radius;
+	info[0].needs_color = false;
+	out[0].height = body->config.surface.max_height;
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	sol::protected_function func = lua["generate"];
+	auto result = func(std::ref(info), std::ref(out));
+	if(!result.valid())
+	{
+		return body->config.surface.max_height;
+	}
+
+	return out[0].height;
+}
+
+GroundShapeServer::GroundShapeServer(PlanetaryBody* body) : lua(allocator.make_state())
 {
 	this->body = body;
 
@@ -48,6 +79,7 @@ GroundShapeServer::TileAndTriangles::TileAndTriangles(PlanetTilePath npath, doub
 	double planet_radius = server->body->config.radius + growth;
 
 	PlanetTile::generate_physics(npath, server->body->config.radius, server->lua, &server->work_array);
+	server->allocator.step_gc(server->lua);
 
 	glm::dmat4 model = glm::dmat4(1.0);
 	model = glm::scale(model, glm::dvec3(planet_radius));
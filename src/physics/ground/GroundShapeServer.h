@@ -2,10 +2,12 @@
 #include <planet_mesher/quadtree/QuadTreeDefines.h>
 #include <planet_mesher/quadtree/QuadTreeNode.h>
 #include <planet_mesher/mesher/PlanetTile.h>
+#include <lua/LuaArenaAllocator.h>
 #include <universe/element/body/PlanetaryBody.h>
 #include "../glm/BulletGlmCompat.h"
 #include <glm/glm.hpp>
 #include <unordered_map>
+#include <mutex>
 
 // Handles generation of the ground shape triangles,
 // and, most importantly, caching of them using the
@@ -45,8 +47,14 @@ public:
 	
 	std::unordered_map<PlanetTilePath, TileAndTriangles*, PlanetTilePathHasher> cache;
 
+	// Bullet may query from many threads at once (multithreaded world), this
+	// guards the cache and the generator (lua state and work array)
+	std::mutex mtx;
+
 	PlanetTile::SimpleVertexArray<PlanetTile::PHYSICS_SIZE> work_array;
 
+	// Must be declared before the state, so it outlives it
+	LuaArenaAllocator allocator;
 	sol::state lua;
 
 	PlanetaryBody* body;
@@ -56,8 +64,15 @@ public:
 	void update(double pdt);
 
 	
+	// Thread safe, the returned triangles stay valid until the next update
 	btVector3* query(QuadTreeNode* node, double time = 1.0);
 
+	// Height over the radius of the terrain in direction dir (planet relative),
+	// same as the generated triangles. Thread safe, runs the surface script so it's
+	// not free, but way cheaper than generating a tile.
+	// Returns max_height if the script fails
+	double get_height(glm::dvec3 dir);
+
 	GroundShapeServer(PlanetaryBody* body);
 	~GroundShapeServer();
 };
@@ -1,5 +1,6 @@
 #include "PlanetTile.h"
 #include "../../util/Logger.h"
+#include <limits>
 
 template<int S>
 constexpr std::array<uint16_t, (S + 2) * (S + 2) * 6> get_nrm_indices()
@@ -196,12 +197,312 @@ void generate_skirt(PlanetTileVertex* target, glm::dmat4 model, glm::dmat4 inver
 	*target = vert;
 }
 
-#include <util/Timer.h>
+// SoA mesher kernels, used by generate. They work over the whole
+// (S + 2) * (S + 2) generator grid, in planet unit-sphere coordinates.
+// When built for AVX2 and FMA (see OSP_ENABLE_AVX2 on the CMakeLists) the 
+// loops process 4 doubles at a time with intrinsics, the scalar versions
+// handle the remaining elements and are used on every other build.
+// The AVX2 normals and transforms use FMA and sum in a different order, so 
+// they may differ from the scalar ones in the last bits, compare with a 
+// tolerance (see -verify on ospgl_terrain_bench).
+// The templates above are kept as the reference implementation.
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define OSP_MESHER_AVX2
+#include <immintrin.h>
+#endif
+
+// Same as MathUtil::cube_to_sphere
+static inline void cube_to_sphere(double cx, double cy, double cz, double* sx, double* sy, double* sz)
+{
+	double xsq = cx * cx;
+	double ysq = cy * cy;
+	double zsq = cz * cz;
+
+	*sx = cx * std::sqrt(1.0 - (ysq / 2.0) - (zsq / 2.0) + ((ysq * zsq) / 3.0));
+	*sy = cy * std::sqrt(1.0 - (xsq / 2.0) - (zsq / 2.0) + ((xsq * zsq) / 3.0));
+	*sz = cz * std::sqrt(1.0 - (xsq / 2.0) - (ysq / 2.0) + ((xsq * ysq) / 3.0));
+}
+
+// normalize(cross(p0 - p1, p0 - p2)) * sign
+static inline void triangle_normal(const PlanetTile::GeneratorSoA& pos, size_t p0, size_t p1, size_t p2, 
+	double sign, double* nx, double* ny, double* nz)
+{
+	double ux = pos.x[p0] - pos.x[p1], uy = pos.y[p0] - pos.y[p1], uz = pos.z[p0] - pos.z[p1];
+	double vx = pos.x[p0] - pos.x[p2], vy = pos.y[p0] - pos.y[p2], vz = pos.z[p0] - pos.z[p2];
+	double cx = uy * vz - uz * vy;
+	double cy = uz * vx - ux * vz;
+	double cz = ux * vy - uy * vx;
+	double il = sign / std::sqrt(cx * cx + cy * cy + cz * cz);
+	*nx = cx * il;
+	*ny = cy * il;
+	*nz = cz * il;
+}
+
+#ifdef OSP_MESHER_AVX2
+
+static inline __m256d avx_load(const std::array<double, PlanetTile::GEN_ARRAY_SIZE>& arr, size_t i)
+{
+	return _mm256_loadu_pd(&arr[i]);
+}
+
+// Same as cube_to_sphere, for one of the coordinates: 
+// c * sqrt(1 - a / 2 - b / 2 + a * b / 3), with a and b the other two squared
+static inline __m256d avx_sphere_coord(__m256d c, __m256d asq, __m256d bsq)
+{
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d three = _mm256_set1_pd(3.0);
+
+	// Not fused, and dividing by 3, so it rounds the same as the scalar version
+	// (x * 0.5 is exact, as is x / 2.0), assuming the compiler doesn't contract that one into FMAs
+	__m256d r = _mm256_sub_pd(one, _mm256_mul_pd(asq, half));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(bsq, half));
+	r = _mm256_add_pd(r, _mm256_div_pd(_mm256_mul_pd(asq, bsq), three));
+	return _mm256_mul_pd(c, _mm256_sqrt_pd(r));
+}
+
+// triangle_normal for 4 consecutive triangles
+static inline void avx_triangle_normal(const PlanetTile::GeneratorSoA& pos, size_t p0, size_t p1, size_t p2,
+	__m256d sign, PlanetTile::GeneratorSoA& out, size_t i)
+{
+	__m256d x0 = avx_load(pos.x, p0), y0 = avx_load(pos.y, p0), z0 = avx_load(pos.z, p0);
+	__m256d ux = _mm256_sub_pd(x0, avx_load(pos.x, p1));
+	__m256d uy = _mm256_sub_pd(y0, avx_load(pos.y, p1));
+	__m256d uz = _mm256_sub_pd(z0, avx_load(pos.z, p1));
+	__m256d vx = _mm256_sub_pd(x0, avx_load(pos.x, p2));
+	__m256d vy = _mm256_sub_pd(y0, avx_load(pos.y, p2));
+	__m256d vz = _mm256_sub_pd(z0, avx_load(pos.z, p2));
+
+	__m256d cx = _mm256_fmsub_pd(uy, vz, _mm256_mul_pd(uz, vy));
+	__m256d cy = _mm256_fmsub_pd(uz, vx, _mm256_mul_pd(ux, vz));
+	__m256d cz = _mm256_fmsub_pd(ux, vy, _mm256_mul_pd(uy, vx));
+
+	__m256d len2 = _mm256_fmadd_pd(cx, cx, _mm256_fmadd_pd(cy, cy, _mm256_mul_pd(cz, cz)));
+	__m256d il = _mm256_div_pd(sign, _mm256_sqrt_pd(len2));
+
+	_mm256_storeu_pd(&out.x[i], _mm256_mul_pd(cx, il));
+	_mm256_storeu_pd(&out.y[i], _mm256_mul_pd(cy, il));
+	_mm256_storeu_pd(&out.z[i], _mm256_mul_pd(cz, il));
+}
+
+#endif
+
+// Tile models are affine and tiles lie on the z = 0 plane, so every
+// point is model[3] + tx * model[0] + ty * model[1]
+template<int S>
+void kernel_sphere_positions(glm::dmat4 model, PlanetTile::GeneratorSoA& sphere)
+{
+	constexpr int W = S + 2;
+	double inv = 1.0 / ((double)S - 1.0);
+
+	for (int y = 0; y < W; y++)
+	{
+		double ty = (double)(y - 1) * inv;
+		double bx = model[3].x + ty * model[1].x;
+		double by = model[3].y + ty * model[1].y;
+		double bz = model[3].z + ty * model[1].z;
+
+		double* sx = &sphere.x[y * W];
+		double* sy = &sphere.y[y * W];
+		double* sz = &sphere.z[y * W];
+
+		int x = 0;
+#ifdef OSP_MESHER_AVX2
+		constexpr int vec_end = W - W % 4;
+		const __m256d vinv = _mm256_set1_pd(inv);
+		const __m256d vbx = _mm256_set1_pd(bx), vby = _mm256_set1_pd(by), vbz = _mm256_set1_pd(bz);
+		const __m256d mx = _mm256_set1_pd(model[0].x), my = _mm256_set1_pd(model[0].y), mz = _mm256_set1_pd(model[0].z);
+		for (; x < vec_end; x += 4)
+		{
+			__m256d tx = _mm256_mul_pd(_mm256_set_pd(x + 2, x + 1, x, x - 1), vinv);
+			__m256d cx = _mm256_fmadd_pd(tx, mx, vbx);
+			__m256d cy = _mm256_fmadd_pd(tx, my, vby);
+			__m256d cz = _mm256_fmadd_pd(tx, mz, vbz);
+			__m256d xsq = _mm256_mul_pd(cx, cx);
+			__m256d ysq = _mm256_mul_pd(cy, cy);
+			__m256d zsq = _mm256_mul_pd(cz, cz);
+
+			_mm256_storeu_pd(&sx[x], avx_sphere_coord(cx, ysq, zsq));
+			_mm256_storeu_pd(&sy[x], avx_sphere_coord(cy, xsq, zsq));
+			_mm256_storeu_pd(&sz[x], avx_sphere_coord(cz, xsq, ysq));
+		}
+#endif
+		for (; x < W; x++)
+		{
+			double tx = (double)(x - 1) * inv;
+			cube_to_sphere(bx + tx * model[0].x, by + tx * model[0].y, bz + tx * model[0].z, 
+				&sx[x], &sy[x], &sz[x]);
+		}
+	}
+}
+
+// Moves the sphere points along their normal by their height
+void kernel_displace(const PlanetTile::GeneratorSoA& sphere, const double* heights, PlanetTile::GeneratorSoA& pos)
+{
+	size_t i = 0;
+#ifdef OSP_MESHER_AVX2
+	const __m256d one = _mm256_set1_pd(1.0);
+	constexpr size_t vec_end = PlanetTile::GEN_ARRAY_SIZE - PlanetTile::GEN_ARRAY_SIZE % 4;
+	for (; i < vec_end; i += 4)
+	{
+		__m256d x = avx_load(sphere.x, i), y = avx_load(sphere.y, i), z = avx_load(sphere.z, i);
+		__m256d len = _mm256_sqrt_pd(_mm256_fmadd_pd(x, x, _mm256_fmadd_pd(y, y, _mm256_mul_pd(z, z))));
+		__m256d f = _mm256_add_pd(one, _mm256_div_pd(_mm256_loadu_pd(&heights[i]), len));
+
+		_mm256_storeu_pd(&pos.x[i], _mm256_mul_pd(x, f));
+		_mm256_storeu_pd(&pos.y[i], _mm256_mul_pd(y, f));
+		_mm256_storeu_pd(&pos.z[i], _mm256_mul_pd(z, f));
+	}
+#endif
+	for (; i < PlanetTile::GEN_ARRAY_SIZE; i++)
+	{
+		double len = std::sqrt(sphere.x[i] * sphere.x[i] + sphere.y[i] * sphere.y[i] + sphere.z[i] * sphere.z[i]);
+		double f = 1.0 + heights[i] / len;
+
+		pos.x[i] = sphere.x[i] * f;
+		pos.y[i] = sphere.y[i] * f;
+		pos.z[i] = sphere.z[i] * f;
+	}
+}
+
+// Normalized face normals of both triangles of every quad, same
+// triangles and winding as get_nrm_indices
+template<int S>
+void kernel_face_normals(const PlanetTile::GeneratorSoA& pos, PlanetTile::GeneratorSoA& face_a,
+	PlanetTile::GeneratorSoA& face_b, bool clockwise)
+{
+	constexpr int W = S + 2;
+	// Clockwise tiles swap two vertices, which flips the normal
+	double sign = clockwise ? -1.0 : 1.0;
+
+	for (int y = 0; y < W - 1; y++)
+	{
+		int x = 0;
+#ifdef OSP_MESHER_AVX2
+		const __m256d vsign = _mm256_set1_pd(sign);
+		constexpr int vec_end = (W - 1) - (W - 1) % 4;
+		for (; x < vec_end; x += 4)
+		{
+			size_t c = y * W + x;
+			// Triangle A: (right, center, bottom), triangle B: (bottom right, right, bottom)
+			avx_triangle_normal(pos, c + 1, c, c + W, vsign, face_a, c);
+			avx_triangle_normal(pos, c + W + 1, c + 1, c + W, vsign, face_b, c);
+		}
+#endif
+		for (; x < W - 1; x++)
+		{
+			size_t c = y * W + x;
+			size_t r = c + 1;
+			size_t b = c + W;
+			size_t br = c + W + 1;
+
+			// Triangle A: (right, center, bottom)
+			triangle_normal(pos, r, c, b, sign, &face_a.x[c], &face_a.y[c], &face_a.z[c]);
+			// Triangle B: (bottom right, right, bottom)
+			triangle_normal(pos, br, r, b, sign, &face_b.x[c], &face_b.y[c], &face_b.z[c]);
+		}
+	}
+}
+
+// Gathers the normals of the six triangles around every vertex of the
+// tile (border excluded), normalizes them and writes the final vertices,
+// relative to inverse_model_spheric. T must have pos and nrm members
+template<int S, typename T>
+void kernel_write_vertices(const PlanetTile::GeneratorSoA& pos, const PlanetTile::GeneratorSoA& face_a,
+	const PlanetTile::GeneratorSoA& face_b, glm::dmat4 inverse_model_spheric, T* out)
+{
+	constexpr int W = S + 2;
+	const glm::dmat4& m = inverse_model_spheric;
+
+	for (int y = 1; y < S + 1; y++)
+	{
+		int x = 1;
+#ifdef OSP_MESHER_AVX2
+		constexpr int vec_end = 1 + S - S % 4;
+		for (; x < vec_end; x += 4)
+		{
+			size_t i = y * W + x;
+			// Quads which touch these vertices, see get_nrm_indices
+			size_t left = i - 1;
+			size_t up = i - W;
+			size_t up_left = i - W - 1;
+
+			__m256d nx = _mm256_add_pd(
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_a.x, left), avx_load(face_a.x, i)), avx_load(face_a.x, up)),
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_b.x, up_left), avx_load(face_b.x, left)), avx_load(face_b.x, up)));
+			__m256d ny = _mm256_add_pd(
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_a.y, left), avx_load(face_a.y, i)), avx_load(face_a.y, up)),
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_b.y, up_left), avx_load(face_b.y, left)), avx_load(face_b.y, up)));
+			__m256d nz = _mm256_add_pd(
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_a.z, left), avx_load(face_a.z, i)), avx_load(face_a.z, up)),
+				_mm256_add_pd(_mm256_add_pd(avx_load(face_b.z, up_left), avx_load(face_b.z, left)), avx_load(face_b.z, up)));
+
+			__m256d len2 = _mm256_fmadd_pd(nx, nx, _mm256_fmadd_pd(ny, ny, _mm256_mul_pd(nz, nz)));
+			__m256d il = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(len2));
+
+			// inverse_model_spheric * (x, y, z, 1), glm matrices are column major
+			__m256d px = avx_load(pos.x, i), py = avx_load(pos.y, i), pz = avx_load(pos.z, i);
+			__m256d tx = _mm256_fmadd_pd(px, _mm256_set1_pd(m[0].x), _mm256_fmadd_pd(py, _mm256_set1_pd(m[1].x),
+				_mm256_fmadd_pd(pz, _mm256_set1_pd(m[2].x), _mm256_set1_pd(m[3].x))));
+			__m256d ty = _mm256_fmadd_pd(px, _mm256_set1_pd(m[0].y), _mm256_fmadd_pd(py, _mm256_set1_pd(m[1].y),
+				_mm256_fmadd_pd(pz, _mm256_set1_pd(m[2].y), _mm256_set1_pd(m[3].y))));
+			__m256d tz = _mm256_fmadd_pd(px, _mm256_set1_pd(m[0].z), _mm256_fmadd_pd(py, _mm256_set1_pd(m[1].z),
+				_mm256_fmadd_pd(pz, _mm256_set1_pd(m[2].z), _mm256_set1_pd(m[3].z))));
+
+			// Vertices are AoS floats, so they are written one by one
+			alignas(16) float fp[3][4];
+			alignas(16) float fn[3][4];
+			_mm_store_ps(fp[0], _mm256_cvtpd_ps(tx));
+			_mm_store_ps(fp[1], _mm256_cvtpd_ps(ty));
+			_mm_store_ps(fp[2], _mm256_cvtpd_ps(tz));
+			_mm_store_ps(fn[0], _mm256_cvtpd_ps(_mm256_mul_pd(nx, il)));
+			_mm_store_ps(fn[1], _mm256_cvtpd_ps(_mm256_mul_pd(ny, il)));
+			_mm_store_ps(fn[2], _mm256_cvtpd_ps(_mm256_mul_pd(nz, il)));
+
+			T* verts = &out[(y - 1) * S + (x - 1)];
+			for (int j = 0; j < 4; j++)
+			{
+				verts[j].pos = glm::vec3(fp[0][j], fp[1][j], fp[2][j]);
+				verts[j].nrm = glm::vec3(fn[0][j], fn[1][j], fn[2][j]);
+			}
+		}
+#endif
+		for (; x < S + 1; x++)
+		{
+			size_t i = y * W + x;
+			// Quads which touch this vertex, see get_nrm_indices
+			size_t left = i - 1;
+			size_t up = i - W;
+			size_t up_left = i - W - 1;
+
+			double nx = face_a.x[left] + face_a.x[i] + face_a.x[up] + face_b.x[up_left] + face_b.x[left] + face_b.x[up];
+			double ny = face_a.y[left] + face_a.y[i] + face_a.y[up] + face_b.y[up_left] + face_b.y[left] + face_b.y[up];
+			double nz = face_a.z[left] + face_a.z[i] + face_a.z[up] + face_b.z[up_left] + face_b.z[left] + face_b.z[up];
+
+			double il = 1.0 / std::sqrt(nx * nx + ny * ny + nz * nz);
+
+			glm::dvec4 p = m * glm::dvec4(pos.x[i], pos.y[i], pos.z[i], 1.0);
+
+			T& vert = out[(y - 1) * S + (x - 1)];
+			vert.pos = glm::vec3(p);
+			vert.nrm = glm::vec3(nx * il, ny * il, nz * il);
+		}
+	}
+}
+
+#include <chrono>
+
+// Timer uses GLFW, which is not available on headless benchmarks
+using GeneratorClock = std::chrono::steady_clock;
+
+static double seconds_since(GeneratorClock::time_point t0)
+{
+	return std::chrono::duration<double>(GeneratorClock::now() - t0).count();
+}
 
 bool PlanetTile::generate(PlanetTilePath path, double planet_radius, sol::state& lua_state, bool has_water,
-	GeneratorArrays* arrays)
+	GeneratorArrays* arrays, GeneratorTimings* timings)
 {
-	auto& work_array = arrays->work_array;
 	auto& heights = arrays->heights;
 	auto& colors = arrays->colors;
 
@@ -232,25 +533,18 @@ bool PlanetTile::generate(PlanetTilePath path, double planet_radius, sol::state&
 
 
 
+	kernel_sphere_positions<TILE_SIZE>(model, arrays->sphere);
+
 	// Initialize gen_info
 	for (int x = -1; x < TILE_SIZE + 1; x++)
 	{
 		for (int y = -1; y < TILE_SIZE + 1; y++)
 		{
+			size_t i = (y + 1) * (TILE_SIZE + 2) + (x + 1);
 
-			double tx = (double)x / ((double)TILE_SIZE - 1.0);
-			double ty = (double)y / ((double)TILE_SIZE - 1.0);
-
-			glm::dvec3 in_tile = glm::dvec3(tx, ty, 0.0);
-
-			glm::dvec3 world_pos_cubic = model * glm::dvec4(in_tile, 1.0);
-			glm::dvec3 world_pos_spheric = MathUtil::cube_to_sphere(world_pos_cubic);
-
-			glm::dvec3 sphere = world_pos_spheric;
+			glm::dvec3 sphere = glm::dvec3(arrays->sphere.x[i], arrays->sphere.y[i], arrays->sphere.z[i]);
 			glm::dvec2 projected = MathUtil::euclidean_to_spherical_r1(sphere);
 
-			size_t i = (y + 1) * (TILE_SIZE + 2) + (x + 1);
-			
 			gen_info[i].coord_3d = sphere;
 			gen_info[i].coord_2d = projected;
 			gen_info[i].depth = (int)depth;
@@ -264,9 +558,16 @@ bool PlanetTile::generate(PlanetTilePath path, double planet_radius, sol::state&
 		}
 	}
 
+	auto lua_t0 = GeneratorClock::now();
+
 	sol::protected_function func = lua_state["generate"];
 	auto result = func(std::ref(gen_info), std::ref(gen_out));
 
+	if (timings != nullptr)
+	{
+		timings->lua = seconds_since(lua_t0);
+	}
+
 	if (!result.valid())
 	{
 		sol::error err = result;
@@ -290,22 +591,38 @@ bool PlanetTile::generate(PlanetTilePath path, double planet_radius, sol::state&
 		colors[i] = (glm::vec3)gen_out[i].color;
 	}
 
-	lua_state.collect_garbage();
+	auto mesh_t0 = GeneratorClock::now();
 
-	generate_vertices<TILE_SIZE, PlanetTileVertex, false>(work_array.data(), model, inverse_model_spheric, &heights[0], &colors[0]);
-	generate_normals<TILE_SIZE>(work_array.data(), work_array.size(), model_spheric, clockwise);
-	copy_vertices<TILE_SIZE>(work_array.data(), vertices.data());
+	kernel_displace(arrays->sphere, heights.data(), arrays->pos);
+	kernel_face_normals<TILE_SIZE>(arrays->pos, arrays->face_a, arrays->face_b, clockwise);
+	kernel_write_vertices<TILE_SIZE>(arrays->pos, arrays->face_a, arrays->face_b, 
+		inverse_model_spheric, vertices.data());
+
+	for (int y = 0; y < TILE_SIZE; y++)
+	{
+		for (int x = 0; x < TILE_SIZE; x++)
+		{
+			vertices[y * TILE_SIZE + x].col = colors[(y + 1) * (TILE_SIZE + 2) + (x + 1)];
+		}
+	}
 
 	water_vertices = nullptr;
 	water_vbo = 0;
 	if (has_water && needs_water)
 	{
-		generate_vertices<TILE_SIZE, PlanetTileVertex, true>(work_array.data(), 
-				model, inverse_model_spheric, &heights[0], nullptr);
-
-		generate_normals<TILE_SIZE>(work_array.data(), work_array.size(), model_spheric, clockwise);
+		// Water is the undisplaced sphere
 		water_vertices = new std::array<PlanetTileWaterVertex, VERTEX_COUNT>();
-		copy_vertices<TILE_SIZE>(work_array.data(), water_vertices->data());
+		kernel_face_normals<TILE_SIZE>(arrays->sphere, arrays->face_a, arrays->face_b, clockwise);
+		kernel_write_vertices<TILE_SIZE>(arrays->sphere, arrays->face_a, arrays->face_b,
+			inverse_model_spheric, water_vertices->data());
+
+		for (int y = 0; y < TILE_SIZE; y++)
+		{
+			for (int x = 0; x < TILE_SIZE; x++)
+			{
+				(*water_vertices)[y * TILE_SIZE + x].depth = -(float)heights[(y + 1) * (TILE_SIZE + 2) + (x + 1)];
+			}
+		}
 	}
 
 	std::array<PlanetTileVertex, 4> skirts;
@@ -327,13 +644,44 @@ bool PlanetTile::generate(PlanetTilePath path, double planet_radius, sol::state&
 		vertices[i + TILE_SIZE * TILE_SIZE] = skirts[i];
 	}
 
+	compute_bounds(model_spheric);
+
+	if (timings != nullptr)
+	{
+		timings->mesh = seconds_since(mesh_t0);
+	}
+
 	return errors;
 
 }
 
 
+void PlanetTile::generate_reference_mesh(PlanetTilePath path, GeneratorArrays* arrays,
+	std::array<PlanetTileVertex, VERTEX_COUNT>* out, std::array<PlanetTileWaterVertex, VERTEX_COUNT>* water_out)
+{
+	auto& work_array = arrays->work_array;
+
+	glm::dmat4 model = path.get_model_matrix();
+	glm::dmat4 model_spheric = path.get_model_spheric_matrix();
+	glm::dmat4 inverse_model_spheric = glm::inverse(model_spheric);
+
+	generate_vertices<TILE_SIZE, PlanetTileVertex, false>(work_array.data(), model, inverse_model_spheric, 
+		&arrays->heights[0], &arrays->colors[0]);
+	generate_normals<TILE_SIZE>(work_array.data(), work_array.size(), model_spheric, clockwise);
+	copy_vertices<TILE_SIZE>(work_array.data(), out->data());
+
+	if (water_out != nullptr)
+	{
+		generate_vertices<TILE_SIZE, PlanetTileVertex, true>(work_array.data(), 
+				model, inverse_model_spheric, &arrays->heights[0], nullptr);
+
+		generate_normals<TILE_SIZE>(work_array.data(), work_array.size(), model_spheric, clockwise);
+		copy_vertices<TILE_SIZE>(work_array.data(), water_out->data());
+	}
+}
+
 bool PlanetTile::generate_physics(PlanetTilePath path, double planet_radius, sol::state& lua_state,
-	SimpleVertexArray<PlanetTile::PHYSICS_SIZE>* work_array)
+	SimpleVertexArray<PlanetTile::PHYSICS_SIZE>* work_array, GeneratorTimings* timings)
 {
 	bool errors = false;
 
@@ -383,8 +731,14 @@ bool PlanetTile::generate_physics(PlanetTilePath path, double planet_radius, sol
 		}
 	}
 
+	auto lua_t0 = GeneratorClock::now();
+
 	auto result = func(std::ref(info), std::ref(out));
 
+	if (timings != nullptr)
+	{
+		timings->lua = seconds_since(lua_t0);
+	}
 
 	if (!result.valid())
 	{
@@ -399,9 +753,15 @@ bool PlanetTile::generate_physics(PlanetTilePath path, double planet_radius, sol
 		heights[i] = (out[i].height) / planet_radius;
 	}
 
-	lua_state.collect_garbage();
+	auto mesh_t0 = GeneratorClock::now();
+
 	generate_vertices_simple<PlanetTileSimpleVertex>(work_array->data(), model, inverse_model_spheric, heights.data());
 
+	if (timings != nullptr)
+	{
+		timings->mesh = seconds_since(mesh_t0);
+	}
+
 	return errors;
 }
 
@@ -422,6 +782,53 @@ void PlanetTile::prepare_lua(sol::state& lua_state)
 		"color", &GeneratorOut::color);
 }
 
+void PlanetTile::compute_bounds(glm::dmat4 model_spheric)
+{
+	// Bounding box first, its center is a good enough center for the sphere
+	glm::dvec3 bmin = glm::dvec3(std::numeric_limits<double>::max());
+	glm::dvec3 bmax = glm::dvec3(-std::numeric_limits<double>::max());
+
+	for (size_t i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+	{
+		glm::dvec3 p = model_spheric * glm::dvec4(vertices[i].pos, 1.0);
+		bmin = glm::min(bmin, p);
+		bmax = glm::max(bmax, p);
+
+		if (water_vertices != nullptr)
+		{
+			glm::dvec3 wp = model_spheric * glm::dvec4((*water_vertices)[i].pos, 1.0);
+			bmin = glm::min(bmin, wp);
+			bmax = glm::max(bmax, wp);
+		}
+	}
+
+	bounds_center = (bmin + bmax) * 0.5;
+	bounds_radius = 0.0;
+
+	for (size_t i = 0; i < TILE_SIZE * TILE_SIZE; i++)
+	{
+		glm::dvec3 p = model_spheric * glm::dvec4(vertices[i].pos, 1.0);
+		bounds_radius = glm::max(bounds_radius, glm::distance(p, bounds_center));
+
+		if (water_vertices != nullptr)
+		{
+			glm::dvec3 wp = model_spheric * glm::dvec4((*water_vertices)[i].pos, 1.0);
+			bounds_radius = glm::max(bounds_radius, glm::distance(wp, bounds_center));
+		}
+	}
+}
+
+size_t PlanetTile::get_upload_size()
+{
+	size_t size = sizeof(PlanetTileVertex) * vertices.size();
+	if (water_vertices != nullptr)
+	{
+		size += sizeof(PlanetTileWaterVertex) * water_vertices->size();
+	}
+
+	return size;
+}
+
 void PlanetTile::upload()
 {
 	logger->check(!is_uploaded(), "Tried to upload an already uploaded tile");
@@ -553,6 +960,8 @@ PlanetTile::PlanetTile()
 	vbo = 0;
 	water_vbo = 0;
 	water_vertices = nullptr;
+	bounds_center = glm::dvec3(0.0);
+	bounds_radius = 0.0;
 
 }
 
@@ -55,6 +55,11 @@ struct PlanetTile
 
 	GLuint vbo, water_vbo;
 
+	// Bounding sphere of the generated surface (and water), in the planet
+	// unit-sphere space. Used for culling, skirts are not included
+	glm::dvec3 bounds_center;
+	double bounds_radius;
+
 	// Keep below ~128, for OpenGL reasons (index buffer too big)
 	static const int TILE_SIZE = 32;
 	static const size_t GEN_ARRAY_SIZE = (TILE_SIZE + 2) * (TILE_SIZE + 2);
@@ -76,27 +81,64 @@ struct PlanetTile
 	// This one is optional, so we only allocate it if needed
 	std::array<PlanetTileWaterVertex, VERTEX_COUNT>* water_vertices;
 
+	// Optional output of generate functions, in seconds
+	struct GeneratorTimings
+	{
+		// Time inside the lua "generate" function
+		double lua;
+		// Vertices, normals, skirts and bounds
+		double mesh;
+	};
+
+	// Structure of arrays over the generator grid (tile plus a border
+	// of one vertex), used by the mesher kernels
+	struct GeneratorSoA
+	{
+		std::array<double, GEN_ARRAY_SIZE> x, y, z;
+	};
+
 	struct GeneratorArrays
 	{
+		// Only used by generate_reference_mesh
 		VertexArray<PlanetTileVertex, PlanetTile::TILE_SIZE> work_array;
 		std::array<double, GEN_ARRAY_SIZE> heights;
 		std::array<glm::vec3, GEN_ARRAY_SIZE> colors;
+
+		// Points on the unit sphere, computed once per tile
+		GeneratorSoA sphere;
+		// Displaced points, in unit-sphere planet coordinates
+		GeneratorSoA pos;
+		// Face normals of the two triangles of each quad, indexed
+		// by the quad's top-left vertex
+		GeneratorSoA face_a, face_b;
 	};
 
 	// Return true if errors happened
+	// Garbage collection of the lua state is left to the caller
 	bool generate(PlanetTilePath path, double planet_radius, sol::state& lua_state, bool has_water,
-		GeneratorArrays* arrays);
+		GeneratorArrays* arrays, GeneratorTimings* timings = nullptr);
+
+	// Meshes the heights and colors left in arrays by the last call to generate
+	// using the original (non-SoA) mesher, which is slower but simpler.
+	// Used to verify the mesher kernels, water_out may be nullptr
+	void generate_reference_mesh(PlanetTilePath path, GeneratorArrays* arrays,
+		std::array<PlanetTileVertex, VERTEX_COUNT>* out, std::array<PlanetTileWaterVertex, VERTEX_COUNT>* water_out);
 
 	// Simply generates stuff to the output_array, that's it, we can be static 
 	static bool generate_physics(PlanetTilePath path, double planet_radius, sol::state& lua_state,
-		SimpleVertexArray<PHYSICS_SIZE>* work_array);
+		SimpleVertexArray<PHYSICS_SIZE>* work_array, GeneratorTimings* timings = nullptr);
 
 	static void prepare_lua(sol::state& lua_state);
 
+	void compute_bounds(glm::dmat4 model_spheric);
+
 	void upload();
 
 	bool is_uploaded() { return vbo != 0; }
 
+	// Bytes that upload() sends to the GPU
+	size_t get_upload_size();
+
 	bool has_water() { return water_vbo != 0; }
 
 	static void generate_index_array_with_skirts(std::array<uint16_t, INDEX_COUNT>& target, size_t& bulk_index_count);
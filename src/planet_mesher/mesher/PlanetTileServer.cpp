@@ -1,23 +1,50 @@
 #include "PlanetTileServer.h"
 #include <imgui/imgui.h>
 #include "../../util/Logger.h"
+#include "../../util/Timer.h"
 
 void PlanetTileServer::update(QuadTreePlanet& planet)
 {
-	if (dirty)
+	last_uploaded_tiles = 0;
+	last_uploaded_bytes = 0;
+
+	if (upload_queue.get_unsafe()->size() != 0)
 	{
-		planet.iteration++;
-		auto tiles_w = tiles.get();
+		Timer upload_timer = Timer();
 
-		for (auto it = tiles_w->begin(); it != tiles_w->end(); it++)
+		while (last_uploaded_tiles == 0 ||
+			(last_uploaded_bytes < max_upload_bytes && upload_timer.get_elapsed_time() < max_upload_time))
 		{
-			if (!it->second->is_uploaded())
+			PlanetTilePath target = PlanetTilePath(std::vector<QuadTreeQuadrant>(), PX);
+
 			{
-				it->second->upload();
+				auto upload_queue_w = upload_queue.get();
+				if (upload_queue_w->size() == 0)
+				{
+					break;
+				}
+
+				target = *upload_queue_w->begin();
+				upload_queue_w->erase(upload_queue_w->begin());
+			}
+
+			auto tiles_w = tiles.get();
+			auto it = tiles_w->find(target);
+			if (it == tiles_w->end() || it->second->is_uploaded())
+			{
+				// Unloaded before we got to it
+				continue;
 			}
+
+			it->second->upload();
+			last_uploaded_tiles++;
+			last_uploaded_bytes += it->second->get_upload_size();
 		}
 
-		dirty = false;
+		if (last_uploaded_tiles != 0)
+		{
+			planet.iteration++;
+		}
 	}
 
 	if (!planet.dirty)
@@ -141,20 +168,24 @@ PlanetTileServer::PlanetTileServer(const std::string& script, const std::string&
 	threads_run = true;
 	depth_for_unload = 0;
 
+	// Around 24 tiles without water
+	max_upload_bytes = 1024 * 1024;
+	max_upload_time = 0.002;
+	last_uploaded_tiles = 0;
+	last_uploaded_bytes = 0;
+
 	bool wrote_error = false;
 
 	PlanetTile::prepare_lua(lua_state);
 	LuaUtil::safe_lua(lua_state, script, wrote_error, script_path);
 
-	threads.resize(thread_count);
-
-	for (size_t i = 0; i < threads.size(); i++)
+	for (size_t i = 0; i < thread_count; i++)
 	{
-
-		threads[i].thread = new std::thread(thread_func, this, &threads[i]);
-		PlanetTile::prepare_lua(threads[i].lua_state);
+		threads.push_back(std::make_unique<PlanetTileThread>());
+		threads[i]->thread = new std::thread(thread_func, this, threads[i].get());
+		PlanetTile::prepare_lua(threads[i]->lua_state);
 		
-		LuaUtil::safe_lua(threads[i].lua_state, script, wrote_error, script_path);
+		LuaUtil::safe_lua(threads[i]->lua_state, script, wrote_error, script_path);
 
 		if (wrote_error)
 		{
@@ -174,8 +205,8 @@ PlanetTileServer::~PlanetTileServer()
 		// We must work hard to get those threads to wake up!
 		condition_var.notify_all();
 
-		threads[i].thread->join();
-		delete threads[i].thread;
+		threads[i]->thread->join();
+		delete threads[i]->thread;
 	}
 
 	// Tiles are now only managed by us so this is actually safe
@@ -194,6 +225,15 @@ void PlanetTileServer::do_imgui()
 	size_t tiles_size = tiles.get_unsafe()->size();
 	ImGui::Text("Loaded tiles: %i (%.2fMB)", (int)tiles_size, (float)(tiles_size * sizeof(PlanetTile)) / 1000000.0f);
 	ImGui::Text("Work List: %i", (int)work_list.get_unsafe()->size());
+	ImGui::Text("Upload backlog: %i", (int)upload_queue.get_unsafe()->size());
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		ImGui::Text("Worker %i Lua heap: %.2fMB (%.2fMB reserved)", (int)i,
+			(float)threads[i]->heap_size.load(std::memory_order_relaxed) / 1000000.0f,
+			(float)threads[i]->heap_reserved.load(std::memory_order_relaxed) / 1000000.0f);
+	}
+	ImGui::Text("Uploaded last frame: %i (%.2fKB)", (int)last_uploaded_tiles, (float)last_uploaded_bytes / 1000.0f);
 }
 
 void PlanetTileServer::thread_func(PlanetTileServer* server, PlanetTileThread* thread)
@@ -234,18 +274,24 @@ void PlanetTileServer::thread_func(PlanetTileServer* server, PlanetTileThread* t
 			bool has_errors = ntile->generate(target, server->config->radius, 
 				thread->lua_state, server->has_water, &arrays);
 
+			thread->allocator->step_gc(thread->lua_state);
+			thread->heap_size.store(LuaArenaAllocator::get_heap_size(thread->lua_state), std::memory_order_relaxed);
+			thread->heap_reserved.store(thread->allocator->reserved, std::memory_order_relaxed);
+
 			if (has_errors)
 			{
 				server->has_errors = true;
 			}
 
 
+			bool inserted = false;
 			{
 				// Send it to the tiles
 				auto tiles_w = server->tiles.get();
 				if (tiles_w->find(target) == tiles_w->end())
 				{
 					(*tiles_w)[target] = ntile;
+					inserted = true;
 				}
 				else
 				{
@@ -256,7 +302,11 @@ void PlanetTileServer::thread_func(PlanetTileServer* server, PlanetTileThread* t
 				
 			}
 
-			server->dirty = true;
+			if (inserted)
+			{
+				// The main thread will upload it when there's budget
+				server->upload_queue.get()->insert(target);
+			}
 		}
 	}
 
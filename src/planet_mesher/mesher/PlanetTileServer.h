@@ -1,5 +1,7 @@
 #pragma once
 #include <thread>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <set>
@@ -8,6 +10,7 @@
 
 #include <util/LuaUtil.h>
 #include <lua/LuaCore.h>
+#include <lua/LuaArenaAllocator.h>
 #include <universe/element/body/config/PlanetConfig.h>
 #include "PlanetTilePath.h"
 #include "PlanetTile.h"
@@ -20,8 +23,18 @@
 
 struct PlanetTileThread
 {
+	// Must be declared before the state, so it outlives it
+	std::unique_ptr<LuaArenaAllocator> allocator;
 	sol::state lua_state;
 	std::thread* thread;
+
+	// Published by the thread after each GC step, for the debug UI, 
+	// as the lua state and allocator may only be touched by the thread
+	std::atomic<size_t> heap_size;
+	std::atomic<size_t> heap_reserved;
+
+	PlanetTileThread() : allocator(std::make_unique<LuaArenaAllocator>()),
+		lua_state(allocator->make_state()), thread(nullptr), heap_size(0), heap_reserved(0) {}
 };
 
 // The tile server handles storage, creation and removal
@@ -32,13 +45,11 @@ class PlanetTileServer
 {
 private:
 
-	bool dirty;
-
 	size_t worker_thread_count;
 
 	int depth_for_unload;
 
-	std::vector<PlanetTileThread> threads;
+	std::vector<std::unique_ptr<PlanetTileThread>> threads;
 
 	static void thread_func(PlanetTileServer* server, PlanetTileThread* thread);
 
@@ -75,6 +86,19 @@ public:
 	// (ie. lowest detail tile) first
 	Atomic<std::multiset<PlanetTilePath, PlanetTilePathLess>> work_list;
 
+	// Finished tiles waiting to be uploaded to the GPU, in the
+	// same priority order as the work list. Paths are looked up
+	// in tiles on upload, as the tile may have been unloaded
+	Atomic<std::multiset<PlanetTilePath, PlanetTilePathLess>> upload_queue;
+
+	// Per-frame upload budget, at least one tile is always uploaded
+	// so the queue cannot stall. Time is in seconds
+	size_t max_upload_bytes;
+	double max_upload_time;
+
+	size_t last_uploaded_tiles;
+	size_t last_uploaded_bytes;
+
 	// Tells threads to start loading some new tiles, if neccesary
 	// or unloads unused, small enough tiles.
 	void update(QuadTreePlanet& planet);
@@ -89,7 +113,7 @@ public:
 
 	bool is_built()
 	{
-		return work_list.get_unsafe()->size() == 0;
+		return work_list.get_unsafe()->size() == 0 && upload_queue.get_unsafe()->size() == 0;
 	}
 	
 	double get_height(glm::dvec3 pos_3d, size_t depth = 1);
@@ -207,7 +207,8 @@ void QuadTreePlanet::update(PlanetTileServer& server)
 			{
 				auto tiles_m = server.tiles.get();
 				auto it = tiles_m->find(path);
-				if (it == tiles_m->end())
+				// Tiles waiting on the upload queue cannot be drawn yet
+				if (it == tiles_m->end() || !it->second->is_uploaded())
 				{
 					found = false;
 				}
@@ -227,7 +228,8 @@ void QuadTreePlanet::update(PlanetTileServer& server)
 				// Check that renderer has parent, if it does not then we moved too far, reduce quality
 				{
 					auto tiles_m = server.tiles.get();
-					if (tiles_m->find(path) == tiles_m->end())
+					auto it = tiles_m->find(path);
+					if (it == tiles_m->end() || !it->second->is_uploaded())
 					{
 						// Horror, we moved too far, the user will be over low quality terrain
 						good = false;
@@ -37,8 +37,13 @@ void PlanetRenderer::render(PlanetTileServer& server, QuadTreePlanet& planet, gl
 		shader->setVec3("light_dir", light_dir);
 		shader->setMat4("normal_tform", normal_matrix);
 
-		bool cw_mode = false;
-		glFrontFace(GL_CCW);
+		// wmodel takes unit-sphere coordinates to camera relative
+		// coordinates, so the camera is at its origin
+		glm::dvec3 camera_local = glm::inverse(wmodel) * glm::dvec4(0.0, 0.0, 0.0, 1.0);
+		double occluder_radius = 1.0 + config.surface.min_height / config.radius;
+		culler.begin(proj_view * wmodel, camera_local, occluder_radius);
+
+		visible_tiles.clear();
 		for (size_t i = 0; i < render_tiles.size(); i++)
 		{
 			auto it = tiles_w->find(render_tiles[i]);
@@ -51,18 +56,31 @@ void PlanetRenderer::render(PlanetTileServer& server, QuadTreePlanet& planet, gl
 				// Visually, it probably is a small flicker
 				continue;
 			}
-			auto tile = it->second;
-			auto path = it->first;
 
-			glm::dmat4 model = path.get_model_spheric_matrix();
-			// We also apply the camera tform, used by the deferred renderer
-			glm::dmat4 deferred_model = wmodel * model;
+			if (!it->second->is_uploaded())
+			{
+				continue;
+			}
 
-			if (!tile->is_uploaded())
+			if (!culler.is_visible(it->second->bounds_center, it->second->bounds_radius))
 			{
 				continue;
 			}
 
+			visible_tiles.emplace_back(&it->first, it->second);
+		}
+
+		bool cw_mode = false;
+		glFrontFace(GL_CCW);
+		for (size_t i = 0; i < visible_tiles.size(); i++)
+		{
+			auto tile = visible_tiles[i].second;
+			const PlanetTilePath& path = *visible_tiles[i].first;
+
+			glm::dmat4 model = path.get_model_spheric_matrix();
+			// We also apply the camera tform, used by the deferred renderer
+			glm::dmat4 deferred_model = wmodel * model;
+
 			if (tile->clockwise && !cw_mode)
 			{
 				glFrontFace(GL_CW);
@@ -112,15 +130,10 @@ void PlanetRenderer::render(PlanetTileServer& server, QuadTreePlanet& planet, gl
 
 			cw_mode = false;
 			glFrontFace(GL_CCW);
-			for (size_t i = 0; i < render_tiles.size(); i++)
+			for (size_t i = 0; i < visible_tiles.size(); i++)
 			{
-				auto it = tiles_w->find(render_tiles[i]);
-				if (it == tiles_w->end())
-				{
-					continue;
-				}
-				auto tile = it->second;
-				auto path = it->first;
+				auto tile = visible_tiles[i].second;
+				const PlanetTilePath& path = *visible_tiles[i].first;
 
 				glm::dmat4 model = path.get_model_spheric_matrix();
 				glm::dmat4 deferred_model = wmodel * model;
@@ -2,6 +2,7 @@
 #include "../mesher/PlanetTileServer.h"
 #include "../quadtree/QuadTreePlanet.h"
 #include "../../assets/Shader.h"
+#include "PlanetTileCuller.h"
 // Handles optimized rendering of tiles, that are stored
 // in a PlanetTileServer
 // TODO: Integration with an asset manager
@@ -23,8 +24,14 @@ private:
 
 	void generate_and_upload_index_buffer();
 
+	// Tiles which passed culling this frame, reused by the water pass
+	// Paths point into the tile server map, only valid while locked
+	std::vector<std::pair<const PlanetTilePath*, PlanetTile*>> visible_tiles;
+
 public:
 
+	PlanetTileCuller culler;
+
 	// Camera position should be given RELATIVE to the planet
 	void render(PlanetTileServer& server, QuadTreePlanet& planet, glm::dmat4 proj_view, glm::dmat4 model, 
 		glm::dmat4 no_rot_model, glm::dmat4 normal_matrix, float far_plane,
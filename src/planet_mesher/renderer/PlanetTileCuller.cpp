@@ -0,0 +1,133 @@
+#include "PlanetTileCuller.h"
+#include <imgui/imgui.h>
+
+void PlanetTileCuller::begin(glm::dmat4 tform, glm::dvec3 camera_pos, double occluder_radius)
+{
+	this->camera_pos = camera_pos;
+	this->occluder_radius = occluder_radius;
+
+	stats.tested = 0;
+	stats.frustum_culled = 0;
+	stats.horizon_culled = 0;
+
+	// Gribb-Hartmann plane extraction, glm matrices are column-major
+	glm::dvec4 row0 = glm::dvec4(tform[0][0], tform[1][0], tform[2][0], tform[3][0]);
+	glm::dvec4 row1 = glm::dvec4(tform[0][1], tform[1][1], tform[2][1], tform[3][1]);
+	glm::dvec4 row2 = glm::dvec4(tform[0][2], tform[1][2], tform[2][2], tform[3][2]);
+	glm::dvec4 row3 = glm::dvec4(tform[0][3], tform[1][3], tform[2][3], tform[3][3]);
+
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	// The far plane is not used, the logarithmic depth buffer
+	// makes it meaningless for planets
+
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		double len = glm::length(glm::dvec3(planes[i]));
+		if (len > 0.0)
+		{
+			planes[i] /= len;
+		}
+	}
+}
+
+bool PlanetTileCuller::is_visible(glm::dvec3 center, double radius)
+{
+	stats.tested++;
+
+	if (frustum_enabled && is_outside_frustum(center, radius))
+	{
+		stats.frustum_culled++;
+		return false;
+	}
+
+	if (horizon_enabled && is_behind_horizon(center, radius))
+	{
+		stats.horizon_culled++;
+		return false;
+	}
+
+	return true;
+}
+
+bool PlanetTileCuller::is_outside_frustum(glm::dvec3 center, double radius) const
+{
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		double dist = glm::dot(glm::dvec3(planes[i]), center) + planes[i].w;
+		if (dist < -radius)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool PlanetTileCuller::is_behind_horizon(glm::dvec3 center, double radius) const
+{
+	double d2 = glm::dot(camera_pos, camera_pos);
+	double r2 = occluder_radius * occluder_radius;
+
+	if (d2 <= r2)
+	{
+		// Camera is inside the occluder, nothing sensible to do
+		return false;
+	}
+
+	double d = glm::sqrt(d2);
+
+	// The occluded region is the cone from the camera tangent to the
+	// occluder, past the plane which contains the horizon circle.
+	// (The visible cap of the occluder is in front of that plane)
+	glm::dvec3 axis = -camera_pos / d;
+	glm::dvec3 to_center = center - camera_pos;
+
+	double along = glm::dot(to_center, axis);
+	double horizon_plane = (d2 - r2) / d;
+
+	if (along - radius < horizon_plane)
+	{
+		return false;
+	}
+
+	double across = glm::length(to_center - axis * along);
+	double sin_a = occluder_radius / d;
+	double cos_a = glm::sqrt(d2 - r2) / d;
+
+	// Distance from the center to the cone surface, positive inside
+	double inside = along * sin_a - across * cos_a;
+
+	return inside >= radius;
+}
+
+void PlanetTileCuller::do_imgui()
+{
+	ImGui::Checkbox("Frustum culling", &frustum_enabled);
+	ImGui::Checkbox("Horizon culling", &horizon_enabled);
+	ImGui::Text("Tiles tested: %i", (int)stats.tested);
+	ImGui::Text("Frustum culled: %i", (int)stats.frustum_culled);
+	ImGui::Text("Horizon culled: %i", (int)stats.horizon_culled);
+	ImGui::Text("Drawn: %i", (int)stats.get_drawn());
+}
+
+PlanetTileCuller::PlanetTileCuller()
+{
+	frustum_enabled = true;
+	horizon_enabled = true;
+
+	camera_pos = glm::dvec3(0.0);
+	occluder_radius = 0.0;
+
+	stats.tested = 0;
+	stats.frustum_culled = 0;
+	stats.horizon_culled = 0;
+
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		planes[i] = glm::dvec4(0.0);
+	}
+}
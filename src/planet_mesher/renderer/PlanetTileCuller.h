@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <glm/glm.hpp>
+
+// Decides which tiles are worth drawing, using the bounding
+// spheres computed when tiles are generated. It does not
+// touch OpenGL so it can be used (and tested) without a context.
+//
+// All coordinates are given in the planet unit-sphere space,
+// the same one returned by PlanetTilePath::get_model_spheric_matrix
+class PlanetTileCuller
+{
+public:
+
+	struct Stats
+	{
+		size_t tested;
+		size_t frustum_culled;
+		size_t horizon_culled;
+
+		size_t get_drawn() const { return tested - frustum_culled - horizon_culled; }
+	};
+
+private:
+
+	// Left, right, bottom, top and near planes, normalized
+	// (xyz is the normal pointing inside, w the distance)
+	std::array<glm::dvec4, 5> planes;
+
+	glm::dvec3 camera_pos;
+	double occluder_radius;
+
+public:
+
+	bool frustum_enabled;
+	bool horizon_enabled;
+
+	// Reset on every call to begin
+	Stats stats;
+
+	// tform transforms from unit-sphere space to clip space, that is,
+	// the CameraUniforms proj_view times the planet model matrix.
+	// occluder_radius is the minimum radius of the body, relative to
+	// its radius, anything fully behind that sphere is culled
+	void begin(glm::dmat4 tform, glm::dvec3 camera_pos, double occluder_radius);
+
+	// Returns true if the sphere may be visible, updating stats
+	bool is_visible(glm::dvec3 center, double radius);
+
+	// Both tests are conservative, they may return false
+	// for a sphere that's not visible, but never true for a
+	// sphere that's visible
+	bool is_outside_frustum(glm::dvec3 center, double radius) const;
+	bool is_behind_horizon(glm::dvec3 center, double radius) const;
+
+	void do_imgui();
+
+	PlanetTileCuller();
+};
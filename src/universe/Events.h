@@ -1,18 +1,106 @@
 #pragma once
 #include <variant>
+#include <string_view>
+#include <type_traits>
+#include <initializer_list>
 #include <sol.hpp>
 #include <util/defines.h>
 
 using EventArgument = std::variant<int, double, int64_t, std::string>;
 
-using EventArguments = std::vector<EventArgument>;
+// Events are identified by the hash of their name, so emitting and looking
+// up receivers doesn't touch strings. Names are still what mods and lua use,
+// they are hashed once (on sign up, or when emitted by name)
+using EventId = uint64_t;
+
+// FNV-1a, constexpr so the ids of known events are computed at compile time
+constexpr EventId hash_event_id(std::string_view name)
+{
+	EventId hash = 14695981039346656037ull;
+	for(size_t i = 0; i < name.size(); i++)
+	{
+		hash ^= (EventId)(uint8_t)name[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+struct CoreEvents
+{
+	// (int64_t uid), emitted once the entity is set up (queued, see Universe::queue_event)
+	static constexpr EventId NEW_ENTITY = hash_event_id("core:new_entity");
+	// (int64_t uid), emitted before the entity is removed, so it can still be found
+	static constexpr EventId REMOVE_ENTITY = hash_event_id("core:remove_entity");
+};
+
+// Arguments of an event, stored inline up to INLINE_COUNT (every core
+// event), so emitting doesn't allocate. More arguments are moved to the heap.
+class EventArguments
+{
+public:
+
+	static constexpr size_t INLINE_COUNT = 4;
+
+private:
+
+	EventArgument inline_args[INLINE_COUNT];
+	std::vector<EventArgument> heap_args;
+	size_t count;
+
+public:
+
+	void push_back(EventArgument arg)
+	{
+		if(count < INLINE_COUNT)
+		{
+			inline_args[count] = std::move(arg);
+		}
+		else
+		{
+			if(count == INLINE_COUNT)
+			{
+				heap_args.reserve(INLINE_COUNT * 2);
+				for(size_t i = 0; i < INLINE_COUNT; i++)
+				{
+					heap_args.push_back(std::move(inline_args[i]));
+				}
+			}
+			heap_args.push_back(std::move(arg));
+		}
+		count++;
+	}
+
+	EventArgument* begin() { return count > INLINE_COUNT ? heap_args.data() : inline_args; }
+	EventArgument* end() { return begin() + count; }
+	const EventArgument* begin() const { return count > INLINE_COUNT ? heap_args.data() : inline_args; }
+	const EventArgument* end() const { return begin() + count; }
+
+	EventArgument& operator[](size_t i) { return begin()[i]; }
+	const EventArgument& operator[](size_t i) const { return begin()[i]; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	EventArguments() : count(0) {}
+	EventArguments(std::initializer_list<EventArgument> args) : count(0)
+	{
+		for(const EventArgument& arg : args)
+		{
+			push_back(arg);
+		}
+	}
+};
+
+// So variadic emit_event doesn't take an EventArguments as an argument
+template<typename... Args>
+using EnableIfEventValues = std::enable_if_t<!std::disjunction_v<std::is_same<std::decay_t<Args>, EventArguments>...>>;
 
 typedef void(*EventHandlerFnc)(EventArguments&, const void* user_data);
 
 struct EventHandler
 {
 	EventHandlerFnc fnc;
-	const void* user_data; 
+	const void* user_data;
 
 	EventHandler() : fnc(nullptr), user_data(nullptr) {}
 
@@ -0,0 +1,136 @@
+#include "PhysicsBubble.h"
+#include "Universe.h"
+#include <physics/ground/GroundShape.h>
+
+#pragma warning(push, 0)
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#pragma warning(pop)
+
+static void bubble_tick(btDynamicsWorld* world, btScalar tstep)
+{
+	PhysicsBubble* bubble = (PhysicsBubble*)world->getWorldUserInfo();
+	bubble->physics_update(tstep);
+}
+
+void PhysicsBubble::update_ground()
+{
+	PlanetarySystem& system = universe->system;
+
+	PlanetaryBody* closest = nullptr;
+	double closest_dist = 0.0;
+	for(size_t i = 0; i < system.elements.size(); i++)
+	{
+		SystemElement& elem = system.elements[i];
+		if(elem.type != SystemElement::BODY || elem.as_body->rigid_body == nullptr)
+		{
+			continue;
+		}
+
+		double dist = glm::distance(origin, system.bullet_states[i].pos) - elem.as_body->config.radius;
+		if(closest == nullptr || dist < closest_dist)
+		{
+			closest = elem.as_body;
+			closest_dist = dist;
+		}
+	}
+
+	if(closest == ground_body)
+	{
+		return;
+	}
+
+	if(ground_proxy != nullptr)
+	{
+		world->removeRigidBody(ground_proxy);
+		delete ground_proxy;
+		ground_proxy = nullptr;
+	}
+
+	ground_body = closest;
+
+	if(ground_body != nullptr)
+	{
+		// Same as the body's rigidbody in the main world (PlanetarySystem::init_physics)
+		ground_proxy = new btRigidBody(1000000000.0, nullptr, ground_body->ground_shape, btVector3(0, 0, 0));
+		ground_proxy->setCollisionFlags(ground_proxy->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+		ground_proxy->setFriction(1.0);
+		ground_proxy->setRestitution(1.0);
+		ground_proxy->setActivationState(DISABLE_DEACTIVATION);
+		ground_proxy->setWorldTransform(ground_body->rigid_body->getWorldTransform());
+
+		world->addRigidBody(ground_proxy);
+	}
+}
+
+void PhysicsBubble::physics_update(double pdt)
+{
+	// The main world already stepped, and moved the body
+	if(ground_proxy != nullptr)
+	{
+		ground_proxy->setWorldTransform(ground_body->rigid_body->getWorldTransform());
+	}
+
+	for(Entity* e : entities)
+	{
+		e->physics_update(pdt);
+	}
+}
+
+void PhysicsBubble::step(int steps)
+{
+	// Bullet accumulates the time and steps once enough has passed, the
+	// motion states are interpolated on the ticks it doesn't step.
+	// If the divider just went down, the time already accumulated is stepped
+	// now instead of being dropped
+	int max_steps = steps + MAX_RATE_DIVIDER;
+	world->stepSimulation(steps * Universe::PHYSICS_STEPSIZE, max_steps, 
+		rate_divider * Universe::PHYSICS_STEPSIZE);
+}
+
+PhysicsBubble::PhysicsBubble(Universe* universe, bool multibody)
+{
+	this->universe = universe;
+
+	origin = glm::dvec3(0.0, 0.0, 0.0);
+	rate_divider = 1;
+	ground_body = nullptr;
+	ground_proxy = nullptr;
+
+	collision_config = new btDefaultCollisionConfiguration();
+	dispatcher = new btCollisionDispatcher(collision_config);
+	ground_func = new GroundCollisionAlgorithm::CreateFunc(collision_config, &universe->ground_collision_stats);
+	GroundCollisionAlgorithm::register_on(dispatcher, ground_func);
+	broadphase = new btDbvtBroadphase();
+
+	if(multibody)
+	{
+		btMultiBodyConstraintSolver* mb_solver = new btMultiBodyConstraintSolver();
+		solver = mb_solver;
+		world = new btMultiBodyDynamicsWorld(dispatcher, broadphase, mb_solver, collision_config);
+	}
+	else
+	{
+		solver = new btSequentialImpulseConstraintSolver();
+		world = new btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collision_config);
+	}
+
+	world->setGravity({ 0.0, 0.0, 0.0 });
+	world->setInternalTickCallback(bubble_tick, this, true);
+}
+
+PhysicsBubble::~PhysicsBubble()
+{
+	if(ground_proxy != nullptr)
+	{
+		world->removeRigidBody(ground_proxy);
+		delete ground_proxy;
+	}
+
+	delete world;
+	delete solver;
+	delete broadphase;
+	delete dispatcher;
+	delete ground_func;
+	delete collision_config;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#pragma warning(push, 0)
+#include <btBulletDynamicsCommon.h>
+#pragma warning(pop)
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <physics/ground/GroundCollisionAlgorithm.h>
+
+class Universe;
+class Entity;
+class PlanetaryBody;
+
+// A bullet world of its own for a cluster of nearby unpacked vehicles and
+// whatever they may touch (buildings), see Universe::update_bubbles.
+// Bubbles don't interact with each other, so they can step at the same
+// time on different threads (Universe::step_bubbles).
+// Every bubble has a proxy rigidbody for the ground of the closest planet,
+// sharing the planet's GroundShape (its queries are thread safe).
+// Bullet uses doubles, so coordinates are the same as in the main world,
+// origin is simply the center of the bubble, and moves with it.
+// Bubbles where nothing is near a surface or in atmosphere (coasting, docking)
+// can step at a lower rate, once every rate_divider ticks of the main world,
+// with a longer step. Bullet keeps the time left until the next step and 
+// interpolates the motion states meanwhile, so vehicles still render smoothly
+class PhysicsBubble
+{
+private:
+
+	Universe* universe;
+
+	btDefaultCollisionConfiguration* collision_config;
+	btCollisionDispatcher* dispatcher;
+	btBroadphaseInterface* broadphase;
+	btConstraintSolver* solver;
+	GroundCollisionAlgorithm::CreateFunc* ground_func;
+
+	PlanetaryBody* ground_body;
+	btRigidBody* ground_proxy;
+
+public:
+
+	btDiscreteDynamicsWorld* world;
+
+	// Highest rate_divider, bubbles may catch up as many steps at once
+	// when their rate increases
+	static constexpr int MAX_RATE_DIVIDER = 16;
+
+	glm::dvec3 origin;
+
+	// The bubble steps (PHYSICS_STEPSIZE * rate_divider) once every
+	// rate_divider ticks of the main world, 1 steps with it
+	int rate_divider;
+
+	// Set every frame by the universe, these get their physics_update from us
+	std::vector<Entity*> entities;
+
+	// Moves the ground proxy to the body closest to origin
+	void update_ground();
+
+	// Called by bullet before every step of our world, only on the
+	// ticks the bubble is due
+	void physics_update(double pdt);
+
+	// Advances as much time as the main world did in steps ticks, so time
+	// stays in sync, this may not step at all if rate_divider > 1
+	void step(int steps);
+
+	PhysicsBubble(Universe* universe, bool multibody);
+	~PhysicsBubble();
+};
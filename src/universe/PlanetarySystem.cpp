@@ -380,7 +380,8 @@ void PlanetarySystem::update(double dt, btDynamicsWorld* world, bool bullet)
 	}
 
 	update_physics(dt, bullet);
-	
+
+	landed.update(*this, bullet);
 }
 
 void PlanetarySystem::init(btDynamicsWorld* world)
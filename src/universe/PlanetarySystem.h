@@ -4,6 +4,7 @@
 #include "../util/SerializeUtil.h"
 #include "element/SystemElement.h"
 #include "propagator/SystemPropagator.h"
+#include "entity/trajectory/LandedStore.h"
 
 #include <renderer/Drawable.h>
 
@@ -65,6 +66,9 @@ public:
 	ElementVector elements;
 
 	SystemPropagator* propagator;
+
+	// Everything landed on the bodies, updated after the states
+	LandedStore landed;
 	
 	// Computes state of the whole system, including offsets, 
 	// at a given time
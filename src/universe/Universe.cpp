@@ -1,4 +1,8 @@
 #include "Universe.h"
+#include "entity/entities/VehicleEntity.h"
+#include "entity/entities/BuildingEntity.h"
+#include <util/DisjointSet.h>
+#include <algorithm>
 
 static void bullet_tick(btDynamicsWorld* world, btScalar tstep)
 {
@@ -9,70 +13,572 @@ static void bullet_tick(btDynamicsWorld* world, btScalar tstep)
 }
 
 
-std::unordered_set<EventHandler, EventHandlerHasher>& Universe::index_event_receivers(const std::string& str)
+void Universe::emit_event(EventId event_id, EventArguments args)
 {
-	auto it = event_receivers.find(str);
-	if (it == event_receivers.end())
+	// Receivers may live in any entity, so during the parallel update
+	// events are dispatched afterwards from the main thread
+	if(VehicleCommandBuffer::current)
 	{
-		event_receivers[str] = std::unordered_set<EventHandler, EventHandlerHasher>();
-		return event_receivers[str];
+		queue_event(event_id, std::move(args));
+		return;
 	}
-	else
+
+	call_receivers(event_id, args);
+}
+
+void Universe::call_receivers(EventId event_id, EventArguments& args)
+{
+	auto it = event_receivers.find(event_id);
+	if(it == event_receivers.end())
+	{
+		return;
+	}
+
+	for (EventHandler ev : it->second)
 	{
-		return it->second;
+		ev.fnc(args, ev.user_data);
 	}
 }
 
-void Universe::emit_event(const std::string& event_id, EventArguments args)
+void Universe::queue_event(EventId event_id, EventArguments args)
 {
-	auto& rc = index_event_receivers(event_id);
+	std::lock_guard<std::mutex> lock(event_queue_mtx);
+	event_queue.push_back(QueuedEvent{ event_id, std::move(args) });
+}
 
-	for (EventHandler ev : rc)
+void Universe::dispatch_events()
+{
+	while(true)
 	{
-		ev.fnc(args, ev.user_data);
+		{
+			std::lock_guard<std::mutex> lock(event_queue_mtx);
+			if(event_queue.empty())
+			{
+				break;
+			}
+			// Both keep their capacity, so this doesn't allocate once warmed up
+			std::swap(event_queue, event_batch);
+		}
+
+		size_t i = 0;
+		while(i < event_batch.size())
+		{
+			EventId id = event_batch[i].id;
+			auto it = event_receivers.find(id);
+			for(; i < event_batch.size() && event_batch[i].id == id; i++)
+			{
+				if(it == event_receivers.end())
+				{
+					continue;
+				}
+
+				for(EventHandler ev : it->second)
+				{
+					ev.fnc(event_batch[i].args, ev.user_data);
+				}
+			}
+		}
+
+		event_batch.clear();
+	}
+}
+
+
+void Universe::sign_up_for_event(std::string_view event_name, EventHandler id)
+{
+	// Receivers are only touched from the main thread
+	if(VehicleCommandBuffer::current)
+	{
+		std::string name = std::string(event_name);
+		VehicleCommandBuffer::run_deferred([this, name, id]()
+		{
+			sign_up_for_event(name, id);
+		});
+		return;
+	}
+
+	EventId event_id = hash_event_id(event_name);
+	auto it = event_names.find(event_id);
+	if(it == event_names.end())
+	{
+		event_names.emplace(event_id, std::string(event_name));
+	}
+	else
+	{
+		logger->check(it->second == event_name, "Events '{}' and '{}' have the same id", 
+			it->second, std::string(event_name));
 	}
+
+	sign_up_for_event(event_id, id);
 }
 
 
-void Universe::sign_up_for_event(const std::string& event_id, EventHandler id)
+void Universe::sign_up_for_event(EventId event_id, EventHandler id)
 {
-	auto& rc = index_event_receivers(event_id);
-	rc.insert(id);
+	if(VehicleCommandBuffer::current)
+	{
+		VehicleCommandBuffer::run_deferred([this, event_id, id]()
+		{
+			sign_up_for_event(event_id, id);
+		});
+		return;
+	}
+
+	event_receivers[event_id].insert(id);
 }
 
 
-void Universe::drop_out_of_event(const std::string& event_id, EventHandler id)
+void Universe::drop_out_of_event(EventId event_id, EventHandler id)
 {
-	auto& rc = index_event_receivers(event_id);
-	rc.erase(id);
+	if(VehicleCommandBuffer::current)
+	{
+		VehicleCommandBuffer::run_deferred([this, event_id, id]()
+		{
+			drop_out_of_event(event_id, id);
+		});
+		return;
+	}
+
+	auto it = event_receivers.find(event_id);
+	if(it != event_receivers.end())
+	{
+		it->second.erase(id);
+	}
 }
 
 
 void Universe::physics_update(double pdt)
 {
+	physics_steps++;
+
 	// Do the physics update on the system
 	system.update(pdt, bt_world, true);
 
-	for (Entity* e : entities)
+	// Entities may be created meanwhile (separation)
+	entities.for_each_typed([this, pdt](auto* e)
 	{
-		e->physics_update(pdt);
-	}
+		// Those in bubbles are updated by the bubble
+		btDynamicsWorld* world = e->get_bullet_world();
+		if(world == nullptr || world == bt_world)
+		{
+			e->physics_update(pdt);
+		}
+	});
 }
 
+// Makes sure the thread stops recording even if the update throws
+struct CommandBufferScope
+{
+	CommandBufferScope(VehicleCommandBuffer* buffer) { VehicleCommandBuffer::current = buffer; }
+	~CommandBufferScope() { VehicleCommandBuffer::current = nullptr; }
+};
+
 void Universe::update(double dt)
 {
 	if(!paused)
 	{
 		system.update(dt, bt_world, false);
 
+		if(bubble_radius > 0.0 || !bubbles.empty())
+		{
+			update_bubbles();
+		}
+
+		physics_steps = 0;
+		ground_collision_stats.next_tick();
 		bt_world->stepSimulation(dt, MAX_PHYSICS_STEPS, PHYSICS_STEPSIZE);
 
-		for (Entity* e : entities)
+		if(!bubbles.empty())
+		{
+			step_bubbles();
+		}
+
+		if(update_jobs)
+		{
+			update_jobs->run(entities.size(), [this](size_t i)
+			{
+				entities[i]->post_physics_update();
+			});
+		}
+		else
+		{
+			entities.for_each_typed([](auto* e)
+			{
+				e->post_physics_update();
+			});
+		}
+
+		if(update_jobs)
+		{
+			update_parallel(dt);
+		}
+		else
+		{
+			entities.for_each_typed([dt](auto* e)
+			{
+				e->update(dt);
+			});
+		}
+	}
+
+	dispatch_events();
+
+}
+
+void Universe::update_parallel(double dt)
+{
+	// Group entities, keeping entity order inside each group
+	std::unordered_map<void*, size_t> group_index;
+	size_t group_count = 0;
+	for (Entity* e : entities)
+	{
+		void* group = e->get_update_group();
+		if(group == nullptr)
+		{
+			continue;
+		}
+
+		auto it = group_index.find(group);
+		if(it == group_index.end())
+		{
+			it = group_index.emplace(group, group_count).first;
+			if(update_groups.size() <= group_count)
+			{
+				update_groups.emplace_back();
+			}
+			update_groups[group_count].clear();
+			group_count++;
+		}
+
+		update_groups[it->second].push_back(e);
+	}
+
+	update_buffers.resize(std::max(update_buffers.size(), group_count));
+
+	update_jobs->run(group_count, [this, dt](size_t i)
+	{
+		CommandBufferScope scope(&update_buffers[i]);
+		for(Entity* e : update_groups[i])
+		{
+			e->update(dt);
+		}
+	});
+
+	// Bullet changes are applied in group order, so results don't 
+	// depend on which thread finished first
+	for(size_t i = 0; i < group_count; i++)
+	{
+		update_buffers[i].apply();
+	}
+
+	for (Entity* e : entities)
+	{
+		if(e->get_update_group() == nullptr)
 		{
 			e->update(dt);
 		}
 	}
+}
+
+void Universe::update_bubbles()
+{
+	// Entities which may be in a bubble, loaders come first
+	std::vector<Entity*> nodes;
+	std::vector<glm::dvec3> origins;
+	std::vector<double> radii;
+	size_t loader_count = 0;
+
+	if(bubble_radius > 0.0)
+	{
+		for(int pass = 0; pass < 2; pass++)
+		{
+			for(Entity* e : entities)
+			{
+				bool loader = e->is_physics_loader();
+				if(e->get_bullet_world() == nullptr || loader != (pass == 0))
+				{
+					continue;
+				}
+
+				double radius = e->get_physics_radius();
+				if(!loader && radius <= 0.0)
+				{
+					continue;
+				}
+
+				nodes.push_back(e);
+				origins.push_back(e->get_physics_origin());
+				radii.push_back(radius);
+			}
+
+			if(pass == 0)
+			{
+				loader_count = nodes.size();
+			}
+		}
+	}
+
+	// Anything close enough to a loader goes with it, so an entity close to 
+	// two loaders puts them in the same bubble
+	DisjointSet clusters;
+	clusters.reset(nodes.size());
+	for(size_t i = 0; i < loader_count; i++)
+	{
+		for(size_t j = i + 1; j < nodes.size(); j++)
+		{
+			double dist = glm::distance(origins[i], origins[j]) - radii[i] - radii[j];
+			if(dist < bubble_radius)
+			{
+				clusters.unite(i, j);
+			}
+		}
+	}
+
+	// Clusters keep the bubble of their first loader already in one, 
+	// unless another cluster took it first
+	std::unordered_map<btDynamicsWorld*, PhysicsBubble*> by_world;
+	for(PhysicsBubble* bubble : bubbles)
+	{
+		by_world[bubble->world] = bubble;
+		bubble->entities.clear();
+	}
+
+	std::vector<PhysicsBubble*> cluster_bubble(nodes.size(), nullptr);
+	std::unordered_set<PhysicsBubble*> kept;
+	for(size_t i = 0; i < loader_count; i++)
+	{
+		size_t root = clusters.find(i);
+		auto it = by_world.find(nodes[i]->get_bullet_world());
+		if(cluster_bubble[root] == nullptr && it != by_world.end() && kept.insert(it->second).second)
+		{
+			cluster_bubble[root] = it->second;
+		}
+	}
+
+	std::unordered_map<Entity*, PhysicsBubble*> assigned;
+	std::vector<PhysicsBubble*> n_bubbles;
+	for(size_t i = 0; i < loader_count; i++)
+	{
+		size_t root = clusters.find(i);
+		if(cluster_bubble[root] == nullptr)
+		{
+			PhysicsBubble* n_bubble = new PhysicsBubble(this, multibody_world);
+			n_bubble->world->setDebugDrawer(bt_debug);
+			n_bubbles.push_back(n_bubble);
+			cluster_bubble[root] = n_bubble;
+		}
+	}
+
+	// Clusters without loaders stay in the main world
+	for(size_t i = 0; i < nodes.size(); i++)
+	{
+		PhysicsBubble* bubble = cluster_bubble[clusters.find(i)];
+		if(bubble != nullptr)
+		{
+			bubble->entities.push_back(nodes[i]);
+			assigned[nodes[i]] = bubble;
+		}
+	}
+
+	for(Entity* e : entities)
+	{
+		btDynamicsWorld* world = e->get_bullet_world();
+		if(world == nullptr)
+		{
+			continue;
+		}
+
+		auto it = assigned.find(e);
+		btDynamicsWorld* target = it == assigned.end() ? bt_world : it->second->world;
+		if(world != target)
+		{
+			e->move_to_world(target);
+		}
+	}
+
+	// Everything is out of the bubbles we don't use anymore
+	for(PhysicsBubble* bubble : bubbles)
+	{
+		if(kept.find(bubble) == kept.end())
+		{
+			delete bubble;
+		}
+		else
+		{
+			n_bubbles.push_back(bubble);
+		}
+	}
+
+	bubbles = n_bubbles;
+
+	for(PhysicsBubble* bubble : bubbles)
+	{
+		bubble->origin = glm::dvec3(0.0, 0.0, 0.0);
+		size_t count = 0;
+		for(Entity* e : bubble->entities)
+		{
+			if(e->is_physics_loader())
+			{
+				bubble->origin += e->get_physics_origin();
+				count++;
+			}
+		}
+
+		bubble->origin /= (double)count;
+		bubble->update_ground();
+
+		bool coasting = true;
+		for(Entity* e : bubble->entities)
+		{
+			if(!e->timewarp_safe())
+			{
+				coasting = false;
+				break;
+			}
+		}
+
+		bubble->rate_divider = coasting ? bubble_low_rate : 1;
+	}
+}
+
+void Universe::step_bubbles()
+{
+	if(physics_steps == 0)
+	{
+		return;
+	}
+
+	// Entities sharing an update group (lua states) can't tick at the same time, 
+	// so their bubbles step together. Entities without one may touch 
+	// anything, so their bubbles step alone after the rest
+	std::unordered_map<void*, size_t> group_bubble;
+	std::vector<bool> serial(bubbles.size(), false);
+	DisjointSet sets;
+	sets.reset(bubbles.size());
+
+	for(size_t i = 0; i < bubbles.size(); i++)
+	{
+		for(Entity* e : bubbles[i]->entities)
+		{
+			void* group = e->get_update_group();
+			if(group == nullptr)
+			{
+				serial[i] = true;
+				continue;
+			}
+
+			auto it = group_bubble.find(group);
+			if(it == group_bubble.end())
+			{
+				group_bubble[group] = i;
+			}
+			else
+			{
+				sets.unite(i, it->second);
+			}
+		}
+	}
+
+	// A set is serial if any of its bubbles is
+	for(size_t i = 0; i < bubbles.size(); i++)
+	{
+		if(serial[i])
+		{
+			serial[sets.find(i)] = true;
+		}
+	}
+
+	std::unordered_map<size_t, size_t> set_job;
+	std::vector<PhysicsBubble*> serial_bubbles;
+	bubble_jobs.clear();
+	for(size_t i = 0; i < bubbles.size(); i++)
+	{
+		size_t root = sets.find(i);
+		if(serial[root])
+		{
+			serial_bubbles.push_back(bubbles[i]);
+			continue;
+		}
+
+		auto it = set_job.find(root);
+		if(it == set_job.end())
+		{
+			it = set_job.emplace(root, bubble_jobs.size()).first;
+			bubble_jobs.emplace_back();
+		}
+
+		bubble_jobs[it->second].push_back(bubbles[i]);
+	}
+
+	// The last buffer is for the serial bubbles
+	bubble_buffers.resize(bubble_jobs.size() + 1);
+	for(VehicleCommandBuffer& buffer : bubble_buffers)
+	{
+		// The thread stepping a world owns it, only entity creation
+		// and events must wait
+		buffer.immediate = true;
+	}
+
+	int steps = physics_steps;
+	auto step_job = [this, steps](size_t i)
+	{
+		CommandBufferScope scope(&bubble_buffers[i]);
+		for(PhysicsBubble* bubble : bubble_jobs[i])
+		{
+			bubble->step(steps);
+		}
+	};
+
+#ifdef BT_THREADSAFE
+	if(update_jobs)
+	{
+		update_jobs->run(bubble_jobs.size(), step_job);
+	}
+	else
+#endif
+	{
+		for(size_t i = 0; i < bubble_jobs.size(); i++)
+		{
+			step_job(i);
+		}
+	}
+
+	{
+		CommandBufferScope scope(&bubble_buffers.back());
+		for(PhysicsBubble* bubble : serial_bubbles)
+		{
+			bubble->step(steps);
+		}
+	}
+
+	for(VehicleCommandBuffer& buffer : bubble_buffers)
+	{
+		buffer.apply();
+	}
+}
+
+void Universe::set_physics_bubbles(double radius, int low_rate)
+{
+	if(low_rate < 1 || low_rate > PhysicsBubble::MAX_RATE_DIVIDER)
+	{
+		logger->warn("Invalid bubble low rate divider ({}), must be between 1 and {}", 
+			low_rate, PhysicsBubble::MAX_RATE_DIVIDER);
+		low_rate = glm::clamp(low_rate, 1, PhysicsBubble::MAX_RATE_DIVIDER);
+	}
+
+	bubble_radius = radius;
+	bubble_low_rate = low_rate;
+}
 
+void Universe::set_update_threads(size_t count)
+{
+	delete update_jobs;
+	update_jobs = nullptr;
+
+	if(count > 0)
+	{
+		update_jobs = new JobPool(count);
+	}
 }
 
 int64_t Universe::get_uid()
@@ -84,32 +590,120 @@ int64_t Universe::get_uid()
 
 Entity* Universe::get_entity(int64_t uid)
 {
-	auto it = entities_by_id.find(uid);
-	if(it == entities_by_id.end())
+	return entities.get_by_uid(uid);
+}
+
+
+void Universe::create_world(size_t threads, bool multibody)
+{
+	bt_brf_interface = new btDbvtBroadphase();
+
+	if(multibody)
+	{
+		if(threads > 0)
+		{
+			logger->warn("The multibody physics world is single threaded, ignoring physics threads");
+		}
+
+		bt_collision_config = new btDefaultCollisionConfiguration();
+		bt_dispatcher = new btCollisionDispatcher(bt_collision_config);
+		btMultiBodyConstraintSolver* mb_solver = new btMultiBodyConstraintSolver();
+		bt_solver = mb_solver;
+		bt_solver_pool = nullptr;
+		bt_world = new btMultiBodyDynamicsWorld(bt_dispatcher, bt_brf_interface, mb_solver, bt_collision_config);
+	}
+	else if(threads == 0)
+	{
+		bt_collision_config = new btDefaultCollisionConfiguration();
+		bt_dispatcher = new btCollisionDispatcher(bt_collision_config);
+		bt_solver = new btSequentialImpulseConstraintSolver();
+		bt_solver_pool = nullptr;
+		bt_world = new btDiscreteDynamicsWorld(bt_dispatcher, bt_brf_interface, bt_solver, bt_collision_config);
+	}
+	else
 	{
-		return nullptr;
+		// The scheduler is global to bullet, only the first one is kept
+		if(btGetTaskScheduler() == nullptr || btGetTaskScheduler() == btGetSequentialTaskScheduler())
+		{
+			btITaskScheduler* scheduler = btGetOpenMPTaskScheduler();
+			if(scheduler == nullptr)
+			{
+				scheduler = btGetTBBTaskScheduler();
+			}
+			if(scheduler == nullptr)
+			{
+				scheduler = btCreateDefaultTaskScheduler();
+			}
+
+			if(scheduler == nullptr)
+			{
+				logger->warn("Bullet was built without multithreading, physics will run on one thread");
+				scheduler = btGetSequentialTaskScheduler();
+			}
+			else
+			{
+				logger->info("Using bullet task scheduler '{}'", scheduler->getName());
+			}
+
+			scheduler->setNumThreads((int)threads);
+			btSetTaskScheduler(scheduler);
+		}
+
+		btDefaultCollisionConstructionInfo info = btDefaultCollisionConstructionInfo();
+		// Threads create manifolds at the same time, so the pool must not run out
+		info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+		info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+		bt_collision_config = new btDefaultCollisionConfiguration(info);
+		bt_dispatcher = new btCollisionDispatcherMt(bt_collision_config);
+		bt_solver_pool = new btConstraintSolverPoolMt((int)threads);
+		bt_solver = new btSequentialImpulseConstraintSolverMt();
+		bt_world = new btDiscreteDynamicsWorldMt(bt_dispatcher, bt_brf_interface, bt_solver_pool, 
+			bt_solver, bt_collision_config);
 	}
 
-	return it->second;
+	bt_ground_func = new GroundCollisionAlgorithm::CreateFunc(bt_collision_config, &ground_collision_stats);
+	GroundCollisionAlgorithm::register_on(bt_dispatcher, bt_ground_func);
+
+	bt_world->setGravity({ 0.0, 0.0, 0.0 });
+
+	bt_world->setDebugDrawer(bt_debug);
+
+	// Called from the stepping thread before every substep, not from 
+	// the workers, so the physics updates don't need to be thread safe
+	bt_world->setInternalTickCallback(bullet_tick, this, true);
+}
+
+void Universe::destroy_world()
+{
+	delete bt_world;
+	delete bt_solver;
+	delete bt_solver_pool;
+	delete bt_dispatcher;
+	delete bt_ground_func;
+	delete bt_collision_config;
+	delete bt_brf_interface;
 }
 
+void Universe::set_physics_world(size_t threads, bool multibody)
+{
+	logger->check(entities.empty(), "The physics world must be set before creating entities");
+
+	destroy_world();
+	create_world(threads, multibody);
+	multibody_world = multibody;
+}
 
 Universe::Universe() : system(this)
 {
 	uid = 0;
 	paused = false;
-
-	bt_collision_config = new btDefaultCollisionConfiguration();
-	bt_dispatcher = new btCollisionDispatcher(bt_collision_config);
-	bt_brf_interface = new btDbvtBroadphase();
-	bt_solver = new btSequentialImpulseConstraintSolver();
-	bt_world = new btDiscreteDynamicsWorld(bt_dispatcher, bt_brf_interface, bt_solver, bt_collision_config);
-	
-	bt_world->setGravity({ 0.0, 0.0, 0.0 });
+	update_jobs = nullptr;
+	multibody_world = false;
+	bubble_radius = 0.0;
+	bubble_low_rate = 1;
+	physics_steps = 0;
 
 	bt_debug = new BulletDebugDrawer();
-	bt_world->setDebugDrawer(bt_debug);
-
 
 	bt_debug->setDebugMode(
 		btIDebugDraw::DBG_DrawConstraints |
@@ -118,9 +712,7 @@ Universe::Universe() : system(this)
 		btIDebugDraw::DBG_DrawConstraintLimits |
 		btIDebugDraw::DBG_DrawAabb);
 	
-
-	bt_world->setInternalTickCallback(bullet_tick, this, true);
-
+	create_world(0, false);
 }
 
 
@@ -130,4 +722,11 @@ Universe::~Universe()
 	{
 		delete ent;
 	}
+
+	for(PhysicsBubble* bubble : bubbles)
+	{
+		delete bubble;
+	}
+
+	delete update_jobs;
 }
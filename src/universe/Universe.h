@@ -4,13 +4,23 @@
 #include <any>
 #include <renderer/Renderer.h>
 #include <unordered_set>
+#include <mutex>
 #include "Events.h"
 #pragma warning(push, 0)
 #include <btBulletDynamicsCommon.h>
 #include <BulletDynamics/ConstraintSolver/btNNCGConstraintSolver.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
 #pragma warning(pop)
 
 #include <physics/debug/BulletDebugDrawer.h>
+#include <physics/ground/GroundCollisionAlgorithm.h>
+#include <util/JobPool.h>
+#include "vehicle/VehicleCommandBuffer.h"
+#include "PhysicsBubble.h"
 
 // The Universe is the central class of the game. It stores both the system
 // and everything else in the system (buildings and vehicles).
@@ -19,8 +29,12 @@
 // Note that events are implemented fully dynamic as they are needed
 // from the lua side. Otherwise we could simply use a events library.
 //
-// Events can carry any set of arguments, handled as a std::vector<std::any>
+// Events can carry any set of arguments, handled as EventArguments (see Events.h)
 // It's up to the event how are these arguments handled.
+// Events are identified by EventId, the hash of their name. Core events have
+// their ids in CoreEvents, others can be used by name, which is hashed each time.
+// emit_event calls the receivers right away, queue_event leaves the event
+// for dispatch_events, at the end of update.
 // Global events have "emitter" set to nullptr
 // Event naming:
 // - OSPGL events are prefixed with 'core:'
@@ -34,20 +48,67 @@ class Universe
 {
 private:
 
-	std::unordered_map<std::string, std::unordered_set<EventHandler, EventHandlerHasher>> event_receivers;
+	std::unordered_map<EventId, std::unordered_set<EventHandler, EventHandlerHasher>> event_receivers;
+	// Names of the events signed up for, to catch hash collisions
+	std::unordered_map<EventId, std::string> event_names;
 
-	std::unordered_set<EventHandler, EventHandlerHasher>& index_event_receivers(const std::string& str);
+	struct QueuedEvent
+	{
+		EventId id;
+		EventArguments args;
+	};
+
+	// Filled from any thread, dispatched in batches from the main thread
+	std::vector<QueuedEvent> event_queue;
+	std::vector<QueuedEvent> event_batch;
+	std::mutex event_queue_mtx;
+
+	// Calls the receivers right away, only from the main thread
+	void call_receivers(EventId event_id, EventArguments& args);
 
 
 	btDefaultCollisionConfiguration* bt_collision_config;
 	btCollisionDispatcher* bt_dispatcher;
 	btBroadphaseInterface* bt_brf_interface;
-	btSequentialImpulseConstraintSolver* bt_solver;
+	btConstraintSolver* bt_solver;
+	// Only on the multithreaded world
+	btConstraintSolverPoolMt* bt_solver_pool;
+	GroundCollisionAlgorithm::CreateFunc* bt_ground_func;
 
 	BulletDebugDrawer* bt_debug;
 
 	int64_t uid;
 
+	// Runs the parallel phase of update, nullptr if disabled
+	JobPool* update_jobs;
+	// Entities sharing an update group are updated by the same job,
+	// in order, recording into the job's command buffer
+	std::vector<std::vector<Entity*>> update_groups;
+	std::vector<VehicleCommandBuffer> update_buffers;
+
+	void update_parallel(double dt);
+
+	// threads = 0 creates the single threaded world
+	void create_world(size_t threads, bool multibody);
+	void destroy_world();
+	bool multibody_world;
+
+	// Physics bubbles, empty if disabled (bubble_radius = 0)
+	std::vector<PhysicsBubble*> bubbles;
+	double bubble_radius;
+	// Rate divider of bubbles where every entity is timewarp_safe
+	int bubble_low_rate;
+	// Steps taken by bt_world in the current update, bubbles take as many
+	int physics_steps;
+	// Each job steps a set of bubbles on a thread, recording into its buffer
+	std::vector<std::vector<PhysicsBubble*>> bubble_jobs;
+	std::vector<VehicleCommandBuffer> bubble_buffers;
+
+	// Clusters the physics loaders and moves entities between bubbles
+	// and the main world as needed
+	void update_bubbles();
+	void step_bubbles();
+
 public:
 
 	// Should updates run?
@@ -55,27 +116,52 @@ public:
 
 	friend class Entity;
 	friend class GameState;
+	friend class QuickSave;
 
 	static constexpr double PHYSICS_STEPSIZE = 1.0 / 30.0;
 	static constexpr int MAX_PHYSICS_STEPS = 1;
 
 
-	void sign_up_for_event(const std::string& event_id, EventHandler id);
-	void drop_out_of_event(const std::string& event_id, EventHandler id);
-	void emit_event(const std::string& event_id, EventArguments args = EventArguments());
-	template<typename... Args>
-	void emit_event(const std::string& event_id, Args&&... args)
+	// During the parallel update, signing up and dropping out happen once it ends
+	void sign_up_for_event(std::string_view event_name, EventHandler id);
+	void sign_up_for_event(EventId event_id, EventHandler id);
+	void drop_out_of_event(EventId event_id, EventHandler id);
+	void drop_out_of_event(std::string_view event_name, EventHandler id)
 	{
-		EventArguments vc {args...};
-		emit_event(event_id, vc);	
+		drop_out_of_event(hash_event_id(event_name), id);
 	}
 
+	// During the parallel update (and physics bubbles) events are queued instead
+	void emit_event(EventId event_id, EventArguments args = EventArguments());
+	void emit_event(std::string_view event_name, EventArguments args = EventArguments())
+	{
+		emit_event(hash_event_id(event_name), std::move(args));
+	}
+	template<typename... Args, typename = EnableIfEventValues<Args...>>
+	void emit_event(EventId event_id, Args&&... args)
+	{
+		emit_event(event_id, EventArguments{ EventArgument(std::forward<Args>(args))... });
+	}
+	template<typename... Args, typename = EnableIfEventValues<Args...>>
+	void emit_event(std::string_view event_name, Args&&... args)
+	{
+		emit_event(hash_event_id(event_name), EventArguments{ EventArgument(std::forward<Args>(args))... });
+	}
+
+	// Safe from any thread, receivers are called from dispatch_events
+	void queue_event(EventId event_id, EventArguments args = EventArguments());
+	// Called at the end of update. Events queued by the receivers are dispatched
+	// too, events with the same id one after another share the receiver lookup
+	void dispatch_events();
+
 
 	btDiscreteDynamicsWorld* bt_world;
 
+	// Of all worlds (bubbles too), the last tick is the one before the current update
+	GroundCollisionStats ground_collision_stats;
+
 	PlanetarySystem system;
-	std::vector<Entity*> entities;
-	std::unordered_map<int64_t, Entity*> entities_by_id;
+	EntityRegistry entities;
 
 	template<typename T, typename... Args> 
 	T* create_entity(Args&&... args);
@@ -85,6 +171,8 @@ public:
 
 	// Returns nullptr if not found
 	Entity* get_entity(int64_t id);
+	// Returns nullptr if the entity was removed
+	Entity* get_entity(EntityHandle handle) { return entities.get(handle); }
 
 	template<typename T> 
 	T* get_entity_as(int64_t id);
@@ -95,6 +183,31 @@ public:
 	
 	int64_t get_uid();
 
+	// Number of worker threads used to update entities in parallel (besides
+	// the main thread), 0 updates everything on the main thread
+	void set_update_threads(size_t count);
+
+	// Rebuilds the bullet world as a btDiscreteDynamicsWorldMt using threads
+	// threads, or the single threaded world if threads is 0. 
+	// If multibody is true, the world is a btMultiBodyDynamicsWorld and vehicles
+	// are simulated as featherstone multibodies (see MultiBodyVehicle), it's
+	// always single threaded.
+	// Must be called before anything is added to the world.
+	// Note: Bullet must be built with BT_THREADSAFE (OSP_BULLET_MULTITHREADING)
+	// for the world to actually use threads
+	void set_physics_world(size_t threads, bool multibody);
+
+	// Physics loaders (unpacked vehicles) whose bounds are closer than radius are 
+	// simulated together in a PhysicsBubble, with its own bullet world, and
+	// everything near them (buildings) is moved there. Anything else stays on 
+	// bt_world. 0 disables bubbles.
+	// Bubbles step in parallel on the update threads, only if bullet is built
+	// thread safe (OSP_BULLET_MULTITHREADING), otherwise one after another.
+	// Bubbles where every entity is timewarp_safe (far from surfaces and
+	// atmospheres) step once every low_rate ticks (see PhysicsBubble), 1 
+	// steps every bubble every tick
+	void set_physics_bubbles(double radius, int low_rate = 1);
+
 	Universe();
 	~Universe();
 };
@@ -109,13 +222,14 @@ inline T* Universe::create_entity(Args&&... args)
 
 	int64_t id = get_uid();
 
-	entities.push_back((Entity*)n_ent);
-	entities_by_id[id] =  as_ent;
+	entities.add(as_ent, id);
 
-	emit_event("core:new_entity", id);
-	
 	as_ent->setup(this, id);
 
+	// Entities are often created in bursts (separation), receivers get them
+	// together at the end of the update
+	queue_event(CoreEvents::NEW_ENTITY, EventArguments{ id });
+
 	return n_ent;
 }
 
@@ -125,19 +239,16 @@ inline void Universe::remove_entity(T* ent)
 	static_assert(std::is_base_of<Entity, T>::value, "Entities must inherit from the Entity class");
 
 	Entity* as_ent = (Entity*)ent;
-	for (auto it = entities.begin(); it != entities.end(); it++)
-	{
-		if (*it == ent)
-		{
-			entities.erase(it);
-			break;
-		}
-	}
 
-	emit_event("core:remove_entity", as_ent->get_uid());
+	// emit_event would queue the event during the parallel update, and 
+	// receivers would get it once the entity is deleted
+	logger->check(VehicleCommandBuffer::current == nullptr, "Entities must be removed from the main thread");
+
+	// Receivers may still look the entity up
+	EventArguments args = EventArguments{ as_ent->get_uid() };
+	call_receivers(CoreEvents::REMOVE_ENTITY, args);
 
-	// Remove from entities by id
-	entities_by_id.erase(as_ent->get_uid());
+	entities.remove(as_ent);
 	
 	// Actually destroy the entity
 	delete ent;
@@ -26,6 +26,12 @@ struct SurfaceConfig
 	// will break
 	double max_height;
 
+	// A rough estimate of minimum height from sea-level (usually
+	// negative). Make sure it's lower than the actual minimum height,
+	// otherwise tiles near the horizon will be culled.
+	// Defaults to -max_height
+	double min_height;
+
 };
 
 template<>
@@ -65,6 +71,7 @@ public:
 		SAFE_TOML_GET(to.depth_for_unload, "lod.depth_for_unload", int)
 
 		SAFE_TOML_GET(to.max_height, "max_height", double);
+		SAFE_TOML_GET_OR(to.min_height, "min_height", double, -to.max_height);
 
 		to.script_path = assets->resolve_path(to.script_path_raw);
 	}
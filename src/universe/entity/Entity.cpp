@@ -34,3 +34,23 @@ Entity* Entity::load_entity(std::string type, cpptoml::table& toml)
 
 	return n_ent;
 }
+
+Entity* Entity::load_entity_binary(const std::string& type, BinaryReader& reader)
+{
+	Entity* n_ent = nullptr;
+
+	if (type == "vehicle")
+	{
+		n_ent = new VehicleEntity(reader);
+	}
+	else if (type == "building")
+	{
+		n_ent = new BuildingEntity(reader);
+	}
+	else
+	{
+		logger->fatal("Unknown entity type '{}'", type);
+	}
+
+	return n_ent;
+}
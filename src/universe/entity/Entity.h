@@ -9,6 +9,8 @@
 #include <set>
 
 #include <cpptoml.h>
+#include <util/BinaryUtil.h>
+#include "EntityRegistry.h"
 
 // An entity is something which exists on the world, 
 // it has graphics, and can exists on the bullet physics
@@ -35,14 +37,25 @@ private:
 	bool bullet_enabled;
 
 	int64_t uid;
+	// Set by the registry
+	EntityHandle handle;
 
 public:
 
+	friend class EntityRegistry;
+
 	// You should start simulating bullet physics here
 	virtual void enable_bullet(btDynamicsWorld* world) {}
 	// You must stop simulating bullet physics here
 	virtual void disable_bullet(btDynamicsWorld* world) {}
 
+	// The bullet world we simulate in, the universe's or the one of a
+	// physics bubble. nullptr if we have nothing in bullet
+	virtual btDynamicsWorld* get_bullet_world() { return nullptr; }
+	// Moves everything we have in bullet to another world, keeping its state
+	// (Used for physics bubbles)
+	virtual void move_to_world(btDynamicsWorld* world) {}
+
 	// Return our position to be used by physics loading
 	virtual glm::dvec3 get_physics_origin() { return glm::dvec3(0, 0, 0); }
 
@@ -57,10 +70,20 @@ public:
 	// Visual update, always realtime
 	virtual void update(double dt) {};
 
+	// Return non-null if update only touches this entity, and modifies bullet 
+	// through VehicleCommandBuffer, so it may run in parallel with others.
+	// Entities returning the same group are updated together on one thread
+	virtual void* get_update_group() { return nullptr; }
+
 	// Ticks alongside bullet (bullet tick callback)
 	// Note: Ticks before bullet update! (pretick)
 	virtual void physics_update(double pdt) {};
 
+	// Called once every update, after all physics worlds stepped and before
+	// any entity updates. Entities may run on different threads, only
+	// touch your own state
+	virtual void post_physics_update() {};
+
 	// Called when the entity is added into the universe
 	// Universe is already initialized
 	virtual void init() {};
@@ -82,6 +105,11 @@ public:
 		return universe;
 	}
 
+	inline EntityHandle get_handle()
+	{
+		return handle;
+	}
+
 	void enable_bullet_wrapper(bool value, btDynamicsWorld* world)
 	{
 		bullet_enabled = value;
@@ -101,5 +129,10 @@ public:
 	// Used while loading saves 
 	static Entity* load_entity(std::string type, cpptoml::table& toml);
 
+	// Used by quicksaves, write what's needed to create the entity again
+	// as it is now (see QuickSave), read by load_entity_binary
+	virtual void write_binary(BinaryWriter& writer) = 0;
+	static Entity* load_entity_binary(const std::string& type, BinaryReader& reader);
+
 	virtual ~Entity();
 };
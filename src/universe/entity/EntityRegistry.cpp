@@ -0,0 +1,137 @@
+#include "EntityRegistry.h"
+#include "Entity.h"
+#include <util/Logger.h>
+#include "entities/VehicleEntity.h"
+#include "entities/BuildingEntity.h"
+
+EntityHandle EntityRegistry::add(Entity* entity, int64_t uid)
+{
+	logger->check(uid_to_slot.find(uid) == uid_to_slot.end(), "Duplicate entity uid {}", uid);
+
+	uint32_t index;
+	if(free_slots.empty())
+	{
+		index = (uint32_t)slots.size();
+		slots.emplace_back();
+		slots[index].generation = 0;
+	}
+	else
+	{
+		index = free_slots.back();
+		free_slots.pop_back();
+	}
+
+	Slot& slot = slots[index];
+	slot.entity = entity;
+	slot.uid = uid;
+	slot.all_index = all.size();
+	all.push_back(entity);
+
+	// Only once, every update then goes straight to the right array
+	if(VehicleEntity* as_vehicle = dynamic_cast<VehicleEntity*>(entity))
+	{
+		slot.kind = VEHICLE;
+		slot.kind_index = vehicles.size();
+		vehicles.push_back(as_vehicle);
+	}
+	else if(BuildingEntity* as_building = dynamic_cast<BuildingEntity*>(entity))
+	{
+		slot.kind = BUILDING;
+		slot.kind_index = buildings.size();
+		buildings.push_back(as_building);
+	}
+	else
+	{
+		slot.kind = OTHER;
+		slot.kind_index = others.size();
+		others.push_back(entity);
+	}
+
+	uid_to_slot[uid] = index;
+
+	EntityHandle handle = EntityHandle(index, slot.generation);
+	entity->handle = handle;
+	return handle;
+}
+
+template<typename T>
+void EntityRegistry::swap_remove(std::vector<T*>& array, size_t index, bool kind_array)
+{
+	T* last = array.back();
+	array[index] = last;
+	array.pop_back();
+
+	if(index < array.size())
+	{
+		Slot& moved = slots[((Entity*)last)->handle.index];
+		if(kind_array)
+		{
+			moved.kind_index = index;
+		}
+		else
+		{
+			moved.all_index = index;
+		}
+	}
+}
+
+void EntityRegistry::remove(Entity* entity)
+{
+	EntityHandle handle = entity->handle;
+	logger->check(get(handle) == entity, "Tried to remove an entity which is not in the registry");
+
+	Slot& slot = slots[handle.index];
+	swap_remove(all, slot.all_index, false);
+
+	switch(slot.kind)
+	{
+	case VEHICLE:
+		swap_remove(vehicles, slot.kind_index, true);
+		break;
+	case BUILDING:
+		swap_remove(buildings, slot.kind_index, true);
+		break;
+	case OTHER:
+		swap_remove(others, slot.kind_index, true);
+		break;
+	}
+
+	uid_to_slot.erase(slot.uid);
+
+	slot.entity = nullptr;
+	slot.generation++;
+	free_slots.push_back(handle.index);
+	entity->handle = EntityHandle();
+}
+
+Entity* EntityRegistry::get(EntityHandle handle) const
+{
+	if(handle.index >= slots.size() || slots[handle.index].generation != handle.generation)
+	{
+		return nullptr;
+	}
+
+	return slots[handle.index].entity;
+}
+
+Entity* EntityRegistry::get_by_uid(int64_t uid) const
+{
+	auto it = uid_to_slot.find(uid);
+	if(it == uid_to_slot.end())
+	{
+		return nullptr;
+	}
+
+	return slots[it->second].entity;
+}
+
+EntityHandle EntityRegistry::get_handle(int64_t uid) const
+{
+	auto it = uid_to_slot.find(uid);
+	if(it == uid_to_slot.end())
+	{
+		return EntityHandle();
+	}
+
+	return EntityHandle(it->second, slots[it->second].generation);
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+class Entity;
+class VehicleEntity;
+class BuildingEntity;
+
+// Refers to an entity without a lookup, and without dangling: once the entity
+// is removed its handle resolves to nullptr, even if the slot is reused
+struct EntityHandle
+{
+	uint32_t index;
+	uint32_t generation;
+
+	static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+	bool operator==(const EntityHandle& o) const { return index == o.index && generation == o.generation; }
+	bool operator!=(const EntityHandle& o) const { return !(*this == o); }
+
+	EntityHandle() : index(INVALID), generation(0) {}
+	EntityHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+};
+
+// Stores the entities of the universe as a slot map: slots are reused, and
+// a generation counter per slot invalidates handles to removed entities.
+// Besides the array of every entity, entities are kept in an array per type 
+// (vehicles, buildings, anything else), so updates iterate each type on its
+// own and call the (final) entity classes directly, instead of going through
+// the virtual functions of every entity.
+// Adding and removing are O(1), removal swaps the last entity of each array
+// in, so the order of the arrays changes.
+class EntityRegistry
+{
+private:
+
+	enum Kind : uint32_t
+	{
+		VEHICLE,
+		BUILDING,
+		OTHER
+	};
+
+	struct Slot
+	{
+		Entity* entity;
+		int64_t uid;
+		uint32_t generation;
+		Kind kind;
+		// Position in all and in the array of its kind
+		size_t all_index;
+		size_t kind_index;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+
+	std::vector<Entity*> all;
+	std::vector<VehicleEntity*> vehicles;
+	std::vector<BuildingEntity*> buildings;
+	std::vector<Entity*> others;
+
+	// uids are what saves and events use, handles are for the code
+	std::unordered_map<int64_t, uint32_t> uid_to_slot;
+
+	template<typename T>
+	void swap_remove(std::vector<T*>& array, size_t index, bool kind_array);
+
+public:
+
+	// The entity must not be set up yet, its handle is set here
+	EntityHandle add(Entity* entity, int64_t uid);
+	// Doesn't delete the entity
+	void remove(Entity* entity);
+
+	// nullptr if the entity was removed
+	Entity* get(EntityHandle handle) const;
+	// nullptr if not found
+	Entity* get_by_uid(int64_t uid) const;
+	EntityHandle get_handle(int64_t uid) const;
+
+	const std::vector<VehicleEntity*>& get_vehicles() const { return vehicles; }
+	const std::vector<BuildingEntity*>& get_buildings() const { return buildings; }
+	// Entities of any other type
+	const std::vector<Entity*>& get_others() const { return others; }
+
+	// Calls f with every entity, as its final type (VehicleEntity*, BuildingEntity*,
+	// or Entity* for other types), a type at a time. Entities added meanwhile are 
+	// also visited, don't remove entities from f
+	template<typename F>
+	void for_each_typed(F&& f)
+	{
+		for(size_t i = 0; i < vehicles.size(); i++) f(vehicles[i]);
+		for(size_t i = 0; i < buildings.size(); i++) f(buildings[i]);
+		for(size_t i = 0; i < others.size(); i++) f(others[i]);
+	}
+
+	// Every entity, in no particular order
+	std::vector<Entity*>::const_iterator begin() const { return all.begin(); }
+	std::vector<Entity*>::const_iterator end() const { return all.end(); }
+	size_t size() const { return all.size(); }
+	bool empty() const { return all.empty(); }
+	Entity* operator[](size_t i) const { return all[i]; }
+};
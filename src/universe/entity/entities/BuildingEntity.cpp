@@ -21,6 +21,8 @@ glm::dmat4 BuildingEntity::get_model_matrix(bool bullet)
 BuildingEntity::BuildingEntity(AssetHandle<BuildingPrototype>&& proto)
 {
 	this->proto = std::move(proto);
+	this->rigid = nullptr;
+	this->world = nullptr;
 }
 
 BuildingEntity::BuildingEntity(cpptoml::table& toml) 
@@ -31,12 +33,47 @@ BuildingEntity::BuildingEntity(cpptoml::table& toml)
 	glm::dvec3 rel_pos; SerializeUtil::read_to(toml, rel_pos, "rel_pos");
 	glm::dquat rel_rot; SerializeUtil::read_to(toml, rel_rot, "rel_rot");
 	this->traj.set_parameters(body, rel_pos, rel_rot);
+	this->rigid = nullptr;
+	this->world = nullptr;
 }
 
 
-BuildingEntity::~BuildingEntity()
+BuildingEntity::BuildingEntity(BinaryReader& reader)
+{
+	std::string pkg = reader.read_string();
+	std::string name = reader.read_string();
+	this->proto = AssetHandle<BuildingPrototype>(pkg, name);
+
+	std::string body = reader.read_string();
+	glm::dvec3 rel_pos;
+	rel_pos.x = reader.read<double>(); rel_pos.y = reader.read<double>(); rel_pos.z = reader.read<double>();
+	glm::dquat rel_rot;
+	rel_rot.x = reader.read<double>(); rel_rot.y = reader.read<double>(); 
+	rel_rot.z = reader.read<double>(); rel_rot.w = reader.read<double>();
+	this->traj.set_parameters(body, rel_pos, rel_rot);
+	this->rigid = nullptr;
+	this->world = nullptr;
+}
+
+void BuildingEntity::write_binary(BinaryWriter& writer)
 {
+	writer.write_string(proto.pkg);
+	writer.write_string(proto.name);
+
+	writer.write_string(traj.get_body_name());
+	glm::dvec3 rel_pos = traj.get_relative_pos();
+	writer.write(rel_pos.x); writer.write(rel_pos.y); writer.write(rel_pos.z);
+	glm::dquat rel_rot = traj.get_relative_rotation();
+	writer.write(rel_rot.x); writer.write(rel_rot.y); writer.write(rel_rot.z); writer.write(rel_rot.w);
+}
 
+BuildingEntity::~BuildingEntity()
+{
+	// Otherwise the rigidbody would stay in the world
+	if(rigid != nullptr)
+	{
+		disable_bullet(world);
+	}
 }
 
 void BuildingEntity::enable_bullet(btDynamicsWorld* world)
@@ -49,11 +86,35 @@ void BuildingEntity::enable_bullet(btDynamicsWorld* world)
 	rigid->setActivationState(DISABLE_DEACTIVATION);
 
 	world->addRigidBody(rigid);
+	this->world = world;
 }
 
 void BuildingEntity::disable_bullet(btDynamicsWorld* world)
 {
+	world->removeRigidBody(rigid);
+	delete rigid;
+	rigid = nullptr;
+	this->world = nullptr;
+}
+
+void BuildingEntity::move_to_world(btDynamicsWorld* n_world)
+{
+	world->removeRigidBody(rigid);
+	n_world->addRigidBody(rigid);
+	world = n_world;
+}
 
+glm::dvec3 BuildingEntity::get_physics_origin()
+{
+	return traj.get_state(0, 0, true).cartesian.pos;
+}
+
+double BuildingEntity::get_physics_radius()
+{
+	btVector3 center;
+	btScalar radius;
+	proto->collider->getBoundingSphere(center, radius);
+	return center.length() + radius;
 }
 
 void BuildingEntity::init()
@@ -4,12 +4,13 @@
 #include <assets/BuildingPrototype.h>
 
 // A Building is something fixed to the ground
-class BuildingEntity : public Entity
+class BuildingEntity final : public Entity
 {
 private:
 
 
 	btRigidBody* rigid;
+	btDynamicsWorld* world;
 	AssetHandle<BuildingPrototype> proto;
 
 	glm::dmat4 get_model_matrix(bool bullet);
@@ -21,17 +22,27 @@ public:
 
 	BuildingEntity(AssetHandle<BuildingPrototype>&& proto);
 	BuildingEntity(cpptoml::table& toml);
+	BuildingEntity(BinaryReader& reader);
 
 	~BuildingEntity();
 
 	virtual void enable_bullet(btDynamicsWorld* world) override;
 	virtual void disable_bullet(btDynamicsWorld* world) override;
+	virtual btDynamicsWorld* get_bullet_world() override { return world; }
+	virtual void move_to_world(btDynamicsWorld* n_world) override;
+
+	// Buildings only touch themselves
+	virtual void* get_update_group() override { return this; }
+
+	virtual glm::dvec3 get_physics_origin() override;
+	virtual double get_physics_radius() override;
 
 	virtual void init() override;
 
 	virtual void physics_update(double pdt) override;
 
 	virtual std::string get_type() override { return "building"; }
+	virtual void write_binary(BinaryWriter& writer) override;
 
 	virtual void deferred_pass(CameraUniforms& cu) override;
 	virtual void shadow_pass(ShadowCamera& cu) override;
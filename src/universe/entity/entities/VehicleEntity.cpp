@@ -2,11 +2,22 @@
 
 #include "../../../renderer/Renderer.h"
 #include "../../Universe.h"
+#include "../../vehicle/VehicleLoader.h"
 
 void VehicleEntity::init()
 {
-	this->vehicle->set_world(get_universe()->bt_world);
+	// Separated vehicles already are in the world of their parent
+	if(vehicle->unpacked_veh.world == nullptr)
+	{
+		this->vehicle->set_world(get_universe()->bt_world);
+	}
 	this->vehicle->init(get_universe());
+
+	if(unpack_on_init)
+	{
+		vehicle->unpack();
+		unpack_on_init = false;
+	}
 }
 
 void VehicleEntity::update(double dt)
@@ -17,25 +28,154 @@ void VehicleEntity::update(double dt)
 void VehicleEntity::physics_update(double pdt)
 {
 	auto n_vehicles = vehicle->physics_update(pdt);
+	Universe* universe = get_universe();
 	for(Vehicle* n_vehicle : n_vehicles)
 	{
-		get_universe()->create_entity<VehicleEntity>(n_vehicle);
+		// We may be ticking in a physics bubble, on another thread
+		VehicleCommandBuffer::run_deferred([universe, n_vehicle]()
+		{
+			universe->create_entity<VehicleEntity>(n_vehicle);
+		});
+	}
+}
+
+void VehicleEntity::move_to_world(btDynamicsWorld* world)
+{
+	vehicle->unpacked_veh.move_to_world(world);
+}
+
+glm::dvec3 VehicleEntity::get_physics_origin()
+{
+	return to_dvec3(vehicle->root->get_global_transform().getOrigin());
+}
+
+double VehicleEntity::get_physics_radius()
+{
+	btVector3 origin = vehicle->root->get_global_transform().getOrigin();
+	double radius = 0.0;
+	for(Piece* p : vehicle->all_pieces)
+	{
+		btVector3 center;
+		btScalar collider_radius;
+		p->collider->getBoundingSphere(center, collider_radius);
+
+		double dist = (p->get_global_transform().getOrigin() - origin).length() + center.length() + collider_radius;
+		radius = glm::max(radius, dist);
+	}
+
+	return radius;
+}
+
+bool VehicleEntity::timewarp_safe()
+{
+	PlanetarySystem& system = get_universe()->system;
+	glm::dvec3 pos = get_physics_origin();
+
+	for(size_t i = 0; i < system.elements.size(); i++)
+	{
+		SystemElement& elem = system.elements[i];
+		if(elem.type != SystemElement::BODY)
+		{
+			continue;
+		}
+
+		PlanetConfig& config = elem.as_body->config;
+		double dist = glm::distance(pos, system.bullet_states[i].pos);
+
+		double surface = config.radius + (config.has_surface ? config.surface.max_height : 0.0);
+		if(dist < surface + SURFACE_PROXIMITY)
+		{
+			return false;
+		}
+
+		if(config.has_atmo && dist < config.atmo.radius)
+		{
+			return false;
+		}
 	}
+
+	return true;
 }
 
 VehicleEntity::VehicleEntity(Vehicle* vehicle)
 {
 	this->vehicle = vehicle;
+	this->unpack_on_init = false;
 }
 
 VehicleEntity::VehicleEntity(cpptoml::table& toml)
 {
+	this->unpack_on_init = false;
+}
+
+static void write_dvec3(BinaryWriter& writer, glm::dvec3 v)
+{
+	writer.write(v.x); writer.write(v.y); writer.write(v.z);
+}
+
+static glm::dvec3 read_dvec3(BinaryReader& reader)
+{
+	glm::dvec3 out;
+	out.x = reader.read<double>(); out.y = reader.read<double>(); out.z = reader.read<double>();
+	return out;
+}
 
+VehicleEntity::VehicleEntity(BinaryReader& reader)
+{
+	VehicleSnapshot snapshot;
+	snapshot.read(reader);
+	this->vehicle = VehicleLoader(snapshot).get_vehicle();
+
+	bool packed = reader.read<uint8_t>() != 0;
+
+	WorldState st;
+	st.cartesian.pos = read_dvec3(reader);
+	st.cartesian.vel = read_dvec3(reader);
+	st.angular_velocity = read_dvec3(reader);
+	st.rotation.x = reader.read<double>(); st.rotation.y = reader.read<double>();
+	st.rotation.z = reader.read<double>(); st.rotation.w = reader.read<double>();
+	vehicle->packed_veh.set_world_state(st);
+
+	// Unpacking needs the vehicle in the world
+	this->unpack_on_init = !packed;
+}
+
+void VehicleEntity::write_binary(BinaryWriter& writer)
+{
+	VehicleSnapshot::from_vehicle(vehicle).write(writer);
+
+	// Pieces are stored relative to the root, so we only need its state
+	WorldState st;
+	if(vehicle->is_packed())
+	{
+		st = vehicle->packed_veh.get_world_state();
+	}
+	else
+	{
+		btTransform root = vehicle->root->get_global_transform();
+		st.cartesian.pos = to_dvec3(root.getOrigin());
+		st.cartesian.vel = to_dvec3(vehicle->root->get_linear_velocity());
+		st.angular_velocity = to_dvec3(vehicle->root->get_angular_velocity());
+		st.rotation = to_dquat(root.getRotation());
+	}
+
+	writer.write((uint8_t)vehicle->is_packed());
+	write_dvec3(writer, st.cartesian.pos);
+	write_dvec3(writer, st.cartesian.vel);
+	write_dvec3(writer, st.angular_velocity);
+	writer.write(st.rotation.x); writer.write(st.rotation.y);
+	writer.write(st.rotation.z); writer.write(st.rotation.w);
 }
 
 
 VehicleEntity::~VehicleEntity()
 {
+	// Otherwise the rigidbodies would stay in the world
+	if(!vehicle->is_packed())
+	{
+		vehicle->pack();
+	}
+
 	delete vehicle;
 }
 
@@ -4,10 +4,19 @@
 
 // We take ownership of the vehicle pointer (we will delete it)
 // so make sure it's heap allocated
-class VehicleEntity : public Entity
+class VehicleEntity final : public Entity
 {
+private:
+
+	// Set when loaded from a quicksave of an unpacked vehicle
+	bool unpack_on_init;
+
 public:
 
+	// Altitude over the highest terrain of a body under which
+	// we are close to its surface
+	static constexpr double SURFACE_PROXIMITY = 5000.0;
+
 	// This actually contains the representation of the vehicle,
 	// including pieces
 	Vehicle* vehicle;
@@ -15,10 +24,19 @@ public:
 
 	virtual void enable_bullet(btDynamicsWorld * world) override;
 	virtual void disable_bullet(btDynamicsWorld * world) override;
+	virtual btDynamicsWorld* get_bullet_world() override { return vehicle->unpacked_veh.world; }
+	virtual void move_to_world(btDynamicsWorld* world) override;
+
+	virtual glm::dvec3 get_physics_origin() override;
+	virtual double get_physics_radius() override;
+	virtual bool is_physics_loader() override { return !vehicle->packed; }
+	virtual bool timewarp_safe() override;
 
 	virtual void init() override;
 	virtual void update(double dt) override;
+	virtual void* get_update_group() override { return vehicle->update_group; }
 	virtual void physics_update(double pdt) override;
+	virtual void post_physics_update() override { vehicle->update_piece_cache(); }
 
 	virtual void deferred_pass(CameraUniforms& camera_uniforms) override;
 	virtual bool needs_deferred_pass() override { return true; }
@@ -28,8 +46,11 @@ public:
 
 	VehicleEntity(Vehicle* vehicle);
 	VehicleEntity(cpptoml::table& toml);
+	VehicleEntity(BinaryReader& reader);
 	~VehicleEntity();
 
+	virtual void write_binary(BinaryWriter& writer) override;
+
 	virtual std::string get_type() override { return "vehicle"; }
 };
 
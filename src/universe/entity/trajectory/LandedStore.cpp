@@ -0,0 +1,117 @@
+#include "LandedStore.h"
+#include "../../PlanetarySystem.h"
+
+LandedStore::BodyFrame LandedStore::get_frame(PlanetarySystem& system, size_t body, bool bullet)
+{
+	PlanetaryBody* pbody = system.elements[body].as_body;
+	const CartesianState& state = bullet ? system.bullet_states[body] : system.states_now[body];
+	double tnow = bullet ? system.bt : system.t;
+
+	BodyFrame frame;
+	frame.pos = state.pos;
+	frame.vel = state.vel;
+	frame.rot_matrix = glm::dmat3(pbody->build_rotation_matrix(system.t0, tnow, false));
+	frame.rot = glm::quat_cast(frame.rot_matrix);
+	frame.omega = glm::normalize(pbody->rotation_axis) * glm::radians(pbody->rotation_speed);
+
+	return frame;
+}
+
+void LandedStore::update_entries(BodyEntries& entries, const BodyFrame& frame, int set, size_t first, size_t last)
+{
+	const glm::dvec3* rel_pos = entries.rel_pos.data();
+	const glm::dquat* rel_rot = entries.rel_rot.data();
+	glm::dvec3* pos = entries.pos[set].data();
+	glm::dquat* rot = entries.rot[set].data();
+	glm::dvec3* vel = entries.vel[set].data();
+
+	for(size_t i = first; i < last; i++)
+	{
+		glm::dvec3 rel = frame.rot_matrix * rel_pos[i];
+		pos[i] = frame.pos + rel;
+		rot[i] = frame.rot * rel_rot[i];
+		// Tangential velocity
+		vel[i] = frame.vel + glm::cross(frame.omega, rel);
+	}
+}
+
+LandedStore::Handle LandedStore::add(PlanetarySystem& system, const std::string& body_name, 
+	glm::dvec3 rel_pos, glm::dquat rel_rot)
+{
+	Handle handle;
+	handle.body = system.get_element_index_from_name(body_name);
+	logger->check(system.elements[handle.body].type == SystemElement::BODY, 
+		"Tried to land on '{}', which is not a body", body_name);
+
+	if(bodies.size() < system.elements.size())
+	{
+		bodies.resize(system.elements.size());
+	}
+
+	BodyEntries& entries = bodies[handle.body];
+	if(entries.free.empty())
+	{
+		handle.index = entries.rel_pos.size();
+		entries.rel_pos.push_back(rel_pos);
+		entries.rel_rot.push_back(rel_rot);
+		for(int set = 0; set < 2; set++)
+		{
+			entries.pos[set].emplace_back();
+			entries.rot[set].emplace_back();
+			entries.vel[set].emplace_back();
+		}
+	}
+	else
+	{
+		handle.index = entries.free.back();
+		entries.free.pop_back();
+		entries.rel_pos[handle.index] = rel_pos;
+		entries.rel_rot[handle.index] = rel_rot;
+	}
+
+	// The states may not be there yet if the system was never updated
+	for(int set = 0; set < 2; set++)
+	{
+		const StateVector& states = set == 1 ? system.bullet_states : system.states_now;
+		if(handle.body < states.size())
+		{
+			update_entries(entries, get_frame(system, handle.body, set == 1), set, handle.index, handle.index + 1);
+		}
+	}
+
+	return handle;
+}
+
+void LandedStore::remove(Handle handle)
+{
+	bodies[handle.body].free.push_back(handle.index);
+}
+
+void LandedStore::update(PlanetarySystem& system, bool bullet)
+{
+	int set = bullet ? 1 : 0;
+	for(size_t body = 0; body < bodies.size(); body++)
+	{
+		BodyEntries& entries = bodies[body];
+		if(entries.rel_pos.empty())
+		{
+			continue;
+		}
+
+		update_entries(entries, get_frame(system, body, bullet), set, 0, entries.rel_pos.size());
+	}
+}
+
+WorldState LandedStore::get_state(Handle handle, bool bullet) const
+{
+	int set = bullet ? 1 : 0;
+	const BodyEntries& entries = bodies[handle.body];
+
+	WorldState out;
+	out.cartesian.pos = entries.pos[set][handle.index];
+	out.cartesian.vel = entries.vel[set][handle.index];
+	out.rotation = entries.rot[set][handle.index];
+	out.angular_velocity = glm::dvec3(0, 0, 0);
+
+	return out;
+}
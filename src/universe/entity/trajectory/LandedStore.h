@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../../CartesianState.h"
+
+class PlanetarySystem;
+
+// Positions, rotations and velocities of everything landed (see LandedTrajectory),
+// stored per body as arrays and updated all at once after the system updates
+// (see PlanetarySystem::update), so the frame of each body is only built
+// once per update and state set, instead of once per landed entity
+class LandedStore
+{
+public:
+
+	struct Handle
+	{
+		size_t body;
+		size_t index;
+	};
+
+private:
+
+	struct BodyFrame
+	{
+		glm::dvec3 pos;
+		glm::dvec3 vel;
+		glm::dmat3 rot_matrix;
+		glm::dquat rot;
+		// Angular velocity, radians per second
+		glm::dvec3 omega;
+	};
+
+	struct BodyEntries
+	{
+		// Relative to the non-rotated body (t = 0 without the rotation at epoch)
+		std::vector<glm::dvec3> rel_pos;
+		std::vector<glm::dquat> rel_rot;
+
+		// Index 0 is for the render states (states_now), 1 for bullet_states
+		std::vector<glm::dvec3> pos[2];
+		std::vector<glm::dquat> rot[2];
+		std::vector<glm::dvec3> vel[2];
+
+		// Removed entries, reused by add. They are still updated
+		std::vector<size_t> free;
+	};
+
+	// Indexed by element index, empty for those with nothing landed
+	std::vector<BodyEntries> bodies;
+
+	static BodyFrame get_frame(PlanetarySystem& system, size_t body, bool bullet);
+	static void update_entries(BodyEntries& entries, const BodyFrame& frame, int set, size_t first, size_t last);
+
+public:
+
+	// The entry is given its state right away
+	Handle add(PlanetarySystem& system, const std::string& body_name, glm::dvec3 rel_pos, glm::dquat rel_rot);
+	void remove(Handle handle);
+
+	// Call once the states of the system (bullet or not) are updated
+	void update(PlanetarySystem& system, bool bullet);
+
+	WorldState get_state(Handle handle, bool bullet) const;
+};
@@ -4,69 +4,34 @@
 
 LandedTrajectory::LandedTrajectory()
 {
-	changed = true;
 	elem_name = "";	//< To crash on bad initialiations
+	in_store = false;
 }
 
 
 LandedTrajectory::~LandedTrajectory()
 {
-}
-
-WorldState LandedTrajectory::get_state(double _unused, double _unused2, bool use_bullet)
-{
-	if (changed)
-	{
-		elem_index = get_universe()->system.get_element_index_from_name(elem_name);
-		changed = false;
-	}
-
-
-	WorldState out;
-
-	SystemElement* elem = &get_universe()->system.elements[elem_index];
-	PlanetaryBody* body = elem->as_body;
-
-	double tnow;
-	if (use_bullet)
+	if (in_store)
 	{
-		tnow = get_universe()->system.bt;
-	}
-	else
-	{
-		tnow = get_universe()->system.t;
+		get_universe()->system.landed.remove(handle);
 	}
+}
 
-	glm::dmat4 rot_matrix = body->build_rotation_matrix(get_universe()->system.t0, tnow, false);
-	glm::dvec3 body_pos;
-	if (use_bullet)
-	{
-		body_pos = get_universe()->system.bullet_states[elem_index].pos;
-	}
-	else
+void LandedTrajectory::init()
+{
+	if (in_store)
 	{
-		body_pos = get_universe()->system.states_now[elem_index].pos;
+		get_universe()->system.landed.remove(handle);
 	}
 
-	glm::dmat4 body_matrix = glm::translate(glm::dmat4(1.0), body_pos);
-
-	glm::dvec3 rel_pos = glm::dvec3(rot_matrix * glm::dvec4(initial_relative_pos, 1.0));
-	glm::dvec3 tform_pos = glm::dvec3(body_matrix * glm::dvec4(rel_pos, 1.0));
-	glm::dquat tform_rot = glm::dquat(rot_matrix * glm::toMat4(initial_rotation));
-
-	out.cartesian.pos = tform_pos;
-	out.rotation = tform_rot;
-
-	// Tangential velocity
-	glm::dvec3 tang = body->get_tangential_speed(rel_pos);
-
-	out.cartesian.vel = get_universe()->system.bullet_states[elem_index].vel + tang;
-
-	out.angular_velocity = glm::dvec3(0, 0, 0);
-
-	debug_drawer->add_line(out.cartesian.pos, out.cartesian.pos + tang, glm::vec3(1.0, 0.0, 1.0));
+	handle = get_universe()->system.landed.add(get_universe()->system, elem_name, initial_relative_pos, initial_rotation);
+	in_store = true;
+}
 
-	return out;
+WorldState LandedTrajectory::get_state(double _unused, double _unused2, bool use_bullet)
+{
+	logger->check(in_store, "Tried to get the state of a landed trajectory which was not set up");
+	return get_universe()->system.landed.get_state(handle, use_bullet);
 }
 
 
@@ -75,5 +40,9 @@ void LandedTrajectory::set_parameters(std::string in_body, glm::dvec3 rel_pos, g
 	this->elem_name = in_body;
 	this->initial_relative_pos = rel_pos;
 	this->initial_rotation = rel_rot;
-	changed = true;
+
+	if (in_store)
+	{
+		init();
+	}
 }
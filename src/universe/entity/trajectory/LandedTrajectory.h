@@ -5,27 +5,31 @@
 
 // Coordinates are relative to the non-rotated planet,
 // this means t = 0 without the rotation at epoch applied
+// The trajectory must be set up (Trajectory::setup) before getting states
 class LandedTrajectory : public Trajectory
 {
 private:
 
-
-	size_t elem_index;
-
 	std::string elem_name;
 	glm::dvec3 initial_relative_pos;
 	glm::dquat initial_rotation;
 
-	bool changed;
-
-	Universe* universe;
+	// Our entry in the system's LandedStore, which computes the state
+	// of every landed trajectory together
+	LandedStore::Handle handle;
+	bool in_store;
 
 public:
 
-
+	// Only the current time (t or bt) can be obtained
 	virtual WorldState get_state(double t0, double t, bool use_bullet = false) override;
+	virtual void init() override;
 	void set_parameters(std::string body_name, glm::dvec3 rel_pos, glm::dquat rel_rot);
 
+	const std::string& get_body_name() { return elem_name; }
+	glm::dvec3 get_relative_pos() { return initial_relative_pos; }
+	glm::dquat get_relative_rotation() { return initial_rotation; }
+
 	LandedTrajectory();
 	~LandedTrajectory();
 
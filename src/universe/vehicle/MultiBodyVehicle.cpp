@@ -0,0 +1,474 @@
+#include "MultiBodyVehicle.h"
+#include "Vehicle.h"
+#include <util/DisjointSet.h>
+#include "../../physics/glm/BulletGlmCompat.h"
+#include <algorithm>
+#include <cmath>
+
+#pragma warning(push, 0)
+#include <BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointMotor.h>
+#pragma warning(pop)
+
+void MultiBodyVehicle::build(btScalar step)
+{
+	std::vector<Piece*>& pieces = vehicle->all_pieces;
+	size_t count = pieces.size();
+
+	// We need the state of every piece before anything is removed, as they
+	// may be in our old multibody
+	std::vector<btTransform> tforms(count);
+	std::vector<btVector3> linear(count);
+	std::vector<btVector3> angular(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		tforms[i] = pieces[i]->get_global_transform();
+		linear[i] = pieces[i]->get_linear_velocity();
+		angular[i] = pieces[i]->get_angular_velocity();
+	}
+
+	destroy();
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	logger->check(pieces[0] == vehicle->root, "Vehicle must be sorted to build its multibody");
+
+	// Welded sets, same as in UnpackedVehicle::build_physics
+	std::unordered_map<Piece*, size_t> piece_index;
+	piece_index.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		piece_index[pieces[i]] = i;
+	}
+
+	DisjointSet weld_sets;
+	weld_sets.reset(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		Piece* piece = pieces[i];
+		if (piece->welded && piece->attached_to != nullptr)
+		{
+			auto it = piece_index.find(piece->attached_to);
+			if (it != piece_index.end())
+			{
+				weld_sets.unite(i, it->second);
+			}
+		}
+	}
+
+	// Pieces are sorted breadth first, so the topmost piece of every set
+	// comes first, and parent bodies are created before their children
+	std::vector<size_t> set_to_body(count, count);
+	std::vector<size_t> piece_body(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t root = weld_sets.find(i);
+		if (set_to_body[root] == count)
+		{
+			set_to_body[root] = bodies.size();
+
+			Body n_body;
+			n_body.collider = nullptr;
+			n_body.link_collider = nullptr;
+			n_body.feedback = nullptr;
+			n_body.break_impulse = 0.0;
+			n_body.joint_piece = pieces[i];
+			n_body.parent = -1;
+
+			if (i != 0)
+			{
+				auto it = piece_index.find(pieces[i]->attached_to);
+				logger->check(it != piece_index.end(), "Piece attached to a piece outside the vehicle");
+				n_body.parent = (int)piece_body[it->second];
+			}
+
+			bodies.push_back(n_body);
+		}
+
+		piece_body[i] = set_to_body[root];
+		bodies[piece_body[i]].pieces.push_back(pieces[i]);
+	}
+
+	// Colliders, mass and state of every body, same as welded groups
+	for (size_t b = 0; b < bodies.size(); b++)
+	{
+		Body& body = bodies[b];
+
+		btCompoundShape temp_collider = btCompoundShape();
+		std::vector<btScalar> masses;
+		masses.reserve(body.pieces.size());
+
+		body.mass = 0.0;
+		btVector3 momentum = btVector3(0, 0, 0);
+		btVector3 ang_sum = btVector3(0, 0, 0);
+
+		for (Piece* p : body.pieces)
+		{
+			size_t i = piece_index[p];
+			temp_collider.addChildShape(tforms[i], p->collider);
+			masses.push_back(p->mass);
+			body.mass += p->mass;
+			momentum += linear[i] * p->mass;
+			ang_sum += angular[i] * p->mass;
+		}
+
+		btTransform principal;
+		temp_collider.calculatePrincipalAxisTransform(masses.data(), principal, body.inertia);
+		btTransform principal_inverse = principal.inverse();
+
+		body.collider = new btCompoundShape();
+		for (int i = 0; i < temp_collider.getNumChildShapes(); i++)
+		{
+			body.collider->addChildShape(principal_inverse * temp_collider.getChildTransform(i),
+				temp_collider.getChildShape(i));
+		}
+
+		body.collider->calculateLocalInertia(body.mass, body.inertia);
+
+		body.transform = principal;
+		body.linear = momentum / body.mass;
+		body.angular = ang_sum / body.mass;
+
+		for (Piece* p : body.pieces)
+		{
+			p->welded_tform = principal_inverse * tforms[piece_index[p]];
+			p->in_multibody = this;
+			p->multibody_body = (int)b;
+		}
+	}
+
+	// The multibody itself, joints start at 0 so everything keeps its position
+	multibody = new btMultiBody((int)bodies.size() - 1, bodies[0].mass, bodies[0].inertia, false, false);
+	multibody->setBasePos(bodies[0].transform.getOrigin());
+	multibody->setWorldToBaseRot(bodies[0].transform.getRotation().inverse());
+
+	for (size_t b = 1; b < bodies.size(); b++)
+	{
+		Piece* jp = bodies[b].joint_piece;
+		Link::MultiBodyJoint joint;
+		if (jp->link != nullptr)
+		{
+			joint = jp->link->get_multibody_joint();
+		}
+
+		create_joint(b, joint, step);
+	}
+
+	multibody->setHasSelfCollision(false);
+	multibody->setLinearDamping(0.0);
+	multibody->setAngularDamping(0.0);
+	multibody->setUseGyroTerm(true);
+	multibody->finalizeMultiDof();
+
+	// Relative motion between bodies is lost, they move rigidly with the base
+	multibody->setBaseVel(bodies[0].linear);
+	multibody->setBaseOmega(bodies[0].angular);
+
+	world->addMultiBody(multibody);
+
+	for (btMultiBodyConstraint* c : constraints)
+	{
+		world->addMultiBodyConstraint(c);
+	}
+
+	for (size_t b = 0; b < bodies.size(); b++)
+	{
+		Body& body = bodies[b];
+
+		btMultiBodyLinkCollider* col = new btMultiBodyLinkCollider(multibody, (int)b - 1);
+		col->setCollisionShape(body.collider);
+		col->setWorldTransform(body.transform);
+		col->setFriction(PIECE_DEFAULT_FRICTION);
+		col->setRestitution(PIECE_DEFAULT_RESTITUTION);
+		world->addCollisionObject(col, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+
+		if (b == 0)
+		{
+			multibody->setBaseCollider(col);
+		}
+		else
+		{
+			multibody->getLink((int)b - 1).m_collider = col;
+		}
+
+		body.link_collider = col;
+	}
+
+	btAlignedObjectArray<btQuaternion> scratch_q;
+	btAlignedObjectArray<btVector3> scratch_m;
+	multibody->forwardKinematics(scratch_q, scratch_m);
+	multibody->updateCollisionObjectWorldTransforms(scratch_q, scratch_m);
+
+	forces.assign(bodies.size(), btVector3(0, 0, 0));
+	torques.assign(bodies.size(), btVector3(0, 0, 0));
+	velocities_valid = false;
+}
+
+void MultiBodyVehicle::create_joint(size_t b, const Link::MultiBodyJoint& joint, btScalar step)
+{
+	Body& body = bodies[b];
+	Body& parent = bodies[body.parent];
+	Piece* jp = body.joint_piece;
+
+	btTransform from_frame = btTransform::getIdentity();
+	from_frame.setOrigin(to_btVector3(jp->link_from));
+	from_frame.setRotation(to_btQuaternion(jp->link_rot));
+	btTransform pivot = body.transform * jp->welded_tform * from_frame;
+
+	btQuaternion parent_rot = parent.transform.getRotation();
+	btQuaternion this_rot = body.transform.getRotation();
+
+	btQuaternion parent_to_this = this_rot.inverse() * parent_rot;
+	btVector3 parent_com_to_pivot = quatRotate(parent_rot.inverse(), pivot.getOrigin() - parent.transform.getOrigin());
+	btVector3 pivot_to_this_com = quatRotate(this_rot.inverse(), body.transform.getOrigin() - pivot.getOrigin());
+	btVector3 axis = quatRotate(this_rot.inverse(), pivot.getBasis().getColumn(2));
+
+	int link = (int)b - 1;
+	int parent_link = body.parent - 1;
+
+	if (joint.type == Link::MultiBodyJoint::REVOLUTE)
+	{
+		multibody->setupRevolute(link, body.mass, body.inertia, parent_link, parent_to_this,
+			axis, parent_com_to_pivot, pivot_to_this_com, true);
+	}
+	else if (joint.type == Link::MultiBodyJoint::PRISMATIC)
+	{
+		multibody->setupPrismatic(link, body.mass, body.inertia, parent_link, parent_to_this,
+			axis, parent_com_to_pivot, pivot_to_this_com, true);
+	}
+	else
+	{
+		multibody->setupFixed(link, body.mass, body.inertia, parent_link, parent_to_this,
+			parent_com_to_pivot, pivot_to_this_com);
+	}
+
+	if (joint.type != Link::MultiBodyJoint::FIXED && joint.has_limits)
+	{
+		constraints.push_back(new btMultiBodyJointLimitConstraint(multibody, link, joint.lower, joint.upper));
+	}
+
+	if (joint.type == Link::MultiBodyJoint::PRISMATIC && joint.stiffness > 0.0)
+	{
+		// A position motor works as a spring, the gains are the fraction of the
+		// error corrected per step, so they are derived from stiffness and damping
+		double max_force = joint.stiffness * std::max(std::abs(joint.lower), std::abs(joint.upper));
+		btMultiBodyJointMotor* motor = new btMultiBodyJointMotor(multibody, link, 0.0, max_force * step);
+		double kp = std::min(joint.stiffness * step * step / body.mass, 1.0);
+		double kd = std::max(1.0 - joint.damping, 0.0);
+		motor->setPositionTarget(0.0, kp);
+		motor->setVelocityTarget(0.0, kd);
+		constraints.push_back(motor);
+	}
+
+	body.break_impulse = joint.break_impulse;
+	if (body.break_impulse > 0.0)
+	{
+		// Must be set before finalizing so the multibody computes reaction forces
+		body.feedback = new btMultiBodyJointFeedback();
+		multibody->getLink(link).m_jointFeedback = body.feedback;
+	}
+}
+
+void MultiBodyVehicle::destroy()
+{
+	destroy_internal(true);
+}
+
+void MultiBodyVehicle::destroy_internal(bool detach_pieces)
+{
+	if (multibody == nullptr)
+	{
+		return;
+	}
+
+	for (btMultiBodyConstraint* c : constraints)
+	{
+		world->removeMultiBodyConstraint(c);
+		delete c;
+	}
+
+	constraints.clear();
+
+	for (size_t b = 0; b < bodies.size(); b++)
+	{
+		Body& body = bodies[b];
+		world->removeCollisionObject(body.link_collider);
+		delete body.link_collider;
+		delete body.collider;
+		delete body.feedback;
+
+		if (!detach_pieces)
+		{
+			continue;
+		}
+
+		// Pieces which were moved to other multibodies (separation) keep theirs
+		for (Piece* p : body.pieces)
+		{
+			if (p->in_multibody == this)
+			{
+				p->in_multibody = nullptr;
+				p->multibody_body = -1;
+			}
+		}
+	}
+
+	bodies.clear();
+
+	world->removeMultiBody(multibody);
+	delete multibody;
+	multibody = nullptr;
+}
+
+void MultiBodyVehicle::pre_tick(btVector3 gravity)
+{
+	if (multibody == nullptr)
+	{
+		return;
+	}
+
+	multibody->clearForcesAndTorques();
+
+	multibody->addBaseForce(gravity * bodies[0].mass + forces[0]);
+	multibody->addBaseTorque(torques[0]);
+
+	for (size_t b = 1; b < bodies.size(); b++)
+	{
+		multibody->addLinkForce((int)b - 1, gravity * bodies[b].mass + forces[b]);
+		multibody->addLinkTorque((int)b - 1, torques[b]);
+	}
+
+	// The step comes right after this
+	velocities_valid = false;
+}
+
+bool MultiBodyVehicle::check_breaks(btScalar step)
+{
+	if (multibody == nullptr)
+	{
+		return false;
+	}
+
+	bool any = false;
+	for (size_t b = 1; b < bodies.size(); b++)
+	{
+		Body& body = bodies[b];
+		if (body.feedback == nullptr || body.joint_piece->attached_to == nullptr)
+		{
+			continue;
+		}
+
+		// Includes the constraint (contacts, limits) forces on the joint
+		double impulse = body.feedback->m_reactionForces.getLinear().length() * step;
+		if (impulse > body.break_impulse)
+		{
+			body.joint_piece->attached_to = nullptr;
+			any = true;
+		}
+	}
+
+	return any;
+}
+
+void MultiBodyVehicle::clear_forces()
+{
+	std::fill(forces.begin(), forces.end(), btVector3(0, 0, 0));
+	std::fill(torques.begin(), torques.end(), btVector3(0, 0, 0));
+}
+
+void MultiBodyVehicle::apply_force(int body, btVector3 force, btVector3 rel_pos)
+{
+	forces[body] += force;
+	torques[body] += rel_pos.cross(force);
+}
+
+void MultiBodyVehicle::update_velocities()
+{
+	size_t n = bodies.size();
+	btAlignedObjectArray<btVector3> omega, vel;
+	omega.resize((int)n);
+	vel.resize((int)n);
+
+	// These are in the frame of each body
+	multibody->compTreeLinkVelocities(&omega[0], &vel[0]);
+
+	linear_vel.resize(n);
+	angular_vel.resize(n);
+	for (size_t b = 0; b < n; b++)
+	{
+		const btMatrix3x3& basis = bodies[b].link_collider->getWorldTransform().getBasis();
+		linear_vel[b] = basis * vel[(int)b];
+		angular_vel[b] = basis * omega[(int)b];
+	}
+
+	velocities_valid = true;
+}
+
+const btTransform& MultiBodyVehicle::get_transform(int body)
+{
+	return bodies[body].link_collider->getWorldTransform();
+}
+
+btVector3 MultiBodyVehicle::get_linear_velocity(int body)
+{
+	if (!velocities_valid)
+	{
+		update_velocities();
+	}
+
+	return linear_vel[body];
+}
+
+btVector3 MultiBodyVehicle::get_angular_velocity(int body)
+{
+	if (!velocities_valid)
+	{
+		update_velocities();
+	}
+
+	return angular_vel[body];
+}
+
+void MultiBodyVehicle::translate(btVector3 offset)
+{
+	if (multibody == nullptr)
+	{
+		return;
+	}
+
+	multibody->setBasePos(multibody->getBasePos() + offset);
+
+	btAlignedObjectArray<btQuaternion> scratch_q;
+	btAlignedObjectArray<btVector3> scratch_m;
+	multibody->forwardKinematics(scratch_q, scratch_m);
+	multibody->updateCollisionObjectWorldTransforms(scratch_q, scratch_m);
+}
+
+void MultiBodyVehicle::add_velocity(btVector3 vel)
+{
+	if (multibody == nullptr)
+	{
+		return;
+	}
+
+	// Joint velocities are relative, so everything gets it
+	multibody->setBaseVel(multibody->getBaseVel() + vel);
+	velocities_valid = false;
+}
+
+MultiBodyVehicle::MultiBodyVehicle(Vehicle* vehicle, btMultiBodyDynamicsWorld* world)
+{
+	this->vehicle = vehicle;
+	this->world = world;
+	multibody = nullptr;
+	velocities_valid = false;
+}
+
+MultiBodyVehicle::~MultiBodyVehicle()
+{
+	destroy_internal(false);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#pragma warning(push, 0)
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraint.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointFeedback.h>
+#pragma warning(pop)
+
+#include <vector>
+#include "part/Link.h"
+
+class Vehicle;
+class Piece;
+
+// Physics of an unpacked vehicle as a single featherstone btMultiBody, used
+// when the world is a btMultiBodyDynamicsWorld (see Universe::set_physics_world).
+// The solve is linear on the number of bodies and joints can't drift apart,
+// so tall stacks stay rigid without needing many solver iterations.
+//
+// Every set of welded pieces is a body of the multibody (the one containing
+// the root piece is the base), and the link of the topmost piece of every
+// other set becomes the joint to its parent (see Link::get_multibody_joint).
+// Pieces keep a pointer to us and the index of their body instead of a rigidbody.
+//
+// Joints break when the reaction force on them over a step goes over their
+// break impulse, then the piece is detached and the vehicle rebuilt, which
+// splits it as usual (UnpackedVehicle::handle_separation)
+class MultiBodyVehicle
+{
+private:
+
+	struct Body
+	{
+		std::vector<Piece*> pieces;
+		btCompoundShape* collider;
+		btMultiBodyLinkCollider* link_collider;
+		double mass;
+		btVector3 inertia;
+		// Center of mass transform and velocities, only used while building
+		btTransform transform;
+		btVector3 linear, angular;
+		// Index of the parent body, -1 on the base
+		int parent;
+		// The piece whose link joins this body to its parent
+		Piece* joint_piece;
+		btMultiBodyJointFeedback* feedback;
+		double break_impulse;
+	};
+
+	Vehicle* vehicle;
+	btMultiBodyDynamicsWorld* world;
+
+	btMultiBody* multibody;
+	// Body i is the link i - 1 of the multibody (body 0 is the base)
+	std::vector<Body> bodies;
+	std::vector<btMultiBodyConstraint*> constraints;
+
+	// World space velocities of the bodies, computed on demand after every step
+	std::vector<btVector3> linear_vel, angular_vel;
+	bool velocities_valid;
+
+	// Forces applied by machines (in world space, torques included) during
+	// the frame, they act over all steps until the next frame
+	std::vector<btVector3> forces, torques;
+
+	void update_velocities();
+	void create_joint(size_t body, const Link::MultiBodyJoint& joint, btScalar step);
+	// Pieces may already be deleted when the vehicle is, so they are
+	// only touched if detach_pieces is true
+	void destroy_internal(bool detach_pieces);
+
+public:
+
+	bool is_built() { return multibody != nullptr; }
+
+	// Builds the multibody from the current state of the pieces in the vehicle,
+	// which may be packed, in rigidbodies, or in another (or this) multibody
+	void build(btScalar step);
+	void destroy();
+
+	// Call before every physics step, gravity is an acceleration
+	void pre_tick(btVector3 gravity);
+
+	// Detaches (attached_to = nullptr) pieces whose joint broke during the last
+	// step, returns true if any did
+	bool check_breaks(btScalar step);
+
+	// Starts a new frame, dropping the forces of the previous one
+	void clear_forces();
+
+	// rel_pos is relative to the center of mass of the body, in world space
+	void apply_force(int body, btVector3 force, btVector3 rel_pos);
+
+	const btTransform& get_transform(int body);
+	btVector3 get_linear_velocity(int body);
+	btVector3 get_angular_velocity(int body);
+
+	void translate(btVector3 offset);
+	void add_velocity(btVector3 vel);
+
+	MultiBodyVehicle(Vehicle* vehicle, btMultiBodyDynamicsWorld* world);
+	~MultiBodyVehicle();
+};
@@ -0,0 +1,38 @@
+#include "PieceStateCache.h"
+#include "part/Piece.h"
+
+void PieceStateCache::fill(const std::vector<Piece*>& n_pieces)
+{
+	// Pieces read from bullet while we fill
+	valid = false;
+
+	size_t count = n_pieces.size();
+	pieces = n_pieces;
+	transforms.resize(count);
+	graphics_transforms.resize(count);
+	linear_velocities.resize(count);
+	angular_velocities.resize(count);
+
+	for(size_t i = 0; i < count; i++)
+	{
+		Piece* p = pieces[i];
+		p->cache_index = i;
+		transforms[i] = p->get_global_transform();
+		graphics_transforms[i] = p->get_graphics_transform();
+		linear_velocities[i] = p->get_linear_velocity();
+		angular_velocities[i] = p->get_angular_velocity();
+	}
+
+	valid = true;
+}
+
+size_t PieceStateCache::find(const Piece* p) const
+{
+	// The piece may have been moved to another vehicle (separation)
+	if(!valid || p->cache_index >= pieces.size() || pieces[p->cache_index] != p)
+	{
+		return NONE;
+	}
+
+	return p->cache_index;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#pragma warning(push, 0)
+#include <LinearMath/btTransform.h>
+#pragma warning(pop)
+
+#include <vector>
+#include <cstddef>
+
+class Piece;
+
+// Transforms and velocities of the pieces of an unpacked vehicle, stored
+// as arrays (one entry per piece, at Piece::cache_index).
+// Filled once every update after the physics worlds stepped (see
+// Entity::post_physics_update), so rendering, machines and gravity don't
+// go through the rigidbodies, motion states and welded offsets every time.
+// Anything that moves the pieces outside of a bullet step (teleporting,
+// rebuilding physics, packing) must invalidate it, Piece then reads
+// from bullet directly.
+class PieceStateCache
+{
+private:
+
+	bool valid;
+
+public:
+
+	std::vector<Piece*> pieces;
+	std::vector<btTransform> transforms;
+	std::vector<btTransform> graphics_transforms;
+	// Including the tangential velocity
+	std::vector<btVector3> linear_velocities;
+	std::vector<btVector3> angular_velocities;
+
+	// Also sets cache_index on all pieces
+	void fill(const std::vector<Piece*>& n_pieces);
+	void invalidate() { valid = false; }
+
+	// Index of p in the arrays, or NONE if it's not cached
+	static constexpr size_t NONE = (size_t)-1;
+	size_t find(const Piece* p) const;
+
+	PieceStateCache() { valid = false; }
+};
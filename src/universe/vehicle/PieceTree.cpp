@@ -0,0 +1,80 @@
+#include "PieceTree.h"
+
+void PieceTree::build(const std::vector<size_t>& parents)
+{
+	size_t count = parents.size();
+
+	// Counting sort of the nodes by their parent, which keeps
+	// children in index order
+	first_child.assign(count + 1, 0);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (parents[i] != NONE)
+		{
+			first_child[parents[i] + 1]++;
+		}
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		first_child[i + 1] += first_child[i];
+	}
+
+	children.resize(first_child[count]);
+
+	std::vector<size_t> cursor(first_child.begin(), first_child.end() - 1);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (parents[i] != NONE)
+		{
+			children[cursor[parents[i]]++] = i;
+		}
+	}
+}
+
+void PieceTree::breadth_first(size_t root, std::vector<size_t>& out) const
+{
+	out.push_back(root);
+	expand(out.size() - 1, out);
+}
+
+void PieceTree::get_subtree(size_t node, std::vector<size_t>& out) const
+{
+	size_t head = out.size();
+	out.insert(out.end(), children_begin(node), children_end(node));
+	expand(head, out);
+}
+
+void PieceTree::expand(size_t head, std::vector<size_t>& out) const
+{
+	// out itself is the queue
+	while (head < out.size())
+	{
+		size_t node = out[head];
+		head++;
+
+		out.insert(out.end(), children_begin(node), children_end(node));
+	}
+}
+
+void PieceTree::mark_reachable(size_t root, std::vector<bool>& reachable) const
+{
+	reachable.assign(size(), false);
+
+	std::vector<size_t> stack;
+	stack.push_back(root);
+	reachable[root] = true;
+
+	while (!stack.empty())
+	{
+		size_t node = stack.back();
+		stack.pop_back();
+
+		for (const size_t* it = children_begin(node); it != children_end(node); it++)
+		{
+			reachable[*it] = true;
+			stack.push_back(*it);
+		}
+	}
+}
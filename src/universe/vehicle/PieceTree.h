@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Children index of the pieces of a vehicle, stored as compressed
+// rows (CSR), so every query walks only the nodes it returns.
+// Nodes are indices, the vehicle maps them to its pieces. Building is
+// linear in the node count, so it's rebuilt whenever the topology
+// (the attached_to pointers) changes.
+class PieceTree
+{
+private:
+
+	// Children of node i are children[first_child[i]] to children[first_child[i + 1]]
+	std::vector<size_t> first_child;
+	std::vector<size_t> children;
+
+	// Appends the children of out[head] onwards, until no new nodes are added
+	void expand(size_t head, std::vector<size_t>& out) const;
+
+public:
+
+	static constexpr size_t NONE = (size_t)-1;
+
+	// parents[i] is the parent of node i, or NONE (root and detached nodes)
+	void build(const std::vector<size_t>& parents);
+
+	size_t size() const { return first_child.empty() ? 0 : first_child.size() - 1; }
+
+	const size_t* children_begin(size_t node) const { return children.data() + first_child[node]; }
+	const size_t* children_end(size_t node) const { return children.data() + first_child[node + 1]; }
+	size_t get_child_count(size_t node) const { return first_child[node + 1] - first_child[node]; }
+
+	// Appends the nodes reachable from root, including it, in breadth first order
+	void breadth_first(size_t root, std::vector<size_t>& out) const;
+
+	// Appends every descendant of node, not including it, in breadth first order
+	void get_subtree(size_t node, std::vector<size_t>& out) const;
+
+	// Sets to true every node reachable from root, including it
+	void mark_reachable(size_t root, std::vector<bool>& reachable) const;
+};
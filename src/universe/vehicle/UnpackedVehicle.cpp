@@ -3,8 +3,7 @@
 #include "../../util/DebugDrawer.h"
 #include "../../physics/glm/BulletGlmCompat.h"
 #include "Vehicle.h"
-
-using WeldedGroupCreation = std::pair<std::unordered_set<Piece*>, bool>;
+#include <algorithm>
 
 struct PieceState
 {
@@ -14,6 +13,14 @@ struct PieceState
 	btVector3 angular;
 };
 
+// A set of pieces which must share a new rigidbody, with the state
+// of every piece from before any rigidbody was removed
+struct WeldedGroupCreation
+{
+	std::vector<Piece*> pieces;
+	std::vector<PieceState> states;
+};
+
 static PieceState obtain_piece_state(Piece* piece)
 {
 	PieceState st;
@@ -24,226 +31,157 @@ static PieceState obtain_piece_state(Piece* piece)
 	return st;
 }
 
-static void add_to_welded_groups(std::vector<WeldedGroupCreation>& welded_groups, Piece* piece)
+// A group is still valid if it's not dirty and its pieces are
+// exactly one of the sets of welded pieces
+static bool is_welded_group_valid(WeldedGroup* wgroup, DisjointSet& weld_sets,
+	const std::unordered_map<Piece*, size_t>& piece_index)
 {
-	bool found = false;
-	// Find what welded group to add this to
-	if (piece->welded)
+	if (wgroup->dirty || wgroup->pieces.empty())
 	{
-		for (size_t i = 0; i < welded_groups.size(); i++)
-		{
-			if (welded_groups[i].first.count(piece->attached_to) != 0)
-			{
-				welded_groups[i].first.insert(piece);
-				found = true;
-				break;
-			}
-		}
+		return false;
 	}
 
-	if (!found)
+	size_t root = 0;
+	for (size_t i = 0; i < wgroup->pieces.size(); i++)
 	{
-		// Create the welded group, add the part, and, if this part is welded, add
-		// whatever it's welded to (Note: individual parts get a lone welded group)
-		welded_groups.push_back(std::make_pair(std::unordered_set<Piece*>(), false));
-		welded_groups[welded_groups.size() - 1].first.insert(piece);
-		if (piece->welded && piece->attached_to != nullptr)
+		auto it = piece_index.find(wgroup->pieces[i]);
+		if (it == piece_index.end())
 		{
-			welded_groups[welded_groups.size() - 1].first.insert(piece->attached_to);
+			// The piece is not in this vehicle anymore
+			return false;
 		}
-	}
-}
-
-static std::vector<Piece*> extract_single_pieces(std::vector<WeldedGroupCreation>& welded_groups)
-{
-	std::vector<Piece*> single_pieces;
 
-	// Find single piece (groups of only one piece)
-	for (auto it = welded_groups.begin(); it != welded_groups.end();)
-	{
-		if (it->first.size() == 1)
+		size_t proot = weld_sets.find(it->second);
+		if (i == 0)
 		{
-			Piece* piece = *it->first.begin();
-
-			single_pieces.push_back(piece);
-			// Remove welded colliders, if it had any
-			if (piece->in_group != nullptr)
-			{
-				piece->rigid_body = nullptr;
-				piece->motion_state = nullptr;
-				piece->in_group = nullptr;
-				piece->welded_collider_id = -1;
-			}
-
-			it = welded_groups.erase(it);
+			root = proot;
 		}
-		else
+		else if (proot != root)
 		{
-			it++;
+			return false;
 		}
 	}
 
-	return single_pieces;
+	return weld_sets.get_size(root) == wgroup->pieces.size();
 }
 
-static void remove_outdated_welded_groups(
-	std::vector<WeldedGroup*>& welded, std::vector<WeldedGroupCreation>& welded_groups, btDynamicsWorld* world)
+static void remove_welded_group(WeldedGroup* wgroup, btDynamicsWorld* world)
 {
-	for (auto it = welded.begin(); it != welded.end();)
-	{
-		WeldedGroup* wgroup = *it;
+	world->removeRigidBody(wgroup->rigid_body);
 
-		bool found = false;
-		// Find any same group, to be the same, the welded_group
-		// must contain every piece in wgroup, and be the same size
-		for (size_t j = 0; j < welded_groups.size(); j++)
+	for (Piece* p : wgroup->pieces)
+	{
+		if (p->rigid_body == wgroup->rigid_body)
 		{
-			int count = 0;
-			for (size_t i = 0; i < wgroup->pieces.size(); i++)
-			{
-				count += (int)welded_groups[j].first.count(wgroup->pieces[i]);
-			}
-
-			if (count == wgroup->pieces.size() && !wgroup->dirty)
-			{
-				found = true;
-				welded_groups[j].second = true;
-				break;
-			}
+			p->rigid_body = nullptr;
+			p->motion_state = nullptr;
 		}
 
-		if (!found)
+		if (p->in_group == wgroup)
 		{
-			// We remove the group as it is not present anymore
-			world->removeRigidBody(wgroup->rigid_body);
-
-			// Set all group rigidbodies to nullptr!
-			for (Piece* p : wgroup->pieces)
-			{
-				p->rigid_body = nullptr;
-			}
-
-			delete wgroup->motion_state;
-			delete wgroup->rigid_body;
-			delete wgroup;
-
-
-
-			it = welded.erase(it);
-		}
-		else
-		{
-			it++;
+			p->in_group = nullptr;
+			p->welded_collider_id = -1;
 		}
 	}
+
+	delete wgroup->motion_state;
+	delete wgroup->rigid_body;
+	delete wgroup;
 }
 
-static void create_new_welded_group(
-	std::vector<WeldedGroup*>& welded, WeldedGroupCreation& wg, 
-	std::unordered_map<Piece*, PieceState>& states_at_start, btDynamicsWorld* world,
-	std::vector<Piece*>& all_pieces)
+static void create_new_welded_group(std::vector<WeldedGroup*>& welded, WeldedGroupCreation& wg, btDynamicsWorld* world)
 {
-	if (wg.second == false)
-	{
-		// Create a new WeldedGroup
-		WeldedGroup* n_group = new WeldedGroup();
-		n_group->pieces.reserve(wg.first.size());
+	// Create a new WeldedGroup
+	WeldedGroup* n_group = new WeldedGroup();
+	n_group->pieces.reserve(wg.pieces.size());
 
-		// Create collider
-		btCompoundShape temp_collider = btCompoundShape();
-		btCompoundShape* collider = new btCompoundShape();
+	// Create collider
+	btCompoundShape temp_collider = btCompoundShape();
+	btCompoundShape* collider = new btCompoundShape();
 
-		btTransform identity;
-		identity.setIdentity();
+	std::vector<btScalar> masses;
+	masses.reserve(wg.pieces.size());
+	btTransform principal;
+	principal.setIdentity();
 
-		std::vector<btScalar> masses;
-		btTransform principal;
-		principal.setIdentity();
+	double tot_mass = 0.0;
 
-		double tot_mass = 0.0;
+	for (size_t i = 0; i < wg.pieces.size(); i++)
+	{
+		Piece* p = wg.pieces[i];
+		p->welded_tform = wg.states[i].transform;
+		temp_collider.addChildShape(p->welded_tform, p->collider);
+		masses.push_back(p->mass);
+		tot_mass += p->mass;
 
-		for (Piece* p : wg.first)
-		{
-			p->welded_tform = states_at_start[p].transform;
-			temp_collider.addChildShape(p->welded_tform, p->collider);
-			masses.push_back(p->mass);
-			tot_mass += p->mass;
+		p->welded_collider_id = temp_collider.getNumChildShapes() - 1;
+	}
 
-			p->welded_collider_id = temp_collider.getNumChildShapes() - 1;
-		}
+	// Create rigidbody
+	btVector3 local_inertia;
 
-		// Create rigidbody
-		btVector3 local_inertia;
+	temp_collider.calculatePrincipalAxisTransform(masses.data(), principal, local_inertia);
 
-		temp_collider.calculatePrincipalAxisTransform(masses.data(), principal, local_inertia);
+	btTransform principal_inverse = principal.inverse();
 
-		btTransform principal_inverse = principal.inverse();
+	for (int i = 0; i < temp_collider.getNumChildShapes(); i++)
+	{
+		collider->addChildShape(principal_inverse * temp_collider.getChildTransform(i),
+			temp_collider.getChildShape(i));
+	}
 
-		for (int i = 0; i < temp_collider.getNumChildShapes(); i++)
-		{
-			collider->addChildShape(principal_inverse * temp_collider.getChildTransform(i),
-				temp_collider.getChildShape(i));
-		}
 
+	collider->calculateLocalInertia(tot_mass, local_inertia);
 
-		collider->calculateLocalInertia(tot_mass, local_inertia);
+	btMotionState* motion_state = new btDefaultMotionState(principal);
+	btRigidBody::btRigidBodyConstructionInfo info(tot_mass, motion_state, collider, local_inertia);
+	btRigidBody* rigid_body = new btRigidBody(info);
 
-		btMotionState* motion_state = new btDefaultMotionState(principal);
-		btRigidBody::btRigidBodyConstructionInfo info(tot_mass, motion_state, collider, local_inertia);
-		btRigidBody* rigid_body = new btRigidBody(info);
+	rigid_body->setActivationState(DISABLE_DEACTIVATION);
 
-		rigid_body->setActivationState(DISABLE_DEACTIVATION);
+	// TODO: Think, maybe we can do the average of all parts? Maybe using default values is good
+	rigid_body->setFriction(PIECE_DEFAULT_FRICTION);
+	rigid_body->setRestitution(PIECE_DEFAULT_RESTITUTION);
 
-		// TODO: Think, maybe we can do the average of all parts? Maybe using default values is good
-		rigid_body->setFriction(PIECE_DEFAULT_FRICTION);
-		rigid_body->setRestitution(PIECE_DEFAULT_RESTITUTION);
+	world->addRigidBody(rigid_body);
 
-		world->addRigidBody(rigid_body);
+	btVector3 total_angvel = btVector3(0, 0, 0);
 
-		btVector3 total_angvel = btVector3(0, 0, 0);
+	for (size_t i = 0; i < wg.pieces.size(); i++)
+	{
+		Piece* p = wg.pieces[i];
+		n_group->pieces.push_back(p);
+		p->in_group = n_group;
 
-		for (Piece* p : wg.first)
+		// Pieces coming from removed groups have no rigidbody by now,
+		// so this is the own rigidbody of a piece which was alone
+		if (p->rigid_body != nullptr)
 		{
-			n_group->pieces.push_back(p);
-			p->in_group = n_group;
-
-			if (p->rigid_body != nullptr)
-			{
-				// We must be careful here, we may be removing an already welded rigidbody!
-				for (Piece* sp : wg.first)
-				{
-					if (sp->rigid_body == p->rigid_body && sp != p)
-					{
-						sp->rigid_body = nullptr;
-					}
-				}
-
-				world->removeRigidBody(p->rigid_body);
-				delete p->rigid_body;
-			}
+			world->removeRigidBody(p->rigid_body);
+			delete p->rigid_body;
+			delete p->motion_state;
+		}
 
-			p->rigid_body = rigid_body;
-			p->motion_state = motion_state;
-			p->welded_tform = principal_inverse * p->welded_tform;
+		p->rigid_body = rigid_body;
+		p->motion_state = motion_state;
+		p->welded_tform = principal_inverse * p->welded_tform;
 
-			//rigid_body->applyCentralImpulse(states_at_start[p].linear * p->mass);
-			rigid_body->applyImpulse(states_at_start[p].linear * p->mass, p->get_local_transform().getOrigin());
-			//rigid_body->applyImpulse(states_at_start[p].linear * p->mass, p->get_relative_position()); 
-			total_angvel += states_at_start[p].angular;
-		}
+		rigid_body->applyImpulse(wg.states[i].linear * p->mass, p->get_local_transform().getOrigin());
+		total_angvel += wg.states[i].angular;
+	}
 
 
-		// Angular momentum is conserved, we need to get angular velocity back
-		// from total_angmom
-		glm::dvec3 ang_veld = to_dvec3(total_angvel) / (double)wg.first.size();
-		btVector3 ang_vel = to_btVector3(ang_veld);
-		rigid_body->setAngularVelocity(ang_vel);
+	// Angular momentum is conserved, we need to get angular velocity back
+	// from total_angmom
+	glm::dvec3 ang_veld = to_dvec3(total_angvel) / (double)wg.pieces.size();
+	btVector3 ang_vel = to_btVector3(ang_veld);
+	rigid_body->setAngularVelocity(ang_vel);
 
-		n_group->rigid_body = rigid_body;
-		n_group->motion_state = motion_state;
+	n_group->rigid_body = rigid_body;
+	n_group->motion_state = motion_state;
+	n_group->dirty = false;
 
-		welded.push_back(n_group);
-	}
+	welded.push_back(n_group);
 }
 
 static void add_piece_physics(Piece* piece, btTransform tform, btDynamicsWorld* world)
@@ -266,13 +204,12 @@ static void add_piece_physics(Piece* piece, btTransform tform, btDynamicsWorld*
 	piece->motion_state = motion_state;
 }
 
-static void create_piece_physics(Piece* piece, std::unordered_map<Piece*, PieceState>& states_at_start, btDynamicsWorld* world)
+static void create_piece_physics(Piece* piece, const PieceState& state, btDynamicsWorld* world)
 {
-	// We must be a lone piece if we haven't been touched before
 	btVector3 local_inertia;
 	piece->collider->calculateLocalInertia(piece->mass, local_inertia);
 
-	btMotionState* motion_state = new btDefaultMotionState(states_at_start[piece].transform);
+	btMotionState* motion_state = new btDefaultMotionState(state.transform);
 	btRigidBody::btRigidBodyConstructionInfo info(piece->mass, motion_state, piece->collider, local_inertia);
 	btRigidBody* rigid_body = new btRigidBody(info);
 
@@ -280,12 +217,12 @@ static void create_piece_physics(Piece* piece, std::unordered_map<Piece*, PieceS
 
 	rigid_body->setFriction(piece->friction);
 	rigid_body->setRestitution(piece->restitution);
-	rigid_body->setWorldTransform(states_at_start[piece].transform);
+	rigid_body->setWorldTransform(state.transform);
 
 
 	// Apply old impulses
-	rigid_body->setLinearVelocity(states_at_start[piece].linear_tang);
-	rigid_body->setAngularVelocity(states_at_start[piece].angular);
+	rigid_body->setLinearVelocity(state.linear_tang);
+	rigid_body->setAngularVelocity(state.angular);
 
 	world->addRigidBody(rigid_body);
 
@@ -294,7 +231,7 @@ static void create_piece_physics(Piece* piece, std::unordered_map<Piece*, PieceS
 
 }
 
-std::vector<Vehicle*> UnpackedVehicle::update()
+std::vector<Vehicle*> UnpackedVehicle::update(double pdt)
 {
 	std::vector<Vehicle*> n_vehicles;
 	// Check for any broken links, they instantly set the dirty flags,
@@ -317,11 +254,19 @@ std::vector<Vehicle*> UnpackedVehicle::update()
 	}
 
 
+	if(multibody != nullptr && breaking_enabled && multibody->check_breaks(pdt))
+	{
+		dirty = true;
+	}
+
+
 	if (dirty)
 	{
 		n_vehicles = handle_separation();
 
-		vehicle->sort(); //< Not sure if needed
+		// Everything left is attached, this builds the tree the next 
+		// separation starts from
+		vehicle->sort();
 
 		build_physics();
 
@@ -351,42 +296,124 @@ void UnpackedVehicle::build_physics()
 		}
 	}
 
-	// We need to create shared colliders for all welded 
-	// groups, and individual colliders for every other piece
-	// The bool is used later on to check if the group was already present
-	
-	std::vector<WeldedGroupCreation> welded_groups;
+	if (multibody != nullptr)
+	{
+		for (Piece* piece : vehicle->all_pieces)
+		{
+			piece->in_vehicle = vehicle;
+		}
+
+		// Links are turned into joints of the multibody
+		multibody->build(Universe::PHYSICS_STEPSIZE);
+		return;
+	}
 
-	// We need this as we will remove rigidbodies, and with them,
-	// physics information. 
-	std::unordered_map<Piece*, PieceState> states_at_start;
+	// Every set of welded pieces shares a collider and a rigidbody, lone pieces
+	// get their own. We find the sets with an union-find over the pieces, and
+	// only rebuild the ones which don't match a group we already have, so
+	// staging doesn't touch the rest of the vehicle
+	size_t count = vehicle->all_pieces.size();
 
-	for (Piece* piece : vehicle->all_pieces)
+	piece_index.clear();
+	piece_index.reserve(count);
+	for (size_t i = 0; i < count; i++)
 	{
+		Piece* piece = vehicle->all_pieces[i];
 		piece->in_vehicle = vehicle;
-		states_at_start[piece] = obtain_piece_state(piece);
-	
-		add_to_welded_groups(welded_groups, piece);
+		piece_index[piece] = i;
 	}
 
-	std::vector<Piece*> single_pieces = extract_single_pieces(welded_groups);
-	this->single_pieces = single_pieces;
+	weld_sets.reset(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		Piece* piece = vehicle->all_pieces[i];
+		if (piece->welded && piece->attached_to != nullptr)
+		{
+			auto it = piece_index.find(piece->attached_to);
+			if (it != piece_index.end())
+			{
+				weld_sets.unite(i, it->second);
+			}
+		}
+	}
 
-	remove_outdated_welded_groups(welded, welded_groups, world);
+	// Sets (by their root) which already have a valid group
+	std::vector<bool> set_kept(count, false);
+	std::vector<WeldedGroup*> outdated;
 
-	for (WeldedGroupCreation& wg : welded_groups)
+	for (auto it = welded.begin(); it != welded.end();)
 	{
-		create_new_welded_group(welded, wg, states_at_start, world, vehicle->all_pieces);
+		WeldedGroup* wgroup = *it;
+
+		if (is_welded_group_valid(wgroup, weld_sets, piece_index))
+		{
+			set_kept[weld_sets.find(piece_index[wgroup->pieces[0]])] = true;
+			it++;
+		}
+		else
+		{
+			outdated.push_back(wgroup);
+			it = welded.erase(it);
+		}
 	}
 
-	for (Piece* piece : single_pieces)
+	// We need the state of the changed pieces before removing any rigidbody,
+	// as we will lose physics information with them
+	std::vector<WeldedGroupCreation> n_groups;
+	std::vector<size_t> set_to_group(count, count);
+	std::vector<std::pair<Piece*, PieceState>> n_single;
+
+	single_pieces.clear();
+
+	for (size_t i = 0; i < count; i++)
 	{
-		if (piece->rigid_body == nullptr)
+		Piece* piece = vehicle->all_pieces[i];
+		size_t root = weld_sets.find(i);
+
+		if (set_kept[root])
+		{
+			continue;
+		}
+
+		if (weld_sets.get_size(root) == 1)
 		{
-			create_piece_physics(piece, states_at_start, world);
+			single_pieces.push_back(piece);
+
+			// Lone pieces which already had their own rigidbody keep it
+			if (piece->rigid_body == nullptr || piece->in_group != nullptr)
+			{
+				n_single.emplace_back(piece, obtain_piece_state(piece));
+			}
+		}
+		else
+		{
+			if (set_to_group[root] == count)
+			{
+				set_to_group[root] = n_groups.size();
+				n_groups.emplace_back();
+			}
+
+			WeldedGroupCreation& wg = n_groups[set_to_group[root]];
+			wg.pieces.push_back(piece);
+			wg.states.push_back(obtain_piece_state(piece));
 		}
 	}
 
+	for (WeldedGroup* wgroup : outdated)
+	{
+		remove_welded_group(wgroup, world);
+	}
+
+	for (WeldedGroupCreation& wg : n_groups)
+	{
+		create_new_welded_group(welded, wg, world);
+	}
+
+	for (auto& pair : n_single)
+	{
+		create_piece_physics(pair.first, pair.second, world);
+	}
+
 	for (Piece* piece : vehicle->all_pieces)
 	{
 		// piece->attached_to cannot have null rigidbody as it will have already been built
@@ -455,126 +482,40 @@ std::vector<Vehicle*> UnpackedVehicle::handle_separation()
 		}
 	}
 
-	// Find all pieces that can't reach root, and create a new vehicle from them
-	// Assumes the vehicle was sorted before the part separated!
-	// (Don't sort with a part separated)
-
-	std::vector<std::vector<Piece*>> n_pieces;
-
-	for (auto it = vehicle->all_pieces.begin(); it != vehicle->all_pieces.end(); )
-	{
-		Piece* p = *it;
-
-		if (p == vehicle->root)
-		{
-			it++;
-			continue;
-		}
-
-
-		if (p->attached_to == nullptr)
-		{
-			n_pieces.push_back(std::vector<Piece*>());
-			n_pieces[n_pieces.size() - 1].push_back(p);
-
-			it = vehicle->all_pieces.erase(it);
-		}
-		else
-		{
-			bool removed = false;
-
-			for (auto& list : n_pieces)
-			{
-				for (auto sub_p : list)
-				{
-					if (p->attached_to == sub_p)
-					{
-						list.push_back(p);
-						it = vehicle->all_pieces.erase(it);
-						removed = true;
-
-						// Lord, I'm sorry, but this is the cleanest option
-						goto out;
-					}
-				}
-			}
-
-			out:
-
-			if (!removed)
-			{
-				it++;
-			}
-		}
-	}
-	
-	// Find welded groups to transfer
-
-	for (auto& n_vessel_pieces : n_pieces)
-	{
-		for (WeldedGroup* w : welded)
-		{
-			for (size_t i = 0; i < n_vessel_pieces.size(); i++)
-			{
-				if (w->rigid_body == n_vessel_pieces[i]->rigid_body)
-				{
-					wgroups.insert(w);
-				}
-			}
-		}
-	}
-
-
-	// Here we remove the welded groups from original vessel
-	for (WeldedGroup* w : wgroups)
-	{
-		for (size_t i = 0; i < welded.size(); i++)
-		{
-			if (welded[i] == w)
-			{
-				welded.erase(welded.begin() + i);
-				break;
-			}
-		}
-	}
+	// Every cut piece is the root of a new vehicle, with its subtree. Only the
+	// cut subtrees are walked, and pieces, parts and welded groups are moved
+	// to the new vehicles, so staging costs the size of what separates
+	std::vector<std::vector<Piece*>> n_pieces = vehicle->split_cut_pieces();
 
 	for (auto& n_vessel_pieces : n_pieces)
 	{
-
-		Vehicle* n_vehicle = new Vehicle();
+		Vehicle* n_vehicle = vehicle->split_off(n_vessel_pieces);
 		n_vehicle->unpacked_veh.set_world(world);
-	
-		n_vehicle->all_pieces = n_vessel_pieces;
-		n_vehicle->root = n_vessel_pieces[0];
 
-		for (WeldedGroup* w : wgroups)
+		// Welded groups never span a cut (the weld isn't a link that can break)
+		// so each one is wholly in the new vehicle or not
+		for (Piece* p : n_vessel_pieces)
 		{
-			for (size_t i = 0; i < w->pieces.size(); i++)
+			if (p->in_group != nullptr && wgroups.insert(p->in_group).second)
 			{
-				for (size_t j = 0; j < n_vessel_pieces.size(); j++)
-				{
-					if (n_vessel_pieces[j] == w->pieces[i])
-					{
-						// Transfer the welded group
-						n_vehicle->unpacked_veh.welded.push_back(w);
-						i = w->pieces.size() + 1;
-						break;
-					}
-				}
-
+				n_vehicle->unpacked_veh.welded.push_back(p->in_group);
 			}
-
 		}
 
 		n_vehicle->packed = false;
-		n_vehicle->sort();
 		n_vehicle->unpacked_veh.build_physics();
 		
 		logger->info("Separated new vehicle");
 		n_vehicles.push_back(n_vehicle);
 	}
 
-
+	if (!wgroups.empty())
+	{
+		welded.erase(std::remove_if(welded.begin(), welded.end(), [&wgroups](WeldedGroup* w)
+		{
+			return wgroups.count(w) != 0;
+		}), welded.end());
+	}
 
 	return n_vehicles;
 }
@@ -585,6 +526,13 @@ void UnpackedVehicle::set_position(glm::dvec3 pos)
 	btVector3 bt = to_btVector3(pos);
 
 	btVector3 root_pos = vehicle->root->get_global_transform().getOrigin();
+	vehicle->piece_cache.invalidate();
+	if (multibody != nullptr)
+	{
+		multibody->translate(bt - root_pos);
+		return;
+	}
+
 	for (WeldedGroup* g : welded)
 	{
 		btVector3 off = g->rigid_body->getWorldTransform().getOrigin() - root_pos;
@@ -602,7 +550,13 @@ void UnpackedVehicle::set_linear_velocity(glm::dvec3 vel)
 {
 	btVector3 bt = to_btVector3(vel);
 
-	btVector3 root_vel = vehicle->root->rigid_body->getLinearVelocity();
+	btVector3 root_vel = vehicle->root->get_linear_velocity(true);
+	vehicle->piece_cache.invalidate();
+	if (multibody != nullptr)
+	{
+		multibody->add_velocity(bt - root_vel);
+		return;
+	}
 
 	for (WeldedGroup* g : welded)
 	{
@@ -661,12 +615,23 @@ void UnpackedVehicle::draw_debug()
 
 void UnpackedVehicle::deactivate()
 {
+	// Links must go before the rigidbodies they use
+	for(Piece* p : vehicle->all_pieces)
+	{
+		if(p->link != nullptr)
+		{
+			p->link->deactivate();
+		}
+	}
+
+	if(multibody != nullptr)
+	{
+		multibody->destroy();
+	}
+
 	for(WeldedGroup* group : welded)
 	{
-		world->removeRigidBody(group->rigid_body);
-		delete group->rigid_body;
-		delete group->motion_state;
-		delete group;
+		remove_welded_group(group, world);
 	}
 
 	for(Piece* p : single_pieces)
@@ -674,6 +639,8 @@ void UnpackedVehicle::deactivate()
 		world->removeRigidBody(p->rigid_body);
 		delete p->rigid_body;
 		delete p->motion_state;
+		p->rigid_body = nullptr;
+		p->motion_state = nullptr;
 	}
 
 	single_pieces.clear();
@@ -712,13 +679,100 @@ void UnpackedVehicle::activate()
 	vehicle->packed = false;
 }
 
+void UnpackedVehicle::set_world(btDynamicsWorld* n_world)
+{
+	if(n_world == world)
+	{
+		return;
+	}
+
+	this->world = n_world;
+
+	delete multibody;
+	multibody = nullptr;
+
+	btMultiBodyDynamicsWorld* mb_world = dynamic_cast<btMultiBodyDynamicsWorld*>(n_world);
+	if(mb_world != nullptr)
+	{
+		multibody = new MultiBodyVehicle(vehicle, mb_world);
+	}
+}
+
+void UnpackedVehicle::move_to_world(btDynamicsWorld* n_world)
+{
+	if(n_world == world)
+	{
+		return;
+	}
+
+	if(vehicle->packed || world == nullptr)
+	{
+		set_world(n_world);
+		return;
+	}
+
+	for(Piece* p : vehicle->all_pieces)
+	{
+		if(p->link != nullptr)
+		{
+			p->link->deactivate();
+		}
+	}
+
+	if(multibody != nullptr)
+	{
+		// Build a new one from the current state, the old one only removes
+		// itself from its world as pieces aren't in it anymore
+		MultiBodyVehicle* old = multibody;
+		multibody = new MultiBodyVehicle(vehicle, (btMultiBodyDynamicsWorld*)n_world);
+		world = n_world;
+		if(old->is_built())
+		{
+			multibody->build(Universe::PHYSICS_STEPSIZE);
+		}
+		delete old;
+		return;
+	}
+
+	for(WeldedGroup* g : welded)
+	{
+		world->removeRigidBody(g->rigid_body);
+		n_world->addRigidBody(g->rigid_body);
+	}
+
+	for(Piece* p : single_pieces)
+	{
+		world->removeRigidBody(p->rigid_body);
+		n_world->addRigidBody(p->rigid_body);
+	}
+
+	world = n_world;
+	// Rebuilds the links, as groups are valid nothing else changes
+	dirty = true;
+}
+
 UnpackedVehicle::UnpackedVehicle(Vehicle* v)
 {
 	this->vehicle = v;
+	this->world = nullptr;
+	this->multibody = nullptr;
+	this->breaking_enabled = false;
+}
+
+UnpackedVehicle::~UnpackedVehicle()
+{
+	delete multibody;
 }
 
 void UnpackedVehicle::apply_gravity(btVector3 dir)
 {
+	if(multibody != nullptr)
+	{
+		// Forces are re-applied every step, gravity with them
+		multibody->pre_tick(dir);
+		return;
+	}
+
 	for(Piece* p : vehicle->all_pieces)
 	{
 		p->rigid_body->setGravity(dir);
@@ -1,13 +1,17 @@
 #pragma once
 #include "part/Part.h"
 #include "part/Piece.h"
+#include "MultiBodyVehicle.h"
 
 
 #pragma warning(push, 0)
 #include <btBulletDynamicsCommon.h>
 #pragma warning(pop)
 
+#include <util/DisjointSet.h>
+
 #include <unordered_set>
+#include <unordered_map>
 #include <vector>
 class Vehicle;
 
@@ -18,6 +22,12 @@ public:
 private:
 
 	bool breaking_enabled;
+
+	// Sets of welded pieces, indexed by position in all_pieces
+	// (piece_index), as of the last call to build_physics
+	DisjointSet weld_sets;
+	std::unordered_map<Piece*, size_t> piece_index;
+
 public:
 	Vehicle* vehicle;
 
@@ -27,11 +37,16 @@ public:
 
 	std::vector<WeldedGroup*> welded;
 	std::vector<Piece*> single_pieces;
+
+	// Only if the world is a btMultiBodyDynamicsWorld, then the whole vehicle
+	// is simulated by it instead of the welded groups and single pieces
+	MultiBodyVehicle* multibody;
 	
 
-	// Call every frame, it checks the dirty flag
+	// Call every physics tick, it checks the dirty flag
 	// Can create new vehicles if parts separate (only when unpacked)
-	std::vector<Vehicle*> update();
+	// pdt is the step the tick is about to take (bubbles may step slower)
+	std::vector<Vehicle*> update(double pdt);
 
 	// Called automatically by update to rebuild the physics
 	// whenever the dirty flag is set
@@ -59,10 +74,11 @@ public:
 
 	void set_breaking_enabled(bool value);
 
-	void set_world(btDynamicsWorld* n_world)
-	{
-		this->world = n_world;
-	}
+	// Only while we have nothing in the world (packed or not yet unpacked)
+	void set_world(btDynamicsWorld* n_world);
+	// Moves our rigidbodies (or multibody) to another world, keeping their state.
+	// Links are rebuilt in the new world before the next step
+	void move_to_world(btDynamicsWorld* n_world);
 
 	void deactivate();
 	void activate();
@@ -70,5 +86,6 @@ public:
 	void apply_gravity(btVector3 direction);
 
 	UnpackedVehicle(Vehicle* v);
+	~UnpackedVehicle();
 
 };
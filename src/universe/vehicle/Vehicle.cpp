@@ -1,10 +1,12 @@
 #include "Vehicle.h"
+#include <algorithm>
 
 void Vehicle::unpack()
 {
 	logger->check(packed, "Tried to unpack an unpacked vehicle");
 	
 	packed = false;
+	piece_cache.invalidate();
 
 	// Apply immediate velocity so physics don't start delayed
 	WorldState st = packed_veh.get_world_state();
@@ -21,6 +23,7 @@ void Vehicle::pack()
 	logger->check(!packed, "Tried to pack a packed vehicle");
 
 	packed = true;
+	piece_cache.invalidate();
 
 	unpacked_veh.deactivate();
 
@@ -29,6 +32,15 @@ void Vehicle::pack()
 
 void Vehicle::update(double dt)
 {
+	last_lua_calls = lua_calls;
+	lua_calls = 0;
+
+	// Forces from machines last for the whole frame on multibodies
+	if(!packed && unpacked_veh.multibody != nullptr)
+	{
+		unpacked_veh.multibody->clear_forces();
+	}
+
 	// Clear blocked ports
 	for (Port* p : all_ports)
 	{
@@ -40,18 +52,53 @@ void Vehicle::update(double dt)
 		part->pre_update(dt);
 	}
 
-	for(Part* part : parts)
+	if(wires_dirty || wire_graph.built_parts != parts)
 	{
-		part->update(dt);
+		wire_graph.build(parts, all_ports);
+		wires_dirty = false;
 	}
 
+	// Machines update in wire order, getting the values written
+	// to them (during pre_update or by machines before them) in one go
+	for(Machine* m : wire_graph.order)
+	{
+		m->deliver_inputs();
+		m->update(dt);
+	}
+
+}
+
+void Vehicle::update_piece_cache()
+{
+	if(packed)
+	{
+		piece_cache.invalidate();
+	}
+	else
+	{
+		piece_cache.fill(all_pieces);
+	}
 }
 
 void Vehicle::editor_update(double dt)
 {
-	for(Part* part : parts)
+	// Clear blocked ports
+	for (Port* p : all_ports)
+	{
+		p->blocked = false;
+	}
+
+	if(wires_dirty || wire_graph.built_parts != parts)
+	{
+		wire_graph.build(parts, all_ports);
+		wires_dirty = false;
+	}
+
+	// Same as update, so values written in the editor reach their callbacks
+	for(Machine* m : wire_graph.order)
 	{
-		part->editor_update(dt);
+		m->deliver_inputs();
+		m->editor_update(dt);
 	}
 
 }
@@ -71,7 +118,11 @@ std::vector<Vehicle*> Vehicle::physics_update(double dt)
 		glm::dvec3 grav = in_universe->system.get_gravity_vector(pos, &in_universe->system.bullet_states);
 
 		unpacked_veh.apply_gravity(to_btVector3(grav)); 
-		auto n_vehicles = unpacked_veh.update();
+		auto n_vehicles = unpacked_veh.update(dt);
+
+		// The step moves everything, and we may have rebuilt
+		// or separated during update
+		piece_cache.invalidate();
 		return n_vehicles;
 	}	
 
@@ -81,39 +132,45 @@ void Vehicle::init(Universe* in_universe)
 {
 	for(Part* part : parts)
 	{
-		part->init(in_universe, this);
+		if(part->vehicle == nullptr)
+		{
+			part->init(in_universe, this);
+		}
+		else
+		{
+			// Moved from the vehicle we separated from (see split_off), 
+			// the machines are already running
+			for(auto& pair : part->machines)
+			{
+				pair.second->env["vehicle"] = this;
+			}
+		}
 	}
 
 	this->in_universe = in_universe;
 
 	// Init wires
-	if(wires_init)
+	if(!wires_init.empty())
 	{
 		// Load wires
-		for(auto wire : *wires_init)
+		for(const WireInit& wire : wires_init)
 		{
-			int64_t from_id = *wire->get_as<int64_t>("from");
-			int64_t to_id = *wire->get_as<int64_t>("to");
-			std::string from_machine = *wire->get_as<std::string>("fmachine");
-			std::string to_machine = *wire->get_as<std::string>("tmachine");
-			std::string from_port = *wire->get_as<std::string>("fport");
-			std::string to_port = *wire->get_as<std::string>("tport");
-
-			Part* from = get_part(from_id);
-			Part* to = get_part(to_id);
+			Part* from = get_part(wire.from);
+			Part* to = get_part(wire.to);
 
-			Machine* from_mach = from->get_machine(from_machine);
-			Machine* to_mach = to->get_machine(to_machine);
+			Machine* from_mach = from->get_machine(wire.fmachine);
+			Machine* to_mach = to->get_machine(wire.tmachine);
 
-			Port* from_prt = from_mach->get_output_port(from_port);
-			Port* to_prt = to_mach->get_input_port(to_port);
+			Port* from_prt = from_mach->get_output_port(wire.fport);
+			Port* to_prt = to_mach->get_input_port(wire.tport);
 			
-			from_prt->to.push_back(to_prt);
+			from_prt->connect(to_prt);
 		}
 
-		wires_init = nullptr;
+		wires_init.clear();
 
 		check_wires();
+		wires_dirty = true;
 	}
 }
 
@@ -157,39 +214,71 @@ void Vehicle::update_attachments()
 }
 
 
-void Vehicle::sort()
+void Vehicle::update_tree()
 {
-	std::unordered_set<Piece*> open;
+	size_t count = all_pieces.size();
 
-	open.insert(root);
+	bool changed = tree_pieces.size() != count;
+	for (size_t i = 0; i < count && !changed; i++)
+	{
+		changed = tree_pieces[i] != all_pieces[i] || tree_parents[i] != all_pieces[i]->attached_to;
+	}
 
-	std::vector<Piece*> sorted;
-	sorted.push_back(root);
+	if (!changed)
+	{
+		return;
+	}
+
+	tree_pieces = all_pieces;
+	tree_parents.resize(count);
+	tree_index.clear();
+	tree_index.reserve(count);
 
-	while (!open.empty())
+	for (size_t i = 0; i < count; i++)
 	{
-		std::unordered_set<Piece*> new_open;
+		tree_parents[i] = all_pieces[i]->attached_to;
+		tree_index[all_pieces[i]] = i;
+	}
 
-		for (Piece* o : open)
+	tree_parent_index.assign(count, PieceTree::NONE);
+	for (size_t i = 0; i < count; i++)
+	{
+		auto it = tree_index.find(tree_parents[i]);
+		if (it != tree_index.end())
 		{
-
-			for (Piece* p : all_pieces)
-			{
-				if (p->attached_to == o)
-				{
-					new_open.insert(p);
-					sorted.push_back(p);
-				}
-			}
+			tree_parent_index[i] = it->second;
 		}
-
-		open = new_open;
-		
 	}
 
-	logger->check(sorted.size() == all_pieces.size(), "Vehicle was sorted while some pieces were not attached!");
+	tree.build(tree_parent_index);
+}
+
+size_t Vehicle::get_tree_index(Piece* p)
+{
+	auto it = tree_index.find(p);
+	logger->check(it != tree_index.end(), "Piece is not in the vehicle");
+	return it->second;
+}
+
+void Vehicle::sort()
+{
+	update_tree();
+
+	std::vector<size_t> order;
+	order.reserve(all_pieces.size());
+	tree.breadth_first(get_tree_index(root), order);
+
+	logger->check(order.size() == all_pieces.size(), "Vehicle was sorted while some pieces were not attached!");
+
+	std::vector<Piece*> sorted;
+	sorted.reserve(order.size());
+	for (size_t i : order)
+	{
+		sorted.push_back(tree_pieces[i]);
+	}
 
 	all_pieces = sorted;
+	update_tree();
 }
 
 void Vehicle::check_wires()
@@ -246,6 +335,44 @@ void Vehicle::check_wires()
 	}
 }
 
+size_t Vehicle::get_lua_memory(size_t* state_count)
+{
+	std::unordered_set<lua_State*> seen;
+	size_t total = 0;
+
+	auto add_state = [&seen, &total](sol::state_view st)
+	{
+		if(seen.insert(st.lua_state()).second)
+		{
+			total += st.memory_used();
+		}
+	};
+
+	for(Part* part : parts)
+	{
+		for(auto& pair : part->machines)
+		{
+			add_state(pair.second->get_lua_state());
+		}
+	}
+
+	for(Piece* p : all_pieces)
+	{
+		LuaLink* lua_link = dynamic_cast<LuaLink*>(p->link.get());
+		if(lua_link)
+		{
+			add_state(sol::state_view(lua_link->lua_state));
+		}
+	}
+
+	if(state_count)
+	{
+		*state_count = seen.size();
+	}
+
+	return total;
+}
+
 Piece* Vehicle::get_piece(int64_t id)
 {
 	auto it = id_to_piece.find(id);
@@ -262,6 +389,10 @@ Part* Vehicle::get_part(int64_t id)
 
 Vehicle::Vehicle() : unpacked_veh(this), packed_veh(this)
 {
+	lua_calls = 0;
+	last_lua_calls = 0;
+	wires_dirty = true;
+	update_group = this;
 }
 
 Vehicle::~Vehicle() 
@@ -276,32 +407,193 @@ Vehicle::~Vehicle()
 		delete p;
 	}
 
-	// Ports are deleted by the machines
+	// Ports are deleted (and unwired) by the machines
 }
 
 std::vector<Piece*> Vehicle::get_children_of(Piece* p)
 {
+	update_tree();
+
+	std::vector<size_t> subtree;
+	tree.get_subtree(get_tree_index(p), subtree);
+
 	std::vector<Piece*> out;
+	out.reserve(subtree.size());
+	for (size_t i : subtree)
+	{
+		out.push_back(tree_pieces[i]);
+	}
+
+	return out;
+}
+
+std::vector<bool> Vehicle::get_reachable_from_root()
+{
+	update_tree();
+
+	std::vector<bool> reachable;
+	tree.mark_reachable(get_tree_index(root), reachable);
+
+	return reachable;
+}
 
-	// TODO: Think of a better implementation
-	// This one COULD stack overflow, and it's not particularly efficient
-	for(Piece* np : all_pieces)
+std::vector<std::vector<Piece*>> Vehicle::split_cut_pieces()
+{
+	std::vector<std::vector<Piece*>> out;
+	size_t count = all_pieces.size();
+
+	// Cuts are the only change the tree may have missed, anything else 
+	// (added, reordered or re-attached pieces) needs it rebuilt
+	bool stale = tree_pieces.size() != count;
+	for (size_t i = 0; i < count && !stale; i++)
+	{
+		Piece* p = all_pieces[i];
+		stale = tree_pieces[i] != p || (p->attached_to != nullptr && p->attached_to != tree_parents[i]);
+	}
+
+	if (stale)
 	{
-		if(np->attached_to == p)
+		update_tree();
+	}
+
+	std::vector<bool> cut(count, false);
+	std::vector<size_t> cut_pieces;
+	for (size_t i = 0; i < count; i++)
+	{
+		Piece* p = tree_pieces[i];
+		if (p != root && (p->attached_to == nullptr || tree_parent_index[i] == PieceTree::NONE))
+		{
+			cut[i] = true;
+			cut_pieces.push_back(i);
+		}
+	}
+
+	if (cut_pieces.empty())
+	{
+		return out;
+	}
+
+	std::vector<bool> removed(count, false);
+	std::vector<size_t> queue;
+	for (size_t cut_piece : cut_pieces)
+	{
+		queue.clear();
+		queue.push_back(cut_piece);
+		removed[cut_piece] = true;
+
+		for (size_t head = 0; head < queue.size(); head++)
+		{
+			size_t node = queue[head];
+			for (const size_t* it = tree.children_begin(node); it != tree.children_end(node); it++)
+			{
+				if (!cut[*it])
+				{
+					queue.push_back(*it);
+					removed[*it] = true;
+				}
+			}
+		}
+
+		out.emplace_back();
+		out.back().reserve(queue.size());
+		for (size_t node : queue)
 		{
-			out.push_back(np);
+			out.back().push_back(tree_pieces[node]);
 		}
 	}
 
-	// Now find all children of every piece in out
-	std::vector<Piece*> sub_children;
-	for(Piece* child : out)
+	std::vector<Piece*> kept;
+	kept.reserve(count);
+	for (size_t i = 0; i < count; i++)
 	{
-		auto nchild = get_children_of(child);
-		sub_children.insert(sub_children.end(), nchild.begin(), nchild.end());
+		if (!removed[i])
+		{
+			kept.push_back(tree_pieces[i]);
+		}
 	}
 
-	out.insert(out.end(), sub_children.begin(), sub_children.end());
+	all_pieces = kept;
 
 	return out;
 }
+
+Vehicle* Vehicle::split_off(const std::vector<Piece*>& pieces)
+{
+	Vehicle* n_vehicle = new Vehicle();
+	n_vehicle->all_pieces = pieces;
+	n_vehicle->root = pieces[0];
+	n_vehicle->part_id = part_id;
+	n_vehicle->piece_id = piece_id;
+	n_vehicle->update_group = update_group;
+	n_vehicle->blueprint = blueprint;
+
+	std::unordered_set<Part*> moved_parts;
+	std::unordered_set<Port*> moved_ports;
+	for (Piece* p : pieces)
+	{
+		p->in_vehicle = n_vehicle;
+		id_to_piece.erase(p->id);
+		n_vehicle->id_to_piece[p->id] = p;
+
+		Part* part = p->part;
+		auto it = part->pieces.find(PartPrototype::ROOT_NAME);
+		if (it == part->pieces.end() || it->second != p)
+		{
+			continue;
+		}
+
+		// Machines are moved as they are, Vehicle::init won't init them again
+		moved_parts.insert(part);
+		n_vehicle->parts.push_back(part);
+		id_to_part.erase(part->id);
+		n_vehicle->id_to_part[part->id] = part;
+		part->vehicle = n_vehicle;
+
+		for (auto& pair : part->machines)
+		{
+			for (Port* port : pair.second->ports)
+			{
+				moved_ports.insert(port);
+				n_vehicle->all_ports.push_back(port);
+			}
+		}
+	}
+
+	// Wires between the two vehicles are cut, both ends of a wire
+	// must be on the same vehicle
+	std::vector<Port*> cut;
+	for (Port* port : moved_ports)
+	{
+		cut.clear();
+		for (Port* other : port->is_output ? port->to : port->from)
+		{
+			if (moved_ports.count(other) == 0)
+			{
+				cut.push_back(other);
+			}
+		}
+
+		for (Port* other : cut)
+		{
+			port->disconnect(other);
+		}
+	}
+
+	if (!moved_parts.empty())
+	{
+		parts.erase(std::remove_if(parts.begin(), parts.end(), [&moved_parts](Part* part)
+		{
+			return moved_parts.count(part) != 0;
+		}), parts.end());
+
+		all_ports.erase(std::remove_if(all_ports.begin(), all_ports.end(), [&moved_ports](Port* port)
+		{
+			return moved_ports.count(port) != 0;
+		}), all_ports.end());
+
+		wires_dirty = true;
+		n_vehicle->wires_dirty = true;
+	}
+
+	return n_vehicle;
+}
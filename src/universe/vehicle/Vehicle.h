@@ -15,9 +15,14 @@
 
 #include "UnpackedVehicle.h"
 #include "PackedVehicle.h"
+#include "PieceTree.h"
+#include "PieceStateCache.h"
+#include "wire/WireGraph.h"
+#include <memory>
 
 
 class VehicleLoader;
+class VehicleSnapshot;
 
 // A Vehicle is basically a tree of parts (actually pieces), connected
 // via various links. The root piece is always the root node.
@@ -57,12 +62,33 @@ private:
 
 	bool packed;
 	
-	// Initialized on the call to init, is deleted afterwards
-	std::shared_ptr<cpptoml::table_array> wires_init;
+	struct WireInit
+	{
+		int64_t from, to;
+		std::string fmachine, fport;
+		std::string tmachine, tport;
+	};
+
+	// Initialized on the call to init, is cleared afterwards
+	std::vector<WireInit> wires_init;
 
 	std::unordered_map<int64_t, Piece*> id_to_piece;
 	std::unordered_map<int64_t, Part*> id_to_part;
 
+	// Children index over all_pieces, and the pieces and attached_to
+	// it was built from, to detect changes in topology
+	PieceTree tree;
+	std::vector<Piece*> tree_pieces;
+	std::vector<Piece*> tree_parents;
+	// Index of tree_parents[i], PieceTree::NONE if it's not in the vehicle
+	std::vector<size_t> tree_parent_index;
+	std::unordered_map<Piece*, size_t> tree_index;
+
+	// Rebuilds the tree if any piece was added, removed, reordered
+	// or re-attached since it was built (linear time)
+	void update_tree();
+	size_t get_tree_index(Piece* p);
+
 public:
 
 	Universe* in_universe;
@@ -73,6 +99,7 @@ public:
 	friend class UnpackedVehicle;
 	friend class PackedVehicle;
 	friend class VehicleLoader;
+class VehicleSnapshot;
 	friend class Piece;
 	friend class Part;
 
@@ -87,6 +114,28 @@ public:
 	// Keep up to date by the machines themselves
 	std::vector<Port*> all_ports;
 
+	// Machine update order following the wires, rebuilt on update
+	// if wires_dirty is set or the parts changed
+	WireGraph wire_graph;
+	bool wires_dirty;
+
+	// Vehicles separated from the same vehicle may share lua states, so they 
+	// share this key and never update in parallel (see Entity::get_update_group)
+	void* update_group;
+
+	// Only filled while unpacked, see PieceStateCache
+	PieceStateCache piece_cache;
+
+	// The snapshot the vehicle was loaded from, inherited by separated vehicles.
+	// Saving takes what is not kept by the vehicle from it (prototype paths, 
+	// extra keys, link parameters...), see VehicleSnapshot::from_vehicle
+	std::shared_ptr<const VehicleSnapshot> blueprint;
+
+	// Calls into lua done by the machines (hooks and port callbacks),
+	// lua_calls counts the current frame, and last_lua_calls the previous one
+	size_t lua_calls;
+	size_t last_lua_calls;
+
 
 	void pack();
 
@@ -97,6 +146,8 @@ public:
 	void set_linear_velocity(glm::dvec3 vel);
 
 	void update(double dt);	
+	// Fills the piece cache, call after the physics step
+	void update_piece_cache();
 	void editor_update(double dt);
 
 	// The return is only populated if something separated
@@ -111,19 +162,43 @@ public:
 
 	void set_world(btDynamicsWorld* world)
 	{	
-		unpacked_veh.world = world;
+		unpacked_veh.set_world(world);
 	}
 
+	// Sorts all_pieces in breadth first order from the root
 	void sort();
 
+	// Returns all pieces in the subtree of p, not including p.
 	// This one doesn't need the array to be sorted
-	// but it's slower (used in the editor)
 	// It allows finding children of separated parts
 	std::vector<Piece*> get_children_of(Piece* p);
 
+	// Returns, for every piece in all_pieces, if it can reach the root
+	// through attached_to
+	std::vector<bool> get_reachable_from_root();
+
+	// Removes from all_pieces the pieces cut since the tree was built (their 
+	// attached_to set to nullptr) and everything attached to them. Each cut
+	// piece is the first of one of the returned sets, followed by its subtree
+	// in breadth first order, a cut inside the subtree starts its own set.
+	// Only the cut subtrees are walked, as the tree still has the topology
+	// from before the cuts, what's kept keeps its order
+	std::vector<std::vector<Piece*>> split_cut_pieces();
+
+	// Creates a vehicle with the given pieces (root first), which must not be
+	// in all_pieces anymore (see split_cut_pieces). Parts whose root piece is
+	// given go with it, with their machines and ports as they are, wires between
+	// them and the parts that stay are removed. Only touches the moved pieces 
+	// and parts, besides a pass over our parts and ports
+	Vehicle* split_off(const std::vector<Piece*>& pieces);
+
 	// Removes and reports any wrong wires (as an error)
 	void check_wires();
 
+	// Total memory used by the lua states of the machines and links
+	// of the vehicle, shared states are only counted once
+	size_t get_lua_memory(size_t* state_count = nullptr);
+
 	Piece* get_piece(int64_t id);
 	Part* get_part(int64_t id);
 
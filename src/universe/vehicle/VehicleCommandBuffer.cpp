@@ -0,0 +1,97 @@
+#include "VehicleCommandBuffer.h"
+
+thread_local VehicleCommandBuffer* VehicleCommandBuffer::current = nullptr;
+
+void VehicleCommandBuffer::run(CommandType type, btRigidBody* body, const btVector3& a, const btVector3& b)
+{
+	Command cmd;
+	cmd.type = type;
+	cmd.body = body;
+	cmd.a = a;
+	cmd.b = b;
+
+	if(current && !current->immediate)
+	{
+		current->commands.push_back(cmd);
+	}
+	else
+	{
+		execute(cmd);
+	}
+}
+
+void VehicleCommandBuffer::run_deferred(std::function<void()> fnc)
+{
+	if(current)
+	{
+		current->deferred.push_back(std::move(fnc));
+	}
+	else
+	{
+		fnc();
+	}
+}
+
+void VehicleCommandBuffer::run_world_change(std::function<void()> fnc)
+{
+	if(current && !current->immediate)
+	{
+		current->deferred.push_back(std::move(fnc));
+	}
+	else
+	{
+		fnc();
+	}
+}
+
+void VehicleCommandBuffer::execute(const Command& cmd)
+{
+	btRigidBody* body = cmd.body;
+
+	switch(cmd.type)
+	{
+	case APPLY_FORCE:
+		body->applyForce(cmd.a, cmd.b);
+		break;
+	case APPLY_TORQUE:
+		body->applyTorque(cmd.a);
+		break;
+	case APPLY_IMPULSE:
+		body->applyImpulse(cmd.a, cmd.b);
+		break;
+	case APPLY_TORQUE_IMPULSE:
+		body->applyTorqueImpulse(cmd.a);
+		break;
+	case APPLY_CENTRAL_IMPULSE:
+		body->applyCentralImpulse(cmd.a);
+		break;
+	case SET_LINEAR_VELOCITY:
+		body->setLinearVelocity(cmd.a);
+		break;
+	case SET_ANGULAR_VELOCITY:
+		body->setAngularVelocity(cmd.a);
+		break;
+	case TRANSLATE:
+		body->translate(cmd.a);
+		break;
+	case CLEAR_FORCES:
+		body->clearForces();
+		break;
+	}
+}
+
+void VehicleCommandBuffer::apply()
+{
+	for(const Command& cmd : commands)
+	{
+		execute(cmd);
+	}
+
+	for(auto& fnc : deferred)
+	{
+		fnc();
+	}
+
+	commands.clear();
+	deferred.clear();
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <functional>
+#pragma warning(push, 0)
+#include <btBulletDynamicsCommon.h>
+#pragma warning(pop)
+
+// While vehicles update in parallel, calls that modify bullet are not
+// done directly but recorded here, and applied in order on the main
+// thread once all vehicles have updated. 
+// Code that may run during the parallel update (lua bindings) uses run(),
+// which applies the command right away if no buffer is being recorded
+class VehicleCommandBuffer
+{
+public:
+
+	enum CommandType
+	{
+		APPLY_FORCE,
+		APPLY_TORQUE,
+		APPLY_IMPULSE,
+		APPLY_TORQUE_IMPULSE,
+		APPLY_CENTRAL_IMPULSE,
+		SET_LINEAR_VELOCITY,
+		SET_ANGULAR_VELOCITY,
+		TRANSLATE,
+		CLEAR_FORCES
+	};
+
+	struct Command
+	{
+		CommandType type;
+		btRigidBody* body;
+		btVector3 a, b;
+	};
+
+	std::vector<Command> commands;
+
+	// Anything else that must run on the main thread (world changes, events...),
+	// these run after all commands
+	std::vector<std::function<void()>> deferred;
+
+	// If true, commands run right away and only deferred functions are
+	// recorded, for threads which own the bullet world (physics bubbles)
+	bool immediate = false;
+
+	// Set on the thread updating a vehicle in parallel, nullptr otherwise
+	static thread_local VehicleCommandBuffer* current;
+
+	static void run(CommandType type, btRigidBody* body, 
+		const btVector3& a = btVector3(0, 0, 0), const btVector3& b = btVector3(0, 0, 0));
+
+	// Runs fnc now, or after the parallel update if a buffer is being recorded
+	static void run_deferred(std::function<void()> fnc);
+
+	// Same as run_deferred, for changes to the bullet world, so they also
+	// run right away on immediate buffers
+	static void run_world_change(std::function<void()> fnc);
+
+	static void execute(const Command& cmd);
+
+	// Applies and clears everything recorded
+	void apply();
+};
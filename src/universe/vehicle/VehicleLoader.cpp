@@ -9,25 +9,49 @@ Vehicle* VehicleLoader::get_vehicle()
 	return to_return;
 }
 
-void VehicleLoader::load_metadata(cpptoml::table& root)
+Vehicle* VehicleLoader::load_file(const std::string& path)
+{
+	if(VehicleSnapshot::is_snapshot_file(path))
+	{
+		VehicleSnapshot snapshot;
+		snapshot.read_file(path);
+		return VehicleLoader(snapshot).get_vehicle();
+	}
+	else
+	{
+		auto vehicle_toml = SerializeUtil::load_file(path);
+		return VehicleLoader(*vehicle_toml).get_vehicle();
+	}
+}
+
+void VehicleLoader::load_metadata(const VehicleSnapshot& snapshot)
 {
 	// TODO: Description and package check
-	n_vehicle->part_id = *root.get_qualified_as<int64_t>("part_id");
-	n_vehicle->piece_id = *root.get_qualified_as<int64_t>("piece_id");
+	n_vehicle->part_id = snapshot.part_id;
+	n_vehicle->piece_id = snapshot.piece_id;
 
 }
 
-void VehicleLoader::obtain_parts(cpptoml::table& root)
+void VehicleLoader::obtain_parts(const VehicleSnapshot& snapshot)
 {
-	auto parts = root.get_table_array_qualified("part");	
+	// Each prototype path is resolved once, parts duplicate the handle
+	std::unordered_map<uint32_t, AssetHandle<PartPrototype>> protos;
 
-	for(auto part : *parts)
+	for(size_t i = 0; i < snapshot.parts.size(); i++)
 	{
-		std::string proto_path = *part->get_qualified_as<std::string>("proto");
-		AssetHandle<PartPrototype> part_proto = AssetHandle<PartPrototype>(proto_path);
-		Part* n_part = new Part(part_proto, *part);
+		const VehicleSnapshot::PartEntry& part = snapshot.parts[i];
+
+		auto it = protos.find(part.proto);
+		if(it == protos.end())
+		{
+			it = protos.emplace(part.proto, AssetHandle<PartPrototype>(snapshot.get_string(part.proto))).first;
+		}
+
+		// Machine overrides are in the extra keys
+		Part* n_part = new Part(it->second, *snapshot.part_extra[i], 
+			lua_core->share_vehicle_states ? &shared_states : nullptr);
 
-		n_part->id = *part->get_qualified_as<int64_t>("id");
+		n_part->id = part.id;
 		logger->check(n_part->id <= n_vehicle->part_id, "Malformed vehicle, part ID too big ({}/{})", 
 				n_part->id, n_vehicle->part_id);
 
@@ -38,53 +62,42 @@ void VehicleLoader::obtain_parts(cpptoml::table& root)
 
 }
 
-Piece* VehicleLoader::load_piece(cpptoml::table& piece)
+Piece* VehicleLoader::load_piece(const VehicleSnapshot& snapshot, const VehicleSnapshot::PieceEntry& piece)
 {
-	int64_t part_id = *piece.get_qualified_as<int64_t>("part");
-	std::string node = *piece.get_qualified_as<std::string>("node");
-	bool is_root_of_part = node == "p_root";
+	int64_t part_id = piece.part;
+	const std::string& node = snapshot.get_string(piece.node);
 
-	int64_t piece_id = *piece.get_qualified_as<int64_t>("id");
-	
-	Piece* n_piece = new Piece(parts_by_id[part_id], node);
-	n_piece->id = piece_id;
-
-	// Add ourselves to the part
 	logger->check(parts_by_id.find(part_id) != parts_by_id.end(), "Invalid part ID ({})", part_id);
 	Part* part = parts_by_id[part_id];
+
+	Piece* n_piece = new Piece(part, node);
+	n_piece->id = piece.id;
+
+	// Add ourselves to the part
 	logger->check(part->pieces.find(node) == part->pieces.end(), "Duplicate piece of part");
 	part->pieces[node] = n_piece;
 	n_piece->part = part;
 
 	// Load transform
-	auto pos = piece.get_table_qualified("pos");
-	auto rot = piece.get_table_qualified("rot");
-	glm::dvec3 pos_d; deserialize(pos_d, *pos);
-	glm::dvec4 rot_d; deserialize(rot_d, *rot);
 	n_piece->packed_tform.setIdentity();
-	n_piece->packed_tform.setOrigin(to_btVector3(pos_d));
-	n_piece->packed_tform.setRotation(to_btQuaternion(glm::dquat(rot_d.w, rot_d.x, rot_d.y, rot_d.z)));
+	n_piece->packed_tform.setOrigin(btVector3(piece.pos[0], piece.pos[1], piece.pos[2]));
+	n_piece->packed_tform.setRotation(btQuaternion(piece.rot[0], piece.rot[1], piece.rot[2], piece.rot[3]));
 
-	// Pre-load links (We cannot load them just yet)	
-	auto link = piece.get_table_qualified("link");
-	links_toml[n_piece] = link;
-	
-	pieces_by_id[piece_id] = n_piece;
+	pieces_by_id[piece.id] = n_piece;
 
 	return n_piece;
 }
 
-void VehicleLoader::obtain_pieces(cpptoml::table& root)
+void VehicleLoader::obtain_pieces(const VehicleSnapshot& snapshot)
 {
-	auto pieces = root.get_table_array_qualified("piece");
 	root_piece = nullptr;
 
-	for(auto piece : *pieces)
+	for(const VehicleSnapshot::PieceEntry& piece : snapshot.pieces)
 	{
-		Piece* n_piece = load_piece(*piece);
+		Piece* n_piece = load_piece(snapshot, piece);
+		snapshot_pieces.push_back(n_piece);
 
-		auto root_entry = piece->get_qualified_as<bool>("root");
-		if(root_entry && *root_entry == true)
+		if(piece.flags & VehicleSnapshot::ROOT)
 		{
 			logger->check(root_piece == nullptr, "Multiple root pieces, that's invalid");
 			root_piece = n_piece;
@@ -98,60 +111,85 @@ void VehicleLoader::obtain_pieces(cpptoml::table& root)
 		n_piece->in_vehicle = n_vehicle;
 	}
 
+	logger->check(root_piece != nullptr, "Malformed vehicle, it has no root piece");
 }
 
-void VehicleLoader::copy_pieces(cpptoml::table& root)
+void VehicleLoader::copy_pieces(const VehicleSnapshot& snapshot)
 {
 	n_vehicle->all_pieces.push_back(root_piece);
 	n_vehicle->root = root_piece;
 	for(Piece* p : all_pieces)
 	{
 		n_vehicle->all_pieces.push_back(p);
+	}
+
+	for(size_t i = 0; i < snapshot.pieces.size(); i++)
+	{
+		const VehicleSnapshot::PieceEntry& piece = snapshot.pieces[i];
+		Piece* p = snapshot_pieces[i];
 
-		auto link = links_toml[p];
-		if(link)
+		// The root piece is never attached
+		if(!(piece.flags & VehicleSnapshot::HAS_LINK) || p == root_piece)
 		{
-			int64_t to = *link->get_qualified_as<int64_t>("to");
-			logger->check(pieces_by_id.find(to) != pieces_by_id.end(), "Link to a non-existant piece {}", to);
-			Piece* to_p = pieces_by_id[to];
-			
-			p->attached_to = to_p;
-			
-			p->to_attachment = link->get_as<std::string>("to_attachment").value_or("");
-			p->from_attachment = link->get_as<std::string>("from_attachment").value_or(""); 
-			
-			bool welded = link->get_qualified_as<bool>("welded").value_or(false);
-			p->welded = welded;
-
-			std::string link_type = link->get_qualified_as<std::string>("type").value_or("none");
-			if(link_type != "none")
-			{
-				// Load the physical link
-				p->link = std::make_unique<Link>(assets->load_script(link_type));	
-
-				glm::dvec3 link_from, link_to;
-				deserialize(p->link_from, *link->get_table_qualified("pfrom"));	
-				deserialize(p->link_to, *link->get_table_qualified("pto"));
-				deserialize(p->link_rot, *link->get_table_qualified("rot"));
-			}
+			continue;
+		}
+
+		int64_t to = piece.link_to;
+		logger->check(pieces_by_id.find(to) != pieces_by_id.end(), "Link to a non-existant piece {}", to);
+		p->attached_to = pieces_by_id[to];
+
+		p->to_attachment = piece.to_attachment == VehicleSnapshot::NO_STRING ? "" : snapshot.get_string(piece.to_attachment);
+		p->from_attachment = piece.from_attachment == VehicleSnapshot::NO_STRING ? "" : snapshot.get_string(piece.from_attachment);
+
+		p->welded = (piece.flags & VehicleSnapshot::WELDED) != 0;
+
+		std::string link_type = piece.link_type == VehicleSnapshot::NO_STRING ? "none" : snapshot.get_string(piece.link_type);
+		if(link_type != "none")
+		{
+			logger->check((piece.flags & VehicleSnapshot::HAS_LINK_FROM) && (piece.flags & VehicleSnapshot::HAS_LINK_TO)
+				&& (piece.flags & VehicleSnapshot::HAS_LINK_ROT), "Malformed link on piece {}", piece.id);
+
+			// Load the physical link, either native or a lua script, they get the
+			// link table as it was on the TOML
+			p->link = Link::create(link_type);
+			p->link->load_toml(snapshot.get_link_toml(i));
+
+			p->link_from = glm::dvec3(piece.link_from_pos[0], piece.link_from_pos[1], piece.link_from_pos[2]);
+			p->link_to = glm::dvec3(piece.link_to_pos[0], piece.link_to_pos[1], piece.link_to_pos[2]);
+			p->link_rot = glm::dquat(piece.link_rot[3], piece.link_rot[0], piece.link_rot[1], piece.link_rot[2]);
 		}
 	}
 
 }
 
-VehicleLoader::VehicleLoader(cpptoml::table& root)
+void VehicleLoader::obtain_wires(const VehicleSnapshot& snapshot)
+{
+	for(const VehicleSnapshot::WireEntry& wire : snapshot.wires)
+	{
+		Vehicle::WireInit n_wire;
+		n_wire.from = wire.from;
+		n_wire.to = wire.to;
+		n_wire.fmachine = snapshot.get_string(wire.fmachine);
+		n_wire.fport = snapshot.get_string(wire.fport);
+		n_wire.tmachine = snapshot.get_string(wire.tmachine);
+		n_wire.tport = snapshot.get_string(wire.tport);
+		n_vehicle->wires_init.push_back(n_wire);
+	}
+}
+
+void VehicleLoader::load(const VehicleSnapshot& snapshot)
 {
 	n_vehicle = new Vehicle();
+	n_vehicle->blueprint = std::make_shared<VehicleSnapshot>(snapshot);
 
-	load_metadata(root);
-	obtain_parts(root);
-	obtain_pieces(root);
-	copy_pieces(root);
+	load_metadata(snapshot);
+	obtain_parts(snapshot);
+	obtain_pieces(snapshot);
+	copy_pieces(snapshot);
 
 	// Wires are initialized after this by the vehicle
 	// as machines need to start
-	auto wires = root.get_table_array("wire");
-	n_vehicle->wires_init = wires;
+	obtain_wires(snapshot);
 
 	n_vehicle->id_to_part = parts_by_id;
 	n_vehicle->id_to_piece = pieces_by_id;
@@ -168,4 +206,24 @@ VehicleLoader::VehicleLoader(cpptoml::table& root)
 	n_vehicle->sort();
 
 	n_vehicle->update_attachments();
+
+	size_t state_count;
+	size_t lua_memory = n_vehicle->get_lua_memory(&state_count);
+	// Compare with lua.share_vehicle_states on and off to see what sharing saves
+	logger->info("Vehicle loaded with {} lua states ({}), using {:.2f}MB ({:.1f}KB per state)", 
+		state_count, lua_core->share_vehicle_states ? "shared per package" : "one per machine",
+		(double)lua_memory / 1000000.0, 
+		state_count == 0 ? 0.0 : (double)lua_memory / (double)state_count / 1000.0);
+}
+
+VehicleLoader::VehicleLoader(cpptoml::table& root)
+{
+	VehicleSnapshot snapshot;
+	snapshot.from_toml(root);
+	load(snapshot);
+}
+
+VehicleLoader::VehicleLoader(const VehicleSnapshot& snapshot)
+{
+	load(snapshot);
 }
@@ -1,9 +1,12 @@
 #pragma once
 #include "Vehicle.h"
+#include "VehicleSnapshot.h"
 #include <util/SerializeUtil.h>
 #include <util/serializers/glm.h>
 #include <physics/glm/BulletGlmCompat.h>
 
+// Vehicles are always loaded from a VehicleSnapshot, TOML vehicles are
+// converted first
 class VehicleLoader
 {
 private:
@@ -11,20 +14,31 @@ private:
 	Vehicle* n_vehicle;
 	std::unordered_map<int64_t, Part*> parts_by_id;
 	std::unordered_map<int64_t, Piece*> pieces_by_id;
-	std::unordered_map<Piece*, std::shared_ptr<cpptoml::table>> links_toml;
 	std::vector<Piece*> all_pieces;
+	// Same order as the snapshot pieces
+	std::vector<Piece*> snapshot_pieces;
 	Piece* root_piece;
 
+	// Only used if lua_core->share_vehicle_states is set
+	std::unordered_map<std::string, std::shared_ptr<SharedLuaState>> shared_states;
 
-	void load_metadata(cpptoml::table& root);
-	void obtain_parts(cpptoml::table& root);
-	void obtain_pieces(cpptoml::table& root);
-	void copy_pieces(cpptoml::table& root);
-	Piece* load_piece(cpptoml::table& piece);
+
+	void load_metadata(const VehicleSnapshot& snapshot);
+	void obtain_parts(const VehicleSnapshot& snapshot);
+	void obtain_pieces(const VehicleSnapshot& snapshot);
+	void copy_pieces(const VehicleSnapshot& snapshot);
+	void obtain_wires(const VehicleSnapshot& snapshot);
+	Piece* load_piece(const VehicleSnapshot& snapshot, const VehicleSnapshot::PieceEntry& piece);
+
+	void load(const VehicleSnapshot& snapshot);
 
 public:
 
 	Vehicle* get_vehicle();
 
+	// Loads either a TOML vehicle or a snapshot, depending on the file
+	static Vehicle* load_file(const std::string& path);
+
 	VehicleLoader(cpptoml::table& root);
+	VehicleLoader(const VehicleSnapshot& snapshot);
 };
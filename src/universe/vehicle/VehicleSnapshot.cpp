@@ -0,0 +1,487 @@
+#include "VehicleSnapshot.h"
+#include "Vehicle.h"
+#include <util/MappedFile.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+
+// Stores every distinct string once
+struct StringInterner
+{
+	std::vector<std::string>& strings;
+	std::unordered_map<std::string, uint32_t> index;
+
+	uint32_t get(const std::string& str)
+	{
+		auto it = index.find(str);
+		if(it != index.end())
+		{
+			return it->second;
+		}
+
+		uint32_t idx = (uint32_t)strings.size();
+		strings.push_back(str);
+		index[str] = idx;
+		return idx;
+	}
+
+	StringInterner(std::vector<std::string>& strings) : strings(strings) {}
+};
+
+static std::shared_ptr<cpptoml::table> clone_table(const cpptoml::table& table)
+{
+	return std::static_pointer_cast<cpptoml::table>(table.clone());
+}
+
+// The take functions remove what they read from the table,
+// so only the extra keys are left in it
+
+static int64_t take_int(cpptoml::table& table, const std::string& key)
+{
+	auto val = table.get_as<int64_t>(key);
+	logger->check(val.operator bool(), "Malformed vehicle, missing integer '{}'", key);
+	table.erase(key);
+	return *val;
+}
+
+static uint32_t take_string(cpptoml::table& table, const std::string& key, StringInterner& interner, bool optional = false)
+{
+	auto val = table.get_as<std::string>(key);
+	if(!val)
+	{
+		logger->check(optional, "Malformed vehicle, missing string '{}'", key);
+		return VehicleSnapshot::NO_STRING;
+	}
+
+	table.erase(key);
+	return interner.get(*val);
+}
+
+// Tables with x, y, z and optionally w
+static bool take_vec(cpptoml::table& table, const std::string& key, double* out, int count, bool optional = false)
+{
+	auto sub = table.get_table(key);
+	if(!sub)
+	{
+		logger->check(optional, "Malformed vehicle, missing table '{}'", key);
+		return false;
+	}
+
+	static const char* names[] = { "x", "y", "z", "w" };
+	for(int i = 0; i < count; i++)
+	{
+		auto val = sub->get_as<double>(names[i]);
+		logger->check(val.operator bool(), "Malformed vehicle, '{}' has no '{}'", key, names[i]);
+		out[i] = *val;
+	}
+
+	table.erase(key);
+	return true;
+}
+
+static std::shared_ptr<cpptoml::table> make_vec(const double* v, int count)
+{
+	static const char* names[] = { "x", "y", "z", "w" };
+	auto table = cpptoml::make_table();
+	for(int i = 0; i < count; i++)
+	{
+		table->insert(names[i], v[i]);
+	}
+	return table;
+}
+
+const std::string& VehicleSnapshot::get_string(uint32_t idx) const
+{
+	logger->check(idx < strings.size(), "Malformed vehicle snapshot, string {} out of bounds", idx);
+	return strings[idx];
+}
+
+void VehicleSnapshot::from_toml(const cpptoml::table& root)
+{
+	strings.clear(); parts.clear(); pieces.clear(); wires.clear();
+	part_extra.clear(); piece_extra.clear(); link_extra.clear(); wire_extra.clear();
+
+	StringInterner interner = StringInterner(strings);
+
+	root_extra = clone_table(root);
+	part_id = take_int(*root_extra, "part_id");
+	piece_id = take_int(*root_extra, "piece_id");
+
+	auto toml_parts = root.get_table_array("part");
+	logger->check(toml_parts.operator bool(), "Malformed vehicle, it has no parts");
+	for(const auto& part : *toml_parts)
+	{
+		auto extra = clone_table(*part);
+		PartEntry entry = {};
+		entry.id = take_int(*extra, "id");
+		entry.proto = take_string(*extra, "proto", interner);
+
+		parts.push_back(entry);
+		part_extra.push_back(extra);
+	}
+
+	auto toml_pieces = root.get_table_array("piece");
+	logger->check(toml_pieces.operator bool(), "Malformed vehicle, it has no pieces");
+	for(const auto& piece : *toml_pieces)
+	{
+		auto extra = clone_table(*piece);
+		PieceEntry entry = {};
+		entry.id = take_int(*extra, "id");
+		entry.part = take_int(*extra, "part");
+		entry.node = take_string(*extra, "node", interner);
+		take_vec(*extra, "pos", entry.pos, 3);
+		take_vec(*extra, "rot", entry.rot, 4);
+
+		auto root_entry = extra->get_as<bool>("root");
+		if(root_entry)
+		{
+			entry.flags |= ROOT_KEY | (*root_entry ? ROOT : 0);
+			extra->erase("root");
+		}
+
+		auto link = extra->get_table("link");
+		std::shared_ptr<cpptoml::table> link_ex = cpptoml::make_table();
+		entry.from_attachment = NO_STRING;
+		entry.to_attachment = NO_STRING;
+		entry.link_type = NO_STRING;
+		if(link)
+		{
+			link_ex = clone_table(*link);
+			extra->erase("link");
+			entry.flags |= HAS_LINK;
+
+			entry.link_to = take_int(*link_ex, "to");
+
+			auto welded = link_ex->get_as<bool>("welded");
+			if(welded)
+			{
+				entry.flags |= WELDED_KEY | (*welded ? WELDED : 0);
+				link_ex->erase("welded");
+			}
+
+			entry.from_attachment = take_string(*link_ex, "from_attachment", interner, true);
+			entry.to_attachment = take_string(*link_ex, "to_attachment", interner, true);
+			entry.link_type = take_string(*link_ex, "type", interner, true);
+
+			entry.flags |= take_vec(*link_ex, "pfrom", entry.link_from_pos, 3, true) ? HAS_LINK_FROM : 0;
+			entry.flags |= take_vec(*link_ex, "pto", entry.link_to_pos, 3, true) ? HAS_LINK_TO : 0;
+			entry.flags |= take_vec(*link_ex, "rot", entry.link_rot, 4, true) ? HAS_LINK_ROT : 0;
+		}
+
+		pieces.push_back(entry);
+		piece_extra.push_back(extra);
+		link_extra.push_back(link_ex);
+	}
+
+	auto toml_wires = root.get_table_array("wire");
+	if(toml_wires)
+	{
+		for(const auto& wire : *toml_wires)
+		{
+			auto extra = clone_table(*wire);
+			WireEntry entry = {};
+			entry.from = take_int(*extra, "from");
+			entry.to = take_int(*extra, "to");
+			entry.fmachine = take_string(*extra, "fmachine", interner);
+			entry.fport = take_string(*extra, "fport", interner);
+			entry.tmachine = take_string(*extra, "tmachine", interner);
+			entry.tport = take_string(*extra, "tport", interner);
+
+			wires.push_back(entry);
+			wire_extra.push_back(extra);
+		}
+	}
+
+	root_extra->erase("part");
+	root_extra->erase("piece");
+	root_extra->erase("wire");
+}
+
+VehicleSnapshot VehicleSnapshot::from_vehicle(Vehicle* vehicle)
+{
+	logger->check(vehicle->blueprint != nullptr, "Vehicle has no blueprint, it was not loaded from a snapshot");
+	const VehicleSnapshot& blueprint = *vehicle->blueprint;
+
+	VehicleSnapshot out;
+	out.part_id = blueprint.part_id;
+	out.piece_id = blueprint.piece_id;
+	// String indices stay valid, even if some strings are not used anymore
+	out.strings = blueprint.strings;
+	out.root_extra = blueprint.root_extra;
+
+	std::unordered_map<int64_t, size_t> part_index;
+	for(size_t i = 0; i < blueprint.parts.size(); i++)
+	{
+		part_index[blueprint.parts[i].id] = i;
+	}
+
+	std::unordered_map<int64_t, size_t> piece_index;
+	for(size_t i = 0; i < blueprint.pieces.size(); i++)
+	{
+		piece_index[blueprint.pieces[i].id] = i;
+	}
+
+	// After a separation a part may have pieces on both vehicles, but it's only
+	// in Vehicle::parts of the vehicle with its root piece, so we find them 
+	// through the pieces
+	std::unordered_set<int64_t> parts_in;
+	for(Piece* p : vehicle->all_pieces)
+	{
+		if(parts_in.insert(p->part->id).second)
+		{
+			auto it = part_index.find(p->part->id);
+			logger->check(it != part_index.end(), "Part {} is not in the blueprint of its vehicle", p->part->id);
+			out.parts.push_back(blueprint.parts[it->second]);
+			out.part_extra.push_back(blueprint.part_extra[it->second]);
+		}
+	}
+
+	btTransform root_inverse = vehicle->root->get_global_transform().inverse();
+
+	for(Piece* p : vehicle->all_pieces)
+	{
+		auto it = piece_index.find(p->id);
+		logger->check(it != piece_index.end(), "Piece {} is not in the blueprint of its vehicle", p->id);
+		PieceEntry entry = blueprint.pieces[it->second];
+
+		btTransform tform = root_inverse * p->get_global_transform();
+		btVector3 pos = tform.getOrigin();
+		btQuaternion rot = tform.getRotation();
+		entry.pos[0] = pos.x(); entry.pos[1] = pos.y(); entry.pos[2] = pos.z();
+		entry.rot[0] = rot.x(); entry.rot[1] = rot.y(); entry.rot[2] = rot.z(); entry.rot[3] = rot.w();
+
+		entry.flags &= ~(ROOT_KEY | ROOT);
+		if(p == vehicle->root)
+		{
+			entry.flags |= ROOT_KEY | ROOT;
+		}
+
+		if(p->attached_to == nullptr)
+		{
+			entry.flags &= ~HAS_LINK;
+		}
+		else
+		{
+			entry.flags |= HAS_LINK | WELDED_KEY;
+			entry.flags &= ~WELDED;
+			entry.flags |= p->welded ? WELDED : 0;
+			entry.link_to = p->attached_to->id;
+		}
+
+		out.pieces.push_back(entry);
+		out.piece_extra.push_back(blueprint.piece_extra[it->second]);
+		out.link_extra.push_back(blueprint.link_extra[it->second]);
+	}
+
+	for(size_t i = 0; i < blueprint.wires.size(); i++)
+	{
+		const WireEntry& wire = blueprint.wires[i];
+		if(parts_in.count(wire.from) != 0 && parts_in.count(wire.to) != 0)
+		{
+			out.wires.push_back(wire);
+			out.wire_extra.push_back(blueprint.wire_extra[i]);
+		}
+	}
+
+	return out;
+}
+
+std::shared_ptr<cpptoml::table> VehicleSnapshot::get_link_toml(size_t piece) const
+{
+	const PieceEntry& entry = pieces[piece];
+	if(!(entry.flags & HAS_LINK))
+	{
+		return nullptr;
+	}
+
+	auto link = clone_table(*link_extra[piece]);
+	link->insert("to", entry.link_to);
+
+	if(entry.flags & WELDED_KEY)
+	{
+		link->insert("welded", (entry.flags & WELDED) != 0);
+	}
+
+	if(entry.from_attachment != NO_STRING)
+	{
+		link->insert("from_attachment", get_string(entry.from_attachment));
+	}
+
+	if(entry.to_attachment != NO_STRING)
+	{
+		link->insert("to_attachment", get_string(entry.to_attachment));
+	}
+
+	if(entry.link_type != NO_STRING)
+	{
+		link->insert("type", get_string(entry.link_type));
+	}
+
+	if(entry.flags & HAS_LINK_FROM)
+	{
+		link->insert("pfrom", make_vec(entry.link_from_pos, 3));
+	}
+
+	if(entry.flags & HAS_LINK_TO)
+	{
+		link->insert("pto", make_vec(entry.link_to_pos, 3));
+	}
+
+	if(entry.flags & HAS_LINK_ROT)
+	{
+		link->insert("rot", make_vec(entry.link_rot, 4));
+	}
+
+	return link;
+}
+
+std::shared_ptr<cpptoml::table> VehicleSnapshot::to_toml() const
+{
+	auto root = clone_table(*root_extra);
+	root->insert("part_id", part_id);
+	root->insert("piece_id", piece_id);
+
+	auto toml_parts = cpptoml::make_table_array();
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		auto part = clone_table(*part_extra[i]);
+		part->insert("id", parts[i].id);
+		part->insert("proto", get_string(parts[i].proto));
+		toml_parts->push_back(part);
+	}
+	root->insert("part", toml_parts);
+
+	auto toml_pieces = cpptoml::make_table_array();
+	for(size_t i = 0; i < pieces.size(); i++)
+	{
+		const PieceEntry& entry = pieces[i];
+		auto piece = clone_table(*piece_extra[i]);
+		piece->insert("id", entry.id);
+		piece->insert("part", entry.part);
+		piece->insert("node", get_string(entry.node));
+		piece->insert("pos", make_vec(entry.pos, 3));
+		piece->insert("rot", make_vec(entry.rot, 4));
+
+		if(entry.flags & ROOT_KEY)
+		{
+			piece->insert("root", (entry.flags & ROOT) != 0);
+		}
+
+		auto link = get_link_toml(i);
+		if(link)
+		{
+			piece->insert("link", link);
+		}
+
+		toml_pieces->push_back(piece);
+	}
+	root->insert("piece", toml_pieces);
+
+	if(!wires.empty())
+	{
+		auto toml_wires = cpptoml::make_table_array();
+		for(size_t i = 0; i < wires.size(); i++)
+		{
+			const WireEntry& entry = wires[i];
+			auto wire = clone_table(*wire_extra[i]);
+			wire->insert("from", entry.from);
+			wire->insert("to", entry.to);
+			wire->insert("fmachine", get_string(entry.fmachine));
+			wire->insert("fport", get_string(entry.fport));
+			wire->insert("tmachine", get_string(entry.tmachine));
+			wire->insert("tport", get_string(entry.tport));
+			toml_wires->push_back(wire);
+		}
+		root->insert("wire", toml_wires);
+	}
+
+	return root;
+}
+
+void VehicleSnapshot::write(BinaryWriter& writer) const
+{
+	writer.write(MAGIC);
+	writer.write(VERSION);
+	writer.write(part_id);
+	writer.write(piece_id);
+
+	writer.write((uint32_t)strings.size());
+	for(const std::string& str : strings)
+	{
+		writer.write_string(str);
+	}
+
+	writer.write_array(parts);
+	writer.write_array(pieces);
+	writer.write_array(wires);
+
+	BinaryUtil::write_toml(writer, *root_extra);
+	for(const auto& extra : part_extra) BinaryUtil::write_toml(writer, *extra);
+	for(const auto& extra : piece_extra) BinaryUtil::write_toml(writer, *extra);
+	for(const auto& extra : link_extra) BinaryUtil::write_toml(writer, *extra);
+	for(const auto& extra : wire_extra) BinaryUtil::write_toml(writer, *extra);
+}
+
+void VehicleSnapshot::read(BinaryReader& reader)
+{
+	logger->check(reader.read<uint32_t>() == MAGIC, "Not a vehicle snapshot");
+	uint32_t version = reader.read<uint32_t>();
+	logger->check(version == VERSION, "Unsupported vehicle snapshot version ({}, expected {})", version, VERSION);
+
+	part_id = reader.read<int64_t>();
+	piece_id = reader.read<int64_t>();
+
+	uint32_t string_count = reader.read<uint32_t>();
+	// Each string takes at least its length, so corrupt counts are caught before allocating
+	logger->check(string_count <= (reader.get_size() - reader.get_pos()) / sizeof(uint32_t), 
+		"Vehicle snapshot has too many strings ({})", string_count);
+	strings.resize(string_count);
+	for(uint32_t i = 0; i < string_count; i++)
+	{
+		strings[i] = reader.read_string();
+	}
+
+	reader.read_array(parts);
+	reader.read_array(pieces);
+	reader.read_array(wires);
+
+	root_extra = BinaryUtil::read_toml(reader);
+
+	auto read_extras = [&reader](std::vector<std::shared_ptr<cpptoml::table>>& out, size_t count)
+	{
+		out.resize(count);
+		for(size_t i = 0; i < count; i++)
+		{
+			out[i] = BinaryUtil::read_toml(reader);
+		}
+	};
+
+	read_extras(part_extra, parts.size());
+	read_extras(piece_extra, pieces.size());
+	read_extras(link_extra, pieces.size());
+	read_extras(wire_extra, wires.size());
+}
+
+void VehicleSnapshot::read_file(const std::string& path)
+{
+	MappedFile file;
+	logger->check(file.open(path), "Could not open vehicle snapshot '{}'", path);
+
+	BinaryReader reader = BinaryReader(file.get_data(), file.get_size());
+	read(reader);
+}
+
+void VehicleSnapshot::write_file(const std::string& path) const
+{
+	BinaryWriter writer;
+	write(writer);
+	BinaryUtil::write_file(writer.data, path);
+}
+
+bool VehicleSnapshot::is_snapshot_file(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	uint32_t magic = 0;
+	file.read((char*)&magic, sizeof(uint32_t));
+	return file.good() && magic == MAGIC;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <cpptoml.h>
+#include <util/BinaryUtil.h>
+
+class Vehicle;
+
+// Binary representation of a vehicle file, the same data as its TOML,
+// but laid out so it loads without any text parsing:
+//	- A header with the format version and counts
+//	- A string table: prototype paths, nodes, attachments, link types and
+//	  wire machines / ports are indices into it, so each one is only
+//	  stored (and resolved by VehicleLoader) once
+//	- Flat arrays of parts, pieces (with their transform and link) and wires
+//	- Whatever else the tables had (machine overrides, link parameters,
+//	  description...), as binary TOML (see BinaryUtil::write_toml)
+// Converting TOML -> snapshot -> TOML gives an equal table, except for integers
+// in transforms, which become doubles as the loader reads them.
+class VehicleSnapshot
+{
+public:
+
+	static constexpr uint32_t MAGIC = 0x5650534F; // "OSPV"
+	static constexpr uint32_t VERSION = 1;
+
+	static constexpr uint32_t NO_STRING = 0xFFFFFFFF;
+
+	enum PieceFlags : uint32_t
+	{
+		// The "root" key was present, and its value
+		ROOT_KEY = 1 << 0,
+		ROOT = 1 << 1,
+		HAS_LINK = 1 << 2,
+		// Optional keys of the link
+		WELDED_KEY = 1 << 3,
+		WELDED = 1 << 4,
+		HAS_LINK_FROM = 1 << 5,
+		HAS_LINK_TO = 1 << 6,
+		HAS_LINK_ROT = 1 << 7
+	};
+
+	struct PartEntry
+	{
+		int64_t id;
+		uint32_t proto;
+		uint32_t pad;
+	};
+
+	// Quaternions are x, y, z, w as in the TOML
+	struct PieceEntry
+	{
+		int64_t id;
+		int64_t part;
+		double pos[3];
+		double rot[4];
+
+		int64_t link_to;
+		double link_from_pos[3];
+		double link_to_pos[3];
+		double link_rot[4];
+
+		uint32_t node;
+		// These are NO_STRING if not present
+		uint32_t from_attachment;
+		uint32_t to_attachment;
+		uint32_t link_type;
+
+		uint32_t flags;
+		uint32_t pad;
+	};
+
+	struct WireEntry
+	{
+		int64_t from;
+		int64_t to;
+		uint32_t fmachine, fport;
+		uint32_t tmachine, tport;
+	};
+
+	int64_t part_id;
+	int64_t piece_id;
+
+	std::vector<std::string> strings;
+	std::vector<PartEntry> parts;
+	std::vector<PieceEntry> pieces;
+	std::vector<WireEntry> wires;
+
+	// Keys of the tables not covered above, never nullptr (but may be empty)
+	std::shared_ptr<cpptoml::table> root_extra;
+	// One per entry
+	std::vector<std::shared_ptr<cpptoml::table>> part_extra;
+	std::vector<std::shared_ptr<cpptoml::table>> piece_extra;
+	std::vector<std::shared_ptr<cpptoml::table>> link_extra;
+	std::vector<std::shared_ptr<cpptoml::table>> wire_extra;
+
+	const std::string& get_string(uint32_t idx) const;
+
+	void from_toml(const cpptoml::table& root);
+	std::shared_ptr<cpptoml::table> to_toml() const;
+
+	// The current state of a vehicle, taken from its blueprint (see Vehicle::blueprint)
+	// with only the parts and pieces it still has, their transforms relative to 
+	// the root piece (as they are now, even if unpacked), and their links and root
+	// as they are now. Wires are kept if both parts are still in the vehicle
+	static VehicleSnapshot from_vehicle(Vehicle* vehicle);
+
+	// The link table of a piece, as it was on the TOML
+	std::shared_ptr<cpptoml::table> get_link_toml(size_t piece) const;
+
+	void write(BinaryWriter& writer) const;
+	void read(BinaryReader& reader);
+
+	// Reads a file written with write, through a MappedFile
+	void read_file(const std::string& path);
+	void write_file(const std::string& path) const;
+
+	// Checks the magic of the file, to tell binary and TOML vehicles apart
+	static bool is_snapshot_file(const std::string& path);
+};
@@ -1,3 +1,23 @@
 #include "Link.h"
+#include "NativeLinks.h"
+#include <assets/AssetManager.h>
 
-
+std::unique_ptr<Link> Link::create(const std::string& type)
+{
+	if(type == "fixed")
+	{
+		return std::make_unique<FixedLink>();
+	}
+	else if(type == "hinge")
+	{
+		return std::make_unique<HingeLink>();
+	}
+	else if(type == "spring")
+	{
+		return std::make_unique<SpringLink>();
+	}
+	else
+	{
+		return std::make_unique<LuaLink>(assets->load_script(type));
+	}
+}
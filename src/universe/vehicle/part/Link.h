@@ -9,31 +9,95 @@
 #include "../../../util/LuaUtil.h"
 #include "../../../lua/libs/LuaBullet.h"
 #include <cpptoml.h>
+#include <memory>
 
 // Base class for any link, which can be as simple as
 // a bullet3 constraint, or as complex as a soft-body rope
+// Common links are implemented natively (see NativeLinks.h),
+// anything else can be implemented in lua (LuaLink)
 class Link
 {
+public:
+
+	// Called during loading of the link to give it its 
+	// toml serialized data
+	virtual void load_toml(std::shared_ptr<cpptoml::table> data) = 0;
+
+	// Called when the pieces are unwelded, or first created
+	virtual void activate(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame,
+		btDynamicsWorld* world
+	) = 0;
+
+	// Called when the pieces are welded
+	// Keep in mind special links may have to implement some custom
+	// functionality to keep the previous state if they are reactivated,
+	// for example, ropes or motors which must remember their last position
+	virtual void deactivate() = 0;
+
+	// Return true if the link has broken and should be deleted
+	// Called every frame on every active link!
+	virtual bool is_broken() = 0;
+
+	virtual void set_breaking_enabled(bool value) = 0;
+
+	// How the link is represented on multibody vehicles (see MultiBodyVehicle),
+	// where links are joints of the multibody instead of constraints.
+	// The axis of revolute and prismatic joints is the forward (Z) of the link
+	struct MultiBodyJoint
+	{
+		enum Type
+		{
+			FIXED,
+			REVOLUTE,
+			PRISMATIC
+		};
+
+		Type type = FIXED;
+		// Impulse (N*s) over a single step needed to break the joint, 
+		// 0 if it never breaks
+		double break_impulse = 0.0;
+
+		bool has_limits = false;
+		double lower = 0.0, upper = 0.0;
+
+		// Only for prismatic joints, it's kept at 0 with these
+		double stiffness = 0.0;
+		double damping = 0.0;
+	};
+
+	// Links without an equivalent become unbreakable fixed joints
+	virtual MultiBodyJoint get_multibody_joint() { return MultiBodyJoint(); }
+
+	// Creates a native link if type is the name of one ("fixed", "hinge", "spring"),
+	// otherwise type is the path to the script of a lua link
+	static std::unique_ptr<Link> create(const std::string& type);
+
+	virtual ~Link() = default;
+};
+
+// Link implemented by a lua script, which must implement the same
+// functions as Link (see res/core/links/simple_link.lua)
+class LuaLink : public Link
+{
 public:
 
 	bool is_initialized;
 	sol::state lua_state;
 
-	// Called during loading of the link to give it its 
-	// toml serialized data
-	void load_toml(std::shared_ptr<cpptoml::table> data)
+	void load_toml(std::shared_ptr<cpptoml::table> data) override
 	{
 		LuaUtil::safe_call_function(lua_state,
 				"load_toml", "link load_toml", 
 				data);
 	}
 
-	// Called when the pieces are unwelded, or first created
 	void activate(
 		btRigidBody* from, btTransform from_frame,
 		btRigidBody* to, btTransform to_frame,
 		btDynamicsWorld* world
-	)
+	) override
 	{
 		is_initialized = true;
 
@@ -42,11 +106,7 @@ public:
 				from, BulletTransform(from_frame), to, BulletTransform(to_frame), world);
 	}
 
-	// Called when the pieces are welded
-	// Keep in mind special links may have to implement some custom
-	// functionality to keep the previous state if they are reactivated,
-	// for example, ropes or motors which must remember their last position
-	void deactivate()
+	void deactivate() override
 	{
 		is_initialized = false;
 
@@ -54,8 +114,7 @@ public:
 				"deactivate", "link deactivate");
 	}
 
-	// Return true if the link has broken and should be deleted
-	bool is_broken()
+	bool is_broken() override
 	{
 		if(!is_initialized)
 		{
@@ -68,17 +127,16 @@ public:
 		}
 	}
 
-	void set_breaking_enabled(bool value)
+	void set_breaking_enabled(bool value) override
 	{
 		LuaUtil::safe_call_function(lua_state,
 				"set_breaking_enabled", "link set_breaking_enabled",
 				value);
 	}
 
-	Link(sol::state&& st)
+	LuaLink(sol::state&& st)
 	{
 		this->lua_state = std::move(st);
 		is_initialized = false;
 	}
 };
-
@@ -4,6 +4,7 @@
 #include <universe/Universe.h>
 #include <util/LuaUtil.h>
 #include <lua/LuaCore.h>
+#include <lua/SharedLuaState.h>
 
 #include "../wire/Port.h"
 
@@ -37,9 +38,24 @@ private:
 
 	std::vector<PortDefinition> new_ports;
 
+	// Only created if the machine doesn't run in a shared state
+	std::unique_ptr<sol::state> own_state;
+	std::shared_ptr<SharedLuaState> shared_state;
+
+	// Per-frame hooks, resolved once after the script is loaded (and after
+	// init), invalid if the script doesn't define them
+	sol::safe_function pre_update_fnc;
+	sol::safe_function update_fnc;
+	sol::safe_function editor_update_fnc;
+
+	void resolve_hooks();
+	void call_hook(sol::safe_function& fnc, const char* context, double dt);
+
 public:
 
-	sol::state lua_state;
+	// Globals of the machine's script, the globals of its own state,
+	// or its environment in the shared state
+	sol::table env;
 
 	std::shared_ptr<cpptoml::table> init_toml;
 
@@ -55,9 +71,17 @@ public:
 
 	void init(Part* in_part, Universe* in_universe);
 
+	// Adds to the lua call counter of the vehicle, if we are in one
+	void count_lua_call();
+
+	sol::state_view get_lua_state();
+	bool is_shared() { return shared_state != nullptr; }
+
 	// Make sure AssetManager's correct current package is set,
 	// otherwise script loading MAY fail!
-	Machine(std::shared_ptr<cpptoml::table> init_toml, std::string pkg);
+	// If shared is given, the script runs in its own environment in it
+	Machine(std::shared_ptr<cpptoml::table> init_toml, std::string pkg, 
+		std::shared_ptr<SharedLuaState> shared = nullptr);
 	~Machine();
 
 	// Will only invalidate the wires that need to be invalidated
@@ -76,5 +100,8 @@ public:
 
 	PortResult write_to_port(const std::string& name, PortValue val);
 
+	// Gives the values written to our input ports to their callbacks
+	void deliver_inputs();
+
 };
 
@@ -0,0 +1,201 @@
+#include "NativeLinks.h"
+#include <util/SerializeUtil.h>
+
+void ConstraintLink::update_threshold()
+{
+	if(constraint == nullptr)
+	{
+		return;
+	}
+
+	if(breaking_enabled && break_impulse > 0.0)
+	{
+		constraint->setBreakingImpulseThreshold(break_impulse);
+	}
+	else
+	{
+		constraint->setBreakingImpulseThreshold(SIMD_INFINITY);
+	}
+}
+
+void ConstraintLink::load_toml(std::shared_ptr<cpptoml::table> data)
+{
+	if(!data)
+	{
+		return;
+	}
+
+	cpptoml::table& from = *data;
+	SAFE_TOML_GET_OR(break_impulse, "break_impulse", double, 0.0);
+	load_params(from);
+}
+
+void ConstraintLink::activate(
+	btRigidBody* from, btTransform from_frame,
+	btRigidBody* to, btTransform to_frame,
+	btDynamicsWorld* world)
+{
+	if(constraint != nullptr)
+	{
+		return;
+	}
+
+	this->world = world;
+
+	// Keep the position given for the to frame, but rotate it so both frames 
+	// currently match
+	btTransform rel = to->getWorldTransform().inverse() * from->getWorldTransform() * from_frame;
+	to_frame.setBasis(rel.getBasis());
+
+	constraint = create_constraint(from, from_frame, to, to_frame);
+	update_threshold();
+
+	// Linked pieces don't collide with each other
+	world->addConstraint(constraint, true);
+}
+
+void ConstraintLink::deactivate()
+{
+	if(constraint == nullptr)
+	{
+		return;
+	}
+
+	world->removeConstraint(constraint);
+	delete constraint;
+	constraint = nullptr;
+	world = nullptr;
+}
+
+bool ConstraintLink::is_broken()
+{
+	return constraint != nullptr && !constraint->isEnabled();
+}
+
+void ConstraintLink::set_breaking_enabled(bool value)
+{
+	breaking_enabled = value;
+	update_threshold();
+}
+
+Link::MultiBodyJoint ConstraintLink::get_multibody_joint()
+{
+	MultiBodyJoint joint;
+	joint.type = MultiBodyJoint::FIXED;
+	joint.break_impulse = break_impulse;
+	return joint;
+}
+
+ConstraintLink::ConstraintLink()
+{
+	constraint = nullptr;
+	world = nullptr;
+	break_impulse = 0.0;
+	breaking_enabled = true;
+}
+
+ConstraintLink::~ConstraintLink()
+{
+	deactivate();
+}
+
+btTypedConstraint* FixedLink::create_constraint(
+	btRigidBody* from, btTransform from_frame,
+	btRigidBody* to, btTransform to_frame)
+{
+	return new btFixedConstraint(*from, *to, from_frame, to_frame);
+}
+
+btTypedConstraint* HingeLink::create_constraint(
+	btRigidBody* from, btTransform from_frame,
+	btRigidBody* to, btTransform to_frame)
+{
+	btHingeConstraint* hinge = new btHingeConstraint(*from, *to, from_frame, to_frame);
+	if(has_limits)
+	{
+		hinge->setLimit(lower, upper);
+	}
+
+	return hinge;
+}
+
+void HingeLink::load_params(cpptoml::table& from)
+{
+	auto l = from.get_qualified_as<double>("lower");
+	auto u = from.get_qualified_as<double>("upper");
+
+	has_limits = l && u;
+	if(has_limits)
+	{
+		lower = *l;
+		upper = *u;
+	}
+}
+
+Link::MultiBodyJoint HingeLink::get_multibody_joint()
+{
+	MultiBodyJoint joint = ConstraintLink::get_multibody_joint();
+	joint.type = MultiBodyJoint::REVOLUTE;
+	joint.has_limits = has_limits;
+	joint.lower = lower;
+	joint.upper = upper;
+	return joint;
+}
+
+HingeLink::HingeLink()
+{
+	has_limits = false;
+	lower = 0.0;
+	upper = 0.0;
+}
+
+btTypedConstraint* SpringLink::create_constraint(
+	btRigidBody* from, btTransform from_frame,
+	btRigidBody* to, btTransform to_frame)
+{
+	btGeneric6DofSpringConstraint* spring = 
+		new btGeneric6DofSpringConstraint(*from, *to, from_frame, to_frame, true);
+
+	spring->setLinearLowerLimit(btVector3(-travel, -travel, -travel));
+	spring->setLinearUpperLimit(btVector3(travel, travel, travel));
+	spring->setAngularLowerLimit(btVector3(0.0, 0.0, 0.0));
+	spring->setAngularUpperLimit(btVector3(0.0, 0.0, 0.0));
+
+	for(int i = 0; i < 3; i++)
+	{
+		spring->enableSpring(i, true);
+		spring->setStiffness(i, stiffness);
+		spring->setDamping(i, damping);
+	}
+
+	// Rest at the current position
+	spring->setEquilibriumPoint();
+
+	return spring;
+}
+
+void SpringLink::load_params(cpptoml::table& from)
+{
+	SAFE_TOML_GET_OR(stiffness, "stiffness", double, 1e6);
+	SAFE_TOML_GET_OR(damping, "damping", double, 0.5);
+	SAFE_TOML_GET_OR(travel, "travel", double, 0.05);
+}
+
+Link::MultiBodyJoint SpringLink::get_multibody_joint()
+{
+	MultiBodyJoint joint = ConstraintLink::get_multibody_joint();
+	joint.type = MultiBodyJoint::PRISMATIC;
+	joint.has_limits = true;
+	joint.lower = -travel;
+	joint.upper = travel;
+	joint.stiffness = stiffness;
+	joint.damping = damping;
+	return joint;
+}
+
+SpringLink::SpringLink()
+{
+	stiffness = 1e6;
+	damping = 0.5;
+	travel = 0.05;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "Link.h"
+
+// Links implemented directly on a bullet constraint, so ordinary vehicles
+// don't need to go through lua every frame to check their joints.
+//
+// They break when bullet disables the constraint, which happens when the
+// impulse applied by it on a single step goes over break_impulse.
+// Common toml values (in [piece.link]):
+//	break_impulse: Impulse (N*s) needed to break the link, if not given
+//		the link never breaks
+//
+// The rotation of the frame on the "to" piece is taken from the current
+// relative position of both pieces, so links don't snap when activated.
+class ConstraintLink : public Link
+{
+protected:
+
+	btTypedConstraint* constraint;
+	btDynamicsWorld* world;
+
+	double break_impulse;
+	bool breaking_enabled;
+
+	virtual btTypedConstraint* create_constraint(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame) = 0;
+
+	// Loads the values specific to each link type
+	virtual void load_params(cpptoml::table& from) {}
+
+	void update_threshold();
+
+public:
+
+	void load_toml(std::shared_ptr<cpptoml::table> data) override;
+
+	void activate(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame,
+		btDynamicsWorld* world
+	) override;
+
+	void deactivate() override;
+	bool is_broken() override;
+	void set_breaking_enabled(bool value) override;
+	MultiBodyJoint get_multibody_joint() override;
+
+	ConstraintLink();
+	~ConstraintLink() override;
+};
+
+// Rigid link, no movement allowed
+class FixedLink : public ConstraintLink
+{
+protected:
+
+	btTypedConstraint* create_constraint(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame) override;
+};
+
+// Rotates around the forward (Z) axis of the link
+// toml values:
+//	lower, upper: Angle limits in radians, free rotation if not given
+class HingeLink : public ConstraintLink
+{
+protected:
+
+	bool has_limits;
+	double lower, upper;
+
+	btTypedConstraint* create_constraint(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame) override;
+
+	void load_params(cpptoml::table& from) override;
+
+public:
+
+	MultiBodyJoint get_multibody_joint() override;
+
+	HingeLink();
+};
+
+// Springy joint which allows some linear movement, rotation is locked
+// toml values:
+//	stiffness: Spring stiffness (N/m), default 1e6
+//	damping: Bullet spring damping, 1 means no damping, default 0.5
+//	travel: Maximum displacement in each axis (m), default 0.05
+class SpringLink : public ConstraintLink
+{
+protected:
+
+	double stiffness;
+	double damping;
+	double travel;
+
+	btTypedConstraint* create_constraint(
+		btRigidBody* from, btTransform from_frame,
+		btRigidBody* to, btTransform to_frame) override;
+
+	void load_params(cpptoml::table& from) override;
+
+public:
+
+	// On multibodies the spring only moves along the forward axis
+	MultiBodyJoint get_multibody_joint() override;
+
+	SpringLink();
+};
@@ -1,9 +1,11 @@
 #include "Part.h"
 #include <string>
 
-Part::Part(AssetHandle<PartPrototype>& part_proto, cpptoml::table& our_table)
+Part::Part(AssetHandle<PartPrototype>& part_proto, cpptoml::table& our_table,
+	std::unordered_map<std::string, std::shared_ptr<SharedLuaState>>* shared_states)
 {
 	this->part_proto = part_proto.duplicate();
+	this->vehicle = nullptr;
 
 	// Load machines
 	for(auto machine_toml : part_proto->machines)
@@ -20,7 +22,19 @@ Part::Part(AssetHandle<PartPrototype>& part_proto, cpptoml::table& our_table)
 
 		std::string cur_pkg = part_proto.pkg;
 
-		Machine* n_machine = new Machine(config_toml, cur_pkg);
+		std::shared_ptr<SharedLuaState> shared = nullptr;
+		if(shared_states)
+		{
+			auto it = shared_states->find(cur_pkg);
+			if(it == shared_states->end())
+			{
+				it = shared_states->insert(std::make_pair(cur_pkg, std::make_shared<SharedLuaState>(cur_pkg))).first;
+			}
+
+			shared = it->second;
+		}
+
+		Machine* n_machine = new Machine(config_toml, cur_pkg, shared);
 		machines[id] = n_machine;
 	}
 }
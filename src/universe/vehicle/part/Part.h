@@ -36,7 +36,10 @@ public:
 
 	// We duplicate the asset handle
 	// our_table must contain any extra arguments to machines
-	Part(AssetHandle<PartPrototype>& part_proto, cpptoml::table& our_table);
+	// If shared_states is given, machines run in the shared state of their
+	// package, which is created if not present
+	Part(AssetHandle<PartPrototype>& part_proto, cpptoml::table& our_table,
+		std::unordered_map<std::string, std::shared_ptr<SharedLuaState>>* shared_states = nullptr);
 	~Part();
 };
 
@@ -1,5 +1,7 @@
 #include "Piece.h"
 #include "../Vehicle.h"
+#include "../MultiBodyVehicle.h"
+#include "../VehicleCommandBuffer.h"
 #include <util/Logger.h>
 
 glm::dmat4 Piece::get_graphics_matrix()
@@ -14,11 +16,23 @@ bool Piece::is_welded()
 
 btTransform Piece::get_graphics_transform()
 {
+	size_t idx = in_vehicle->piece_cache.find(this);
+	if(idx != PieceStateCache::NONE)
+	{
+		return in_vehicle->piece_cache.graphics_transforms[idx];
+	}
+
 	return get_global_transform_internal(true);
 }
 
 btTransform Piece::get_global_transform()
 {
+	size_t idx = in_vehicle->piece_cache.find(this);
+	if(idx != PieceStateCache::NONE)
+	{
+		return in_vehicle->piece_cache.transforms[idx];
+	}
+
 	return get_global_transform_internal(false);
 }
 
@@ -28,6 +42,10 @@ btTransform Piece::get_global_transform_internal(bool use_mstate)
 	{
 		return in_vehicle->packed_veh.get_root_transform() * packed_tform;
 	}
+	else if (in_multibody != nullptr)
+	{
+		return in_multibody->get_transform(multibody_body) * welded_tform;
+	}
 	else 
 	{
 		btTransform tform;
@@ -54,7 +72,7 @@ btTransform Piece::get_global_transform_internal(bool use_mstate)
 
 btTransform Piece::get_local_transform()
 {
-	if (is_welded())
+	if (is_welded() || in_multibody != nullptr)
 	{
 		return welded_tform;
 	}
@@ -67,6 +85,12 @@ btTransform Piece::get_local_transform()
 
 btVector3 Piece::get_linear_velocity(bool ignore_tangential)
 {
+	size_t idx = in_vehicle->piece_cache.find(this);
+	if(idx != PieceStateCache::NONE && !ignore_tangential)
+	{
+		return in_vehicle->piece_cache.linear_velocities[idx];
+	}
+
 	if(in_vehicle->is_packed())
 	{
 		btVector3 base = to_btVector3(in_vehicle->packed_veh.get_root_state().cartesian.vel);
@@ -75,6 +99,16 @@ btVector3 Piece::get_linear_velocity(bool ignore_tangential)
 
 		return base;
 	}
+	else if (in_multibody != nullptr)
+	{
+		btVector3 base = in_multibody->get_linear_velocity(multibody_body);
+		if (!ignore_tangential)
+		{
+			base += get_tangential_velocity();
+		}
+
+		return base;
+	}
 	else
 	{
 		btVector3 base = rigid_body->getLinearVelocity();
@@ -89,10 +123,20 @@ btVector3 Piece::get_linear_velocity(bool ignore_tangential)
 
 btVector3 Piece::get_angular_velocity()
 {
+	size_t idx = in_vehicle->piece_cache.find(this);
+	if(idx != PieceStateCache::NONE)
+	{
+		return in_vehicle->piece_cache.angular_velocities[idx];
+	}
+
 	if(in_vehicle->is_packed())
 	{
 		return to_btVector3(in_vehicle->packed_veh.get_root_state().angular_velocity);
 	}
+	else if (in_multibody != nullptr)
+	{
+		return in_multibody->get_angular_velocity(multibody_body);
+	}
 	else 
 	{
 		return rigid_body->getAngularVelocity();
@@ -114,13 +158,13 @@ btVector3 Piece::get_tangential_velocity()
 	else 
 	{
 
-		if (!is_welded())
+		if (!is_welded() && in_multibody == nullptr)
 		{
 			return btVector3(0.0, 0.0, 0.0);
 		}
 
 		btVector3 r = get_relative_position();
-		btVector3 tangential = rigid_body->getAngularVelocity().cross(r);
+		btVector3 tangential = get_angular_velocity().cross(r);
 	
 		return tangential;
 	}
@@ -130,10 +174,10 @@ btVector3 Piece::get_relative_position()
 {
 	// TODO: Check this stuff
 	//return get_local_transform().getOrigin();
-	if(is_welded())
+	if(is_welded() || in_multibody != nullptr)
 	{
 		// Not get_global_transform() as that already includes get_local_transform()
-		btTransform global = rigid_body->getWorldTransform();
+		btTransform global = in_multibody ? in_multibody->get_transform(multibody_body) : rigid_body->getWorldTransform();
 		btTransform local = get_local_transform();
 		btTransform mul = global * local; //< This is final position
 
@@ -214,11 +258,33 @@ glm::dvec3 Piece::get_marker_forward(const std::string & marker_name)
 glm::dvec3 Piece::transform_point_to_rigidbody(glm::dvec3 p)
 {
 	glm::dvec3 f = glm::dvec3(to_dmat4(get_global_transform()) * glm::dvec4(p, 1.0));
-	f -= to_dvec3(rigid_body->getCenterOfMassPosition());
+	if(in_multibody != nullptr)
+	{
+		f -= to_dvec3(in_multibody->get_transform(multibody_body).getOrigin());
+	}
+	else
+	{
+		f -= to_dvec3(rigid_body->getCenterOfMassPosition());
+	}
 	
 	return f;
 }
 
+void Piece::apply_force(glm::dvec3 force, glm::dvec3 rel_pos)
+{
+	if(in_multibody != nullptr)
+	{
+		// Only touches the multibody's force accumulators, so it's safe 
+		// while vehicles update in parallel
+		in_multibody->apply_force(multibody_body, to_btVector3(force), to_btVector3(rel_pos));
+	}
+	else if(rigid_body != nullptr)
+	{
+		VehicleCommandBuffer::run(VehicleCommandBuffer::APPLY_FORCE, rigid_body, 
+			to_btVector3(force), to_btVector3(rel_pos));
+	}
+}
+
 Piece::Piece(Part* in_part, std::string piece_name)
 	: model_node(in_part->part_proto->pieces[piece_name].model_node.duplicate())
 {
@@ -227,6 +293,9 @@ Piece::Piece(Part* in_part, std::string piece_name)
 	collider = nullptr;
 	rigid_body = nullptr;
 	motion_state = nullptr;
+	in_multibody = nullptr;
+	multibody_body = -1;
+	cache_index = 0;
 	in_group = nullptr;
 	welded = false;
 
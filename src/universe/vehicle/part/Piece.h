@@ -16,6 +16,7 @@
 class Part;
 class Piece;
 class Vehicle;
+class MultiBodyVehicle;
 
 struct WeldedGroup
 {
@@ -82,9 +83,17 @@ public:
 	btRigidBody* rigid_body;
 	btMotionState* motion_state;
 
+	// Only on multibody vehicles, instead of the rigidbody (which is nullptr),
+	// the multibody and the index of the body we are in (see MultiBodyVehicle)
+	MultiBodyVehicle* in_multibody;
+	int multibody_body;
+
+	// Our entry in the piece cache of the vehicle (see PieceStateCache)
+	size_t cache_index;
+
 	// Used as an offset for rendering, the adjusted
 	// position of this collider in the welded shared
-	// collider
+	// collider (or the body, on multibodies)
 	btTransform welded_tform;
 
 	// Collider offset relative to the piece node, used for rendering
@@ -170,6 +179,10 @@ public:
 	// Useful for applying forces
 	glm::dvec3 transform_point_to_rigidbody(glm::dvec3 p);
 
+	// Applies a force (global coordinates) on a point given by transform_point_to_rigidbody,
+	// works both on rigidbodies and multibodies
+	void apply_force(glm::dvec3 force, glm::dvec3 rel_pos);
+
 	Piece(Part* in_part, std::string piece_name);
 	~Piece();
 
@@ -7,7 +7,8 @@
 #include "sol.hpp"
 
 
-Machine::Machine(std::shared_ptr<cpptoml::table> init_toml, std::string cur_pkg)
+Machine::Machine(std::shared_ptr<cpptoml::table> init_toml, std::string cur_pkg, 
+	std::shared_ptr<SharedLuaState> shared)
 {	
 	this->init_toml = init_toml;
 	logger->check(init_toml != nullptr, "Malformed init_toml");
@@ -16,48 +17,125 @@ Machine::Machine(std::shared_ptr<cpptoml::table> init_toml, std::string cur_pkg)
 	std::string script_path;
 	SAFE_TOML_GET_FROM(init_toml_p, script_path, "script", std::string);
 
-	lua_state["machine"] = this;
-
 	std::string old = assets->get_current_package();
 	assets->set_current_package(cur_pkg);
-	assets->load_script_to(lua_state, script_path);
+
+	shared_state = shared;
+	if(shared_state)
+	{
+		logger->check(shared_state->pkg == cur_pkg, "Machine shared lua state is from another package");
+
+		sol::environment n_env = shared_state->create_environment();
+		n_env["machine"] = this;
+		assets->load_script_to(shared_state->lua_state, n_env, script_path);
+		env = n_env;
+	}
+	else
+	{
+		own_state = std::make_unique<sol::state>();
+		(*own_state)["machine"] = this;
+		assets->load_script_to(*own_state, script_path);
+		env = own_state->globals();
+	}
+
 	assets->set_current_package(old);
 
+	in_part = nullptr;
+	resolve_hooks();
+}
+
+sol::state_view Machine::get_lua_state()
+{
+	if(shared_state)
+	{
+		return sol::state_view(shared_state->lua_state);
+	}
+	else
+	{
+		return sol::state_view(*own_state);
+	}
+}
+
+static sol::safe_function get_hook(sol::table& env, const char* name)
+{
+	sol::object obj = env[name];
+	if(obj.get_type() == sol::type::function)
+	{
+		return obj.as<sol::safe_function>();
+	}
+	else
+	{
+		return sol::safe_function();
+	}
+}
+
+void Machine::resolve_hooks()
+{
+	pre_update_fnc = get_hook(env, "pre_update");
+	update_fnc = get_hook(env, "update");
+	editor_update_fnc = get_hook(env, "editor_update");
+}
+
+void Machine::call_hook(sol::safe_function& fnc, const char* context, double dt)
+{
+	if(!fnc.valid())
+	{
+		return;
+	}
+
+	count_lua_call();
+
+	auto result = fnc(dt);
+	if(!result.valid())
+	{
+		sol::error as_error = result;
+		logger->error("Lua Error in {}:\n{}", context, as_error.what());
+	}
+}
+
+void Machine::count_lua_call()
+{
+	if(in_part != nullptr && in_part->vehicle != nullptr)
+	{
+		in_part->vehicle->lua_calls++;
+	}
 }
 
 void Machine::pre_update(double dt)
 {
-	LuaUtil::call_function_if_present(lua_state, "pre_update", "machine pre_update", dt);
+	call_hook(pre_update_fnc, "machine pre_update", dt);
 }
 
 void Machine::update(double dt)
 {
-	LuaUtil::call_function_if_present(lua_state, "update", "machine update", dt);
+	call_hook(update_fnc, "machine update", dt);
 }
 
 void Machine::editor_update(double dt)
 {
-	LuaUtil::call_function_if_present(lua_state, "editor_update", "machine editor_update", dt);
+	call_hook(editor_update_fnc, "machine editor_update", dt);
 }
 
 
 void Machine::init(Part* in_part, Universe* in_universe)
 {
-	lua_state["part"] = in_part;
-	lua_state["universe"] = in_universe;
-	lua_state["vehicle"] = in_part->vehicle;
+	env["part"] = in_part;
+	env["universe"] = in_universe;
+	env["vehicle"] = in_part->vehicle;
 
 	this->in_part = in_part;
 
-	LuaUtil::call_function_if_present(lua_state, "init", "machine init");
-	
+	LuaUtil::call_function_if_present(env, "init", "machine init");
+
+	// init may define new hooks
+	resolve_hooks();
 }
 
 void Machine::define_ports()
 {
 	is_defining_ports = true;
 
-	LuaUtil::call_function(lua_state, "define_ports", "machine define_ports");
+	LuaUtil::call_function(env, "define_ports", "machine define_ports");
 
 	while(new_ports.size() > 0)
 	{
@@ -104,6 +182,7 @@ void Machine::define_ports()
 					}
 				}
 
+				in_vehicle->wires_dirty = true;
 				delete port;	
 				found = true;
 				same_type = port->type == PortValue::get_type(port_def.type);
@@ -140,6 +219,7 @@ void Machine::define_ports()
 			port_new->in_machine = this;
 			port_new->is_output = port_def.output;
 			port_new->name = port_def.name;
+			port_new->type = PortValue::get_type(port_def.type);
 			port_new->callback = port_def.callback;
 
 			if (port_new->is_output)
@@ -148,6 +228,7 @@ void Machine::define_ports()
 			}
 
 			in_part->vehicle->all_ports.push_back(port_new);
+			in_part->vehicle->wires_dirty = true;
 			ports.push_back(port_new);
 		}
 
@@ -236,7 +317,8 @@ PortResult Machine::write_to_port(const std::string& name, PortValue val)
 		return out;
 	}
 
-	// Write the value and block the port
+	// Write the value and block the port, the receiving machines
+	// get it before their update (see WireGraph)
 	for (Port* o : it->second->to)
 	{
 		o->receive(val);
@@ -248,6 +330,17 @@ PortResult Machine::write_to_port(const std::string& name, PortValue val)
 	return out;
 }
 
+void Machine::deliver_inputs()
+{
+	for(Port* port : ports)
+	{
+		if(!port->is_output)
+		{
+			port->deliver();
+		}
+	}
+}
+
 bool Machine::all_inputs_ready()
 {
 	for(size_t i = 0; i < ports.size(); i++)
@@ -268,11 +361,22 @@ bool Machine::all_inputs_ready()
 Machine::~Machine()
 {
 	logger->info("Ending machine");
-	lua_state.collect_garbage();
 
-	// Delete all ports
+	// Release our references before the state may go away
+	pre_update_fnc = sol::safe_function();
+	update_fnc = sol::safe_function();
+	editor_update_fnc = sol::safe_function();
+	env = sol::table();
+	if(own_state)
+	{
+		own_state->collect_garbage();
+	}
+
+	// Delete all ports, unwiring them first so ports of other
+	// machines (maybe on another vehicle) don't keep pointers to them
 	for(Port* port : ports)
 	{
+		port->disconnect_all();
 		delete port;
 	}
 }
@@ -1,6 +1,6 @@
 #include "Port.h"
-
-#include "Port.h"
+#include "../part/Machine.h"
+#include <algorithm>
 
 std::string PortValue::get_name(PortValue::Type type)
 {
@@ -32,7 +32,16 @@ void PortValue::call_lua(sol::safe_function& func, Port* port)
 {
 	if (type == NUMBER)
 	{
-		func(port->name, as_number);
+		sol::safe_function_result result = func(port->name, as_number);
+		if (!result.valid())
+		{
+			sol::error as_error = result;
+			logger->error("Lua Error in port '{}' callback:\n{}", port->name, as_error.what());
+		}
+	}
+	else
+	{
+		logger->error("Port '{}' has a value of unknown type", port->name);
 	}
 }
 
@@ -50,5 +59,57 @@ void Port::receive(PortValue& val)
 	// This should really never happen
 	logger->check(!is_output, "Received on an output port");
 
-	val.call_lua(callback, this);
+	// Only the last write of a frame reaches lua
+	value = val.as_number;
+	has_value = true;
+}
+
+void Port::deliver()
+{
+	if (!has_value)
+	{
+		return;
+	}
+
+	has_value = false;
+
+	// Resolved when the port was defined, ports without callback skip lua entirely
+	if (callback.valid())
+	{
+		in_machine->count_lua_call();
+		PortValue val = PortValue(value);
+		val.call_lua(callback, this);
+	}
+}
+
+void Port::connect(Port* target)
+{
+	to.push_back(target);
+	target->from.push_back(this);
+}
+
+void Port::disconnect(Port* other)
+{
+	Port* output = is_output ? this : other;
+	Port* input = is_output ? other : this;
+
+	output->to.erase(std::remove(output->to.begin(), output->to.end(), input), output->to.end());
+	input->from.erase(std::remove(input->from.begin(), input->from.end(), output), input->from.end());
+}
+
+void Port::disconnect_all()
+{
+	// disconnect modifies the arrays
+	std::vector<Port*> others = is_output ? to : from;
+	for(Port* other : others)
+	{
+		disconnect(other);
+	}
+}
+
+Port::Port()
+{
+	blocked = false;
+	value = 0.0;
+	has_value = false;
 }
@@ -69,12 +69,32 @@ public:
 
 	// Only on input ports
 	sol::safe_function callback;
+	// Only on input ports, last value written this frame, waiting
+	// to be delivered to the callback (see WireGraph)
+	double value;
+	bool has_value;
 
 	// Only on output ports
 	std::vector<Port*> to;
+	// Only on input ports, the output ports wired to us, so
+	// wires can be removed from either end
+	std::vector<Port*> from;
 
 	PortValue::Type type;
 	Machine* in_machine;
 
+	// Buffers the value, it's given to lua on deliver
 	void receive(PortValue& val);
+	// Calls the callback with the buffered value, if any
+	void deliver();
+
+	// Called on the output port
+	void connect(Port* target);
+	// Removes the wire between the two ports, called on either end
+	void disconnect(Port* other);
+	// Removes every wire to or from this port, so no port is left
+	// pointing to us (ports are deleted with their machine)
+	void disconnect_all();
+
+	Port();
 };
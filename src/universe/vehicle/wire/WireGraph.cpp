@@ -0,0 +1,119 @@
+#include "WireGraph.h"
+#include "Port.h"
+#include "../part/Part.h"
+#include <unordered_map>
+
+void WireGraph::build(const std::vector<Part*>& parts, const std::vector<Port*>& all_ports)
+{
+	built_parts = parts;
+	order.clear();
+
+	std::unordered_map<Machine*, size_t> machine_index;
+	std::vector<Machine*> machines;
+	for(Part* part : parts)
+	{
+		for(auto& pair : part->machines)
+		{
+			machine_index[pair.second] = machines.size();
+			machines.push_back(pair.second);
+		}
+	}
+
+	size_t count = machines.size();
+
+	// Edges between machines, in compressed form (the targets of machine i
+	// are edge_targets[edge_start[i]] to edge_targets[edge_start[i + 1]])
+	std::vector<std::pair<size_t, size_t>> edges;
+	for(Port* port : all_ports)
+	{
+		if(!port->is_output)
+		{
+			continue;
+		}
+
+		auto from_it = machine_index.find(port->in_machine);
+		if(from_it == machine_index.end())
+		{
+			continue;
+		}
+
+		for(Port* target : port->to)
+		{
+			auto to_it = machine_index.find(target->in_machine);
+			if(to_it != machine_index.end())
+			{
+				edges.emplace_back(from_it->second, to_it->second);
+			}
+		}
+	}
+
+	std::vector<size_t> edge_start(count + 1, 0);
+	for(auto& edge : edges)
+	{
+		edge_start[edge.first + 1]++;
+	}
+
+	for(size_t i = 0; i < count; i++)
+	{
+		edge_start[i + 1] += edge_start[i];
+	}
+
+	std::vector<size_t> edge_targets(edges.size());
+	std::vector<size_t> fill(edge_start.begin(), edge_start.end() - 1);
+	std::vector<size_t> in_degree(count, 0);
+	for(auto& edge : edges)
+	{
+		edge_targets[fill[edge.first]++] = edge.second;
+		in_degree[edge.second]++;
+	}
+
+	// Kahn's algorithm, starting from the machines with no inputs in part order
+	std::vector<size_t> queue;
+	queue.reserve(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		if(in_degree[i] == 0)
+		{
+			queue.push_back(i);
+		}
+	}
+
+	std::vector<bool> placed(count, false);
+	for(size_t head = 0; head < queue.size(); head++)
+	{
+		size_t m = queue[head];
+		placed[m] = true;
+		order.push_back(machines[m]);
+
+		for(size_t e = edge_start[m]; e < edge_start[m + 1]; e++)
+		{
+			size_t target = edge_targets[e];
+			in_degree[target]--;
+			if(in_degree[target] == 0)
+			{
+				queue.push_back(target);
+			}
+		}
+	}
+
+	// Whatever could not be placed is in a cycle, or fed by one
+	cycle_machines = count - order.size();
+	if(cycle_machines != 0)
+	{
+		logger->warn("Vehicle wires contain a cycle, {} machines will receive values from it a frame late",
+			cycle_machines);
+
+		for(size_t i = 0; i < count; i++)
+		{
+			if(!placed[i])
+			{
+				order.push_back(machines[i]);
+			}
+		}
+	}
+}
+
+WireGraph::WireGraph()
+{
+	cycle_machines = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+
+class Machine;
+class Part;
+class Port;
+
+// The wires of a vehicle compiled into a machine ordering, so that every
+// machine updates after all machines that write to its inputs. Values
+// written to ports are buffered and delivered to each machine right before
+// it updates, so a whole network settles in a single pass per frame
+class WireGraph
+{
+public:
+
+	// Topological order, machines in wire cycles go last in part order
+	std::vector<Machine*> order;
+
+	// How many machines are in (or downstream of) a wire cycle. Values
+	// written backwards into them reach them on the next frame
+	size_t cycle_machines;
+
+	// Parts the graph was built from, to detect changes
+	std::vector<Part*> built_parts;
+
+	// Only wires between machines in the given parts are considered
+	void build(const std::vector<Part*>& parts, const std::vector<Port*>& all_ports);
+
+	WireGraph();
+};
@@ -0,0 +1,256 @@
+#include "BinaryUtil.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+enum TomlType : uint8_t
+{
+	TOML_TABLE,
+	TOML_ARRAY,
+	TOML_TABLE_ARRAY,
+	TOML_STRING,
+	TOML_INT,
+	TOML_DOUBLE,
+	TOML_BOOL,
+	TOML_LOCAL_DATE,
+	TOML_LOCAL_TIME,
+	TOML_LOCAL_DATETIME,
+	TOML_OFFSET_DATETIME
+};
+
+static void write_date(BinaryWriter& writer, const cpptoml::local_date& d)
+{
+	writer.write((int32_t)d.year); writer.write((int32_t)d.month); writer.write((int32_t)d.day);
+}
+
+static void write_time(BinaryWriter& writer, const cpptoml::local_time& t)
+{
+	writer.write((int32_t)t.hour); writer.write((int32_t)t.minute);
+	writer.write((int32_t)t.second); writer.write((int32_t)t.microsecond);
+}
+
+static void read_date(BinaryReader& reader, cpptoml::local_date& d)
+{
+	d.year = reader.read<int32_t>(); d.month = reader.read<int32_t>(); d.day = reader.read<int32_t>();
+}
+
+static void read_time(BinaryReader& reader, cpptoml::local_time& t)
+{
+	t.hour = reader.read<int32_t>(); t.minute = reader.read<int32_t>();
+	t.second = reader.read<int32_t>(); t.microsecond = reader.read<int32_t>();
+}
+
+static void write_base(BinaryWriter& writer, const cpptoml::base& val)
+{
+	if(val.is_table())
+	{
+		writer.write(TOML_TABLE);
+		BinaryUtil::write_toml(writer, (const cpptoml::table&)val);
+	}
+	else if(val.is_table_array())
+	{
+		const cpptoml::table_array& arr = (const cpptoml::table_array&)val;
+		writer.write(TOML_TABLE_ARRAY);
+		writer.write((uint32_t)arr.get().size());
+		for(const auto& sub : arr)
+		{
+			BinaryUtil::write_toml(writer, *sub);
+		}
+	}
+	else if(val.is_array())
+	{
+		const cpptoml::array& arr = (const cpptoml::array&)val;
+		writer.write(TOML_ARRAY);
+		writer.write((uint32_t)arr.get().size());
+		for(const auto& sub : arr)
+		{
+			write_base(writer, *sub);
+		}
+	}
+	// Integers first, as<double> also takes them
+	else if(auto v = val.as<int64_t>())
+	{
+		writer.write(TOML_INT);
+		writer.write(v->get());
+	}
+	else if(auto v = val.as<double>())
+	{
+		writer.write(TOML_DOUBLE);
+		writer.write(v->get());
+	}
+	else if(auto v = val.as<std::string>())
+	{
+		writer.write(TOML_STRING);
+		writer.write_string(v->get());
+	}
+	else if(auto v = val.as<bool>())
+	{
+		writer.write(TOML_BOOL);
+		writer.write((uint8_t)v->get());
+	}
+	else if(auto v = val.as<cpptoml::local_date>())
+	{
+		writer.write(TOML_LOCAL_DATE);
+		write_date(writer, v->get());
+	}
+	else if(auto v = val.as<cpptoml::local_time>())
+	{
+		writer.write(TOML_LOCAL_TIME);
+		write_time(writer, v->get());
+	}
+	else if(auto v = val.as<cpptoml::local_datetime>())
+	{
+		writer.write(TOML_LOCAL_DATETIME);
+		write_date(writer, v->get());
+		write_time(writer, v->get());
+	}
+	else if(auto v = val.as<cpptoml::offset_datetime>())
+	{
+		writer.write(TOML_OFFSET_DATETIME);
+		write_date(writer, v->get());
+		write_time(writer, v->get());
+		writer.write((int32_t)v->get().hour_offset);
+		writer.write((int32_t)v->get().minute_offset);
+	}
+	else
+	{
+		logger->fatal("Unknown TOML value type");
+	}
+}
+
+static std::shared_ptr<cpptoml::base> read_base(BinaryReader& reader)
+{
+	uint8_t type = reader.read<uint8_t>();
+	switch(type)
+	{
+	case TOML_TABLE:
+		return BinaryUtil::read_toml(reader);
+	case TOML_TABLE_ARRAY:
+	{
+		auto arr = cpptoml::make_table_array();
+		uint32_t count = reader.read<uint32_t>();
+		for(uint32_t i = 0; i < count; i++)
+		{
+			arr->push_back(BinaryUtil::read_toml(reader));
+		}
+		return arr;
+	}
+	case TOML_ARRAY:
+	{
+		auto arr = cpptoml::make_array();
+		uint32_t count = reader.read<uint32_t>();
+		for(uint32_t i = 0; i < count; i++)
+		{
+			arr->get().push_back(read_base(reader));
+		}
+		return arr;
+	}
+	case TOML_INT:
+		return cpptoml::make_value<int64_t>(reader.read<int64_t>());
+	case TOML_DOUBLE:
+		return cpptoml::make_value<double>(reader.read<double>());
+	case TOML_STRING:
+		return cpptoml::make_value<std::string>(reader.read_string());
+	case TOML_BOOL:
+		return cpptoml::make_value<bool>(reader.read<uint8_t>() != 0);
+	case TOML_LOCAL_DATE:
+	{
+		cpptoml::local_date d;
+		read_date(reader, d);
+		return cpptoml::make_value<cpptoml::local_date>(std::move(d));
+	}
+	case TOML_LOCAL_TIME:
+	{
+		cpptoml::local_time t;
+		read_time(reader, t);
+		return cpptoml::make_value<cpptoml::local_time>(std::move(t));
+	}
+	case TOML_LOCAL_DATETIME:
+	{
+		cpptoml::local_datetime dt;
+		read_date(reader, dt);
+		read_time(reader, dt);
+		return cpptoml::make_value<cpptoml::local_datetime>(std::move(dt));
+	}
+	case TOML_OFFSET_DATETIME:
+	{
+		cpptoml::offset_datetime dt;
+		read_date(reader, dt);
+		read_time(reader, dt);
+		dt.hour_offset = reader.read<int32_t>();
+		dt.minute_offset = reader.read<int32_t>();
+		return cpptoml::make_value<cpptoml::offset_datetime>(std::move(dt));
+	}
+	default:
+		logger->check(false, "Unknown TOML type in binary data ({})", (int)type);
+		return nullptr;
+	}
+}
+
+void BinaryUtil::write_toml(BinaryWriter& writer, const cpptoml::table& table)
+{
+	// Tables are unordered, sorting the keys makes the output
+	// the same for equal tables
+	std::vector<const std::string*> keys;
+	for(const auto& pair : table)
+	{
+		keys.push_back(&pair.first);
+	}
+	std::sort(keys.begin(), keys.end(), [](const std::string* a, const std::string* b) { return *a < *b; });
+
+	writer.write((uint32_t)keys.size());
+	for(const std::string* key : keys)
+	{
+		writer.write_string(*key);
+		write_base(writer, *table.get(*key));
+	}
+}
+
+std::shared_ptr<cpptoml::table> BinaryUtil::read_toml(BinaryReader& reader)
+{
+	auto table = cpptoml::make_table();
+	uint32_t count = reader.read<uint32_t>();
+	for(uint32_t i = 0; i < count; i++)
+	{
+		std::string key = reader.read_string();
+		table->insert(key, read_base(reader));
+	}
+	return table;
+}
+
+bool BinaryUtil::write_file(const std::vector<uint8_t>& data, const std::string& path)
+{
+	// Written next to it and then renamed over, so a failed write
+	// (crash, full disk) leaves the previous file as it was
+	std::string tmp_path = path + ".tmp";
+
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if(!file.good())
+		{
+			logger->error("Could not open file '{}' for writing", tmp_path);
+			return false;
+		}
+
+		file.write((const char*)data.data(), data.size());
+		file.close();
+		if(file.fail())
+		{
+			logger->error("Could not write file '{}'", tmp_path);
+			std::error_code ec;
+			std::filesystem::remove(tmp_path, ec);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp_path, path, ec);
+	if(ec)
+	{
+		logger->error("Could not replace file '{}': {}", path, ec.message());
+		std::filesystem::remove(tmp_path, ec);
+		return false;
+	}
+
+	return true;
+}
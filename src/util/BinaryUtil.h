@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <cpptoml.h>
+#include "Logger.h"
+
+// Simple binary serialization, for formats that need to load fast
+// (vehicle snapshots, quicksaves). Values are written as they are in memory,
+// so files are only portable between little endian machines (all we run on).
+// Only use with trivially copyable types, structs must have explicit padding
+// so their bytes are always initialized.
+class BinaryWriter
+{
+public:
+
+	std::vector<uint8_t> data;
+
+	template<typename T>
+	void write(const T& val)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written");
+		write_bytes(&val, sizeof(T));
+	}
+
+	template<typename T>
+	void write_array(const std::vector<T>& vals)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written");
+		write((uint32_t)vals.size());
+		write_bytes(vals.data(), vals.size() * sizeof(T));
+	}
+
+	void write_bytes(const void* bytes, size_t size)
+	{
+		const uint8_t* as_u8 = (const uint8_t*)bytes;
+		data.insert(data.end(), as_u8, as_u8 + size);
+	}
+
+	void write_string(const std::string& str)
+	{
+		write((uint32_t)str.size());
+		write_bytes(str.data(), str.size());
+	}
+
+	// Returns the offset of a uint32_t to be filled later with patch
+	size_t reserve_u32()
+	{
+		size_t offset = data.size();
+		write((uint32_t)0);
+		return offset;
+	}
+
+	void patch_u32(size_t offset, uint32_t val)
+	{
+		std::memcpy(data.data() + offset, &val, sizeof(uint32_t));
+	}
+};
+
+// Reads from memory it doesn't own (a MappedFile, or a BinaryWriter's data)
+// Reading past the end is an error (logger->check), so malformed files
+// don't crash the game
+class BinaryReader
+{
+private:
+
+	const uint8_t* data;
+	size_t size;
+	size_t pos;
+
+public:
+
+	template<typename T>
+	T read()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read");
+		T out;
+		// Data may not be aligned
+		std::memcpy(&out, read_bytes(sizeof(T)), sizeof(T));
+		return out;
+	}
+
+	template<typename T>
+	void read_array(std::vector<T>& out)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read");
+		uint32_t count = read<uint32_t>();
+		logger->check((size_t)count * sizeof(T) <= size - pos, "Binary data is truncated");
+		out.resize(count);
+		std::memcpy(out.data(), read_bytes(count * sizeof(T)), count * sizeof(T));
+	}
+
+	// Returns a pointer into the data, valid as long as it is
+	const uint8_t* read_bytes(size_t count)
+	{
+		logger->check(count <= size - pos, "Binary data is truncated");
+		const uint8_t* out = data + pos;
+		pos += count;
+		return out;
+	}
+
+	std::string read_string()
+	{
+		uint32_t len = read<uint32_t>();
+		const char* chars = (const char*)read_bytes(len);
+		return std::string(chars, len);
+	}
+
+	size_t get_pos() const { return pos; }
+	size_t get_size() const { return size; }
+	bool at_end() const { return pos == size; }
+
+	BinaryReader(const uint8_t* data, size_t size)
+	{
+		this->data = data;
+		this->size = size;
+		this->pos = 0;
+	}
+};
+
+class BinaryUtil
+{
+public:
+
+	// Any cpptoml table, including nested tables, arrays and dates
+	// Reading gives an equal table (same keys, values and types), and
+	// equal tables give the same bytes
+	static void write_toml(BinaryWriter& writer, const cpptoml::table& table);
+	static std::shared_ptr<cpptoml::table> read_toml(BinaryReader& reader);
+
+	// Replaces the file only once data is fully written, false (and
+	// the previous file untouched) on failure
+	static bool write_file(const std::vector<uint8_t>& data, const std::string& path);
+};
@@ -0,0 +1,168 @@
+#include "Compression.h"
+#include "Logger.h"
+#include <cstring>
+
+// Sequence format:
+//	- Token: literal count (high nibble), match length - MIN_MATCH (low nibble),
+//	  a nibble of 15 means more length bytes follow (summed until one isn't 255)
+//	- Literal count extra bytes, literals
+//	- Match offset (2 bytes, little endian), match length extra bytes
+// The last sequence has only literals, it ends the data
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr size_t HASH_BITS = 16;
+static constexpr uint32_t NO_POS = 0xFFFFFFFF;
+
+static uint32_t read32(const uint8_t* p)
+{
+	uint32_t out;
+	std::memcpy(&out, p, sizeof(uint32_t));
+	return out;
+}
+
+static uint32_t hash(uint32_t seq)
+{
+	return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void write_length(std::vector<uint8_t>& out, size_t len)
+{
+	while(len >= 255)
+	{
+		out.push_back(255);
+		len -= 255;
+	}
+	out.push_back((uint8_t)len);
+}
+
+static void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_count, 
+	size_t match_len, size_t offset)
+{
+	size_t match_extra = match_len == 0 ? 0 : match_len - MIN_MATCH;
+	uint8_t token = (uint8_t)((literal_count >= 15 ? 15 : literal_count) << 4);
+	token |= (uint8_t)(match_extra >= 15 ? 15 : match_extra);
+	out.push_back(token);
+
+	if(literal_count >= 15)
+	{
+		write_length(out, literal_count - 15);
+	}
+	out.insert(out.end(), literals, literals + literal_count);
+
+	if(match_len != 0)
+	{
+		out.push_back((uint8_t)(offset & 0xFF));
+		out.push_back((uint8_t)(offset >> 8));
+		if(match_extra >= 15)
+		{
+			write_length(out, match_extra - 15);
+		}
+	}
+}
+
+std::vector<uint8_t> Compression::compress(const uint8_t* data, size_t size)
+{
+	logger->check(size < (size_t)NO_POS, "Data too big to compress");
+
+	std::vector<uint8_t> out;
+	out.reserve(size / 2 + 16);
+
+	// Last position where every hashed 4 byte sequence was seen
+	std::vector<uint32_t> table(1 << HASH_BITS, NO_POS);
+
+	size_t i = 0;
+	size_t anchor = 0;
+	while(i + MIN_MATCH <= size)
+	{
+		uint32_t seq = read32(data + i);
+		uint32_t h = hash(seq);
+		uint32_t candidate = table[h];
+		table[h] = (uint32_t)i;
+
+		if(candidate != NO_POS && i - candidate <= MAX_OFFSET && read32(data + candidate) == seq)
+		{
+			size_t len = MIN_MATCH;
+			while(i + len < size && data[candidate + len] == data[i + len])
+			{
+				len++;
+			}
+
+			write_sequence(out, data + anchor, i - anchor, len, i - candidate);
+			i += len;
+			anchor = i;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	write_sequence(out, data + anchor, size - anchor, 0, 0);
+
+	return out;
+}
+
+static size_t read_length(const uint8_t* data, size_t size, size_t& i)
+{
+	size_t len = 0;
+	uint8_t b;
+	do
+	{
+		logger->check(i < size, "Compressed data is truncated");
+		b = data[i++];
+		len += b;
+	} while(b == 255);
+
+	return len;
+}
+
+std::vector<uint8_t> Compression::decompress(const uint8_t* data, size_t size, size_t decompressed_size)
+{
+	std::vector<uint8_t> out;
+	out.reserve(decompressed_size);
+
+	size_t i = 0;
+	while(true)
+	{
+		logger->check(i < size, "Compressed data is truncated");
+		uint8_t token = data[i++];
+
+		size_t literal_count = token >> 4;
+		if(literal_count == 15)
+		{
+			literal_count += read_length(data, size, i);
+		}
+
+		logger->check(literal_count <= size - i && out.size() + literal_count <= decompressed_size, 
+			"Malformed compressed data");
+		out.insert(out.end(), data + i, data + i + literal_count);
+		i += literal_count;
+
+		if(out.size() == decompressed_size)
+		{
+			break;
+		}
+
+		logger->check(i + 2 <= size, "Compressed data is truncated");
+		size_t offset = (size_t)data[i] | ((size_t)data[i + 1] << 8);
+		i += 2;
+
+		size_t match_len = (token & 0x0F) + MIN_MATCH;
+		if((token & 0x0F) == 15)
+		{
+			match_len += read_length(data, size, i);
+		}
+
+		logger->check(offset != 0 && offset <= out.size() && out.size() + match_len <= decompressed_size,
+			"Malformed compressed data");
+
+		// Matches may overlap what they write
+		size_t from = out.size() - offset;
+		for(size_t j = 0; j < match_len; j++)
+		{
+			out.push_back(out[from + j]);
+		}
+	}
+
+	return out;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// A small LZ77 compressor (in the spirit of LZ4: byte aligned sequences of 
+// literals and matches, no entropy coding), fast on both ends, meant for
+// saves that are mostly repeated structures and doubles.
+// The decompressed size is not stored, formats using it must keep it.
+class Compression
+{
+public:
+
+	static std::vector<uint8_t> compress(const uint8_t* data, size_t size);
+
+	// Malformed data is an error (logger->check)
+	static std::vector<uint8_t> decompress(const uint8_t* data, size_t size, size_t decompressed_size);
+};
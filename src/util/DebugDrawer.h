@@ -2,6 +2,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
+#include <mutex>
 #include <glad/glad.h>
 #include <assets/Shader.h>
 #include <assets/AssetManager.h>
@@ -39,6 +40,9 @@ private:
 	};
 
 	std::vector<DebugShape> draw_list;
+	// Shapes may be added from vehicles updating in parallel
+	std::mutex draw_list_mtx;
+	void push_shape(DebugShape&& shape);
 
 	GLuint points_vbo, points_vao;
 	GLuint lines_vbo, lines_vao;
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Union-find over the integers [0, size), with path halving and
+// union by size, so every operation is close to O(1)
+class DisjointSet
+{
+private:
+
+	std::vector<size_t> parent;
+	std::vector<size_t> set_size;
+
+public:
+
+	// Puts every element in its own set
+	void reset(size_t size)
+	{
+		parent.resize(size);
+		set_size.resize(size);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			parent[i] = i;
+			set_size[i] = 1;
+		}
+	}
+
+	size_t find(size_t x)
+	{
+		while (parent[x] != x)
+		{
+			parent[x] = parent[parent[x]];
+			x = parent[x];
+		}
+
+		return x;
+	}
+
+	// Returns the root of the merged set
+	size_t unite(size_t a, size_t b)
+	{
+		a = find(a);
+		b = find(b);
+
+		if (a == b)
+		{
+			return a;
+		}
+
+		if (set_size[a] < set_size[b])
+		{
+			std::swap(a, b);
+		}
+
+		parent[b] = a;
+		set_size[a] += set_size[b];
+
+		return a;
+	}
+
+	// Size of the set containing x
+	size_t get_size(size_t x)
+	{
+		return set_size[find(x)];
+	}
+
+	size_t size() const { return parent.size(); }
+};
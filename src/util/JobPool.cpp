@@ -0,0 +1,128 @@
+#include "JobPool.h"
+
+size_t JobPool::take_jobs()
+{
+	size_t done = 0;
+
+	while(true)
+	{
+		size_t i = next.fetch_add(1);
+		if(i >= job_count)
+		{
+			break;
+		}
+
+		try
+		{
+			(*job)(i);
+		}
+		catch(...)
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			if(!error)
+			{
+				error = std::current_exception();
+			}
+		}
+
+		done++;
+	}
+
+	return done;
+}
+
+void JobPool::worker_func()
+{
+	size_t seen_batch = 0;
+
+	std::unique_lock<std::mutex> lock(mtx);
+	while(true)
+	{
+		work_cv.wait(lock, [this, seen_batch]{ return stop || batch != seen_batch; });
+
+		if(stop)
+		{
+			return;
+		}
+
+		seen_batch = batch;
+		active++;
+
+		lock.unlock();
+		size_t done = take_jobs();
+		lock.lock();
+
+		finished += done;
+		active--;
+		if(finished == job_count && active == 0)
+		{
+			done_cv.notify_all();
+		}
+	}
+}
+
+void JobPool::run(size_t count, const std::function<void(size_t)>& fnc)
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		job = &fnc;
+		job_count = count;
+		next = 0;
+		finished = 0;
+		error = nullptr;
+		batch++;
+	}
+
+	work_cv.notify_all();
+
+	size_t done = take_jobs();
+
+	std::unique_lock<std::mutex> lock(mtx);
+	finished += done;
+	done_cv.wait(lock, [this]{ return finished == job_count && active == 0; });
+
+	job = nullptr;
+
+	if(error)
+	{
+		std::exception_ptr to_throw = error;
+		error = nullptr;
+		std::rethrow_exception(to_throw);
+	}
+}
+
+JobPool::JobPool(size_t thread_count)
+{
+	job = nullptr;
+	job_count = 0;
+	next = 0;
+	finished = 0;
+	active = 0;
+	batch = 0;
+	stop = false;
+
+	for(size_t i = 0; i < thread_count; i++)
+	{
+		threads.emplace_back(&JobPool::worker_func, this);
+	}
+}
+
+JobPool::~JobPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		stop = true;
+	}
+
+	work_cv.notify_all();
+
+	for(std::thread& t : threads)
+	{
+		t.join();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <vector>
+#include <atomic>
+
+// A set of worker threads that run batches of jobs. The calling thread
+// also takes jobs, so a pool with 0 threads simply runs them in order
+class JobPool
+{
+private:
+
+	std::vector<std::thread> threads;
+
+	std::mutex mtx;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+
+	// Current batch, guarded by mtx (next is taken without it)
+	const std::function<void(size_t)>* job;
+	size_t job_count;
+	std::atomic<size_t> next;
+	size_t finished;
+	// Workers inside the current batch, run() waits for them to leave it
+	size_t active;
+	size_t batch;
+	bool stop;
+
+	// First exception thrown by a job of the current batch
+	std::exception_ptr error;
+
+	void worker_func();
+	// Runs jobs of the current batch until none are left, returns how many it ran
+	size_t take_jobs();
+
+public:
+
+	// Runs fnc(i) for i in [0, count), and returns once all of them are done.
+	// If any job throws, the first exception is rethrown here
+	void run(size_t count, const std::function<void(size_t)>& fnc);
+
+	size_t get_thread_count() { return threads.size(); }
+
+	explicit JobPool(size_t thread_count);
+	~JobPool();
+};
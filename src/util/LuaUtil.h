@@ -8,23 +8,20 @@ public:
 
 	static void safe_lua(sol::state& state, const std::string& script, bool& wrote_error, const std::string& script_path)
 	{
-		state.safe_script(script, [&wrote_error](lua_State*, sol::protected_function_result pfr)
-		{
-
-			if (!wrote_error)
-			{
-				sol::error err = pfr;
-				logger->error("Lua Error:\n{}", err.what());
-				wrote_error = true;
-			}
+		sol::protected_function_result pfr = lua_core->run_script(state, script, script_path);
 
-			return pfr;
-		}, script_path);
+		if (!pfr.valid() && !wrote_error)
+		{
+			sol::error err = pfr;
+			logger->error("Lua Error:\n{}", err.what());
+			wrote_error = true;
+		}
 	}
 
+	// st can be a state or any table (for example, an environment)
 	// Handles errors
-	template<typename... Args>
-	static sol::safe_function_result call_function(sol::state& st, 
+	template<typename Table, typename... Args>
+	static sol::safe_function_result call_function(Table& st, 
 			const std::string& fname, const std::string& context, Args&&... args)
 	{
 		sol::safe_function fnc = st[fname];
@@ -41,8 +38,8 @@ public:
 	}
 
 	// Crashes on error
-	template<typename... Args>
-	static sol::safe_function_result safe_call_function(sol::state& st, 
+	template<typename Table, typename... Args>
+	static sol::safe_function_result safe_call_function(Table& st, 
 			const std::string& fname, const std::string& context, Args&&... args)
 	{
 		sol::safe_function fnc = st[fname];
@@ -59,8 +56,8 @@ public:
 	}
 
 	// Same as call_function but only does it if function is present
-	template<typename... Args>
-	static sol::safe_function_result call_function_if_present(sol::state& st,
+	template<typename Table, typename... Args>
+	static sol::safe_function_result call_function_if_present(Table& st,
 			const std::string& fname, const std::string& context, Args&&... args)
 	{
 		sol::safe_function fnc = st[fname];
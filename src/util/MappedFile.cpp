@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+#include "Logger.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, 
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		logger->error("Could not open file '{}' for mapping", path);
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		logger->error("Could not map file '{}', it's empty", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if(view == nullptr)
+	{
+		logger->error("Could not map file '{}'", path);
+		if(mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	file_handle = file;
+	mapping_handle = mapping;
+	data = (const uint8_t*)view;
+	size = (size_t)file_size.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data != nullptr)
+	{
+		UnmapViewOfFile(data);
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+	}
+
+	data = nullptr;
+	size = 0;
+	file_handle = nullptr;
+	mapping_handle = nullptr;
+}
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+	file_handle = nullptr;
+	mapping_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	int n_fd = ::open(path.c_str(), O_RDONLY);
+	if(n_fd < 0)
+	{
+		logger->error("Could not open file '{}' for mapping", path);
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(n_fd, &st) != 0 || st.st_size == 0)
+	{
+		logger->error("Could not map file '{}', it's empty", path);
+		::close(n_fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, n_fd, 0);
+	if(view == MAP_FAILED)
+	{
+		logger->error("Could not map file '{}'", path);
+		::close(n_fd);
+		return false;
+	}
+
+	fd = n_fd;
+	data = (const uint8_t*)view;
+	size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if(data != nullptr)
+	{
+		munmap((void*)data, size);
+		::close(fd);
+	}
+
+	data = nullptr;
+	size = 0;
+	fd = -1;
+}
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+	fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// A read only view of a whole file mapped in memory, so big binary files 
+// (vehicle snapshots, quicksaves) are paged in as they are read instead of 
+// being copied into a buffer first
+class MappedFile
+{
+private:
+
+	const uint8_t* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* file_handle;
+	void* mapping_handle;
+#else
+	int fd;
+#endif
+
+	void close();
+
+public:
+
+	// Returns false (and logs) if the file could not be mapped, empty
+	// files can't be mapped either
+	bool open(const std::string& path);
+
+	bool is_open() const { return data != nullptr; }
+
+	const uint8_t* get_data() const { return data; }
+	size_t get_size() const { return size; }
+
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};